@@ -140,11 +140,12 @@ extern "C" {
  *   2.1.5:  new freelist; version is 3
  *   2.1.9:  changes in btree node format; version is 4
  *   2.1.13: changes in btree node format; version is 5
+ *   2.2.1:  CRC32C page checksums; version is 6
  */
 #define UPS_VERSION_MAJ     2
 #define UPS_VERSION_MIN     2
 #define UPS_VERSION_REV     1
-#define UPS_FILE_VERSION    5
+#define UPS_FILE_VERSION    6
 
 /**
  * The upscaledb Database structure
@@ -548,6 +549,9 @@ ups_get_version(uint32_t *major, uint32_t *minor,
  * API functions will return @ref UPS_INTEGRITY_VIOLATED in case of failed
  * verifications. Not allowed in In-Memory Environments. This flag is not
  * persisted.
+ * New files use CRC32C checksums, which are calculated with the crc32
+ * instruction of the CPU if available (SSE 4.2). Older files keep using
+ * MurmurHash3.
  *
  * @param env A pointer to an Environment handle
  * @param filename The filename of the Environment file. If the file already
@@ -580,6 +584,16 @@ ups_get_version(uint32_t *major, uint32_t *minor,
  *      Environment.
  *     <li>@ref UPS_ENABLE_CRC32</li> Stores (and verifies) CRC32
  *      checksums. Not allowed in combination with @ref UPS_IN_MEMORY.
+ *     <li>@ref UPS_ENABLE_LAZY_CRC32</li> With @ref UPS_ENABLE_CRC32,
+ *      verifies the checksum of a memory mapped page only when it is loaded
+ *      the first time, and not when it is fetched again from the mapping.
+ *     <li>@ref UPS_ENABLE_IO_URING</li> Writes batches of pages (i.e. when
+ *      committing a Txn or flushing the cache) with io_uring. Only
+ *      available on Linux; ignored if the kernel does not support io_uring.
+ *     <li>@ref UPS_ENABLE_DIRECT_IO</li> Bypasses the page cache of the
+ *      operating system (O_DIRECT); the pages are only cached by upscaledb.
+ *      Implies @ref UPS_DISABLE_MMAP. Works best if the page size is a
+ *      multiple of 4 kb. Not supported on Microsoft Windows.
  *    </ul>
  *
  * @param mode File access rights for the new file. This is the @a mode
@@ -699,6 +713,16 @@ ups_env_create(ups_env_t **env, const char *filename,
  *      if necessary.
  *     <li>@ref UPS_ENABLE_CRC32</li> Stores (and verifies) CRC32
  *      checksums.
+ *     <li>@ref UPS_ENABLE_LAZY_CRC32</li> With @ref UPS_ENABLE_CRC32,
+ *      verifies the checksum of a memory mapped page only when it is loaded
+ *      the first time, and not when it is fetched again from the mapping.
+ *     <li>@ref UPS_ENABLE_IO_URING</li> Writes batches of pages (i.e. when
+ *      committing a Txn or flushing the cache) with io_uring. Only
+ *      available on Linux; ignored if the kernel does not support io_uring.
+ *     <li>@ref UPS_ENABLE_DIRECT_IO</li> Bypasses the page cache of the
+ *      operating system (O_DIRECT); the pages are only cached by upscaledb.
+ *      Implies @ref UPS_DISABLE_MMAP. Works best if the page size is a
+ *      multiple of 4 kb. Not supported on Microsoft Windows.
  *    </ul>
  * @param param An array of ups_parameter_t structures. The following
  *      parameters are available:
@@ -1188,7 +1212,11 @@ typedef struct ups_txn_t ups_txn_t;
  *    bitwise OR. Possible flags are:
  *    <ul>
  *     <li>@ref UPS_TXN_READ_ONLY </li> This Txn is read-only and
- *      will not modify the Database.
+ *      will not modify the Database. It reads from a snapshot of the
+ *      data which was committed when the Txn began; modifications of
+ *      other Transactions are invisible, and therefore never cause a
+ *      @ref UPS_TXN_CONFLICT. Write operations fail with
+ *      @ref UPS_WRITE_PROTECTED.
  *    </ul>
  *
  * @return @ref UPS_SUCCESS upon success
@@ -1275,13 +1303,19 @@ ups_txn_abort(ups_txn_t *txn, uint32_t flags);
  * This flag is non persistent. */
 #define UPS_READ_ONLY                               0x00000004
 
-/* unused                                           0x00000008 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_IO_URING                         0x00000008
 
-/* unused                                           0x00000010 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_DIRECT_IO                        0x00000010
 
 /* reserved                                         0x00000020 */
 
-/* unused                                           0x00000040 */
+/** Flag for @ref ups_env_open, @ref ups_env_create.
+ * This flag is non persistent. */
+#define UPS_ENABLE_LAZY_CRC32                       0x00000040
 
 /** Flag for @ref ups_env_create.
  * This flag is non persistent. */
@@ -1686,6 +1720,133 @@ ups_db_get_parameters(ups_db_t *db, ups_parameter_t *param);
  * this threshold. */
 #define UPS_PARAM_JOURNAL_SWITCH_THRESHOLD 0x00001
 
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * If @ref UPS_ENABLE_FSYNC is set, then concurrent commits share a single
+ * fsync of the journal ("group commit"). This is the max. number of
+ * microseconds that a commit waits for other commits to join its group.
+ * Default is 0 (only commits which arrive during a running fsync are
+ * grouped). */
+#define UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY 0x00000113
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * The group commit (see @ref UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY) starts
+ * the fsync as soon as this many commits are waiting. Default is 0
+ * (no limit). */
+#define UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE 0x00000114
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * UQI queries over a whole database (@ref uqi_select) split the scan
+ * across this many threads, if the aggregation function supports it.
+ * Default is 0 (one thread per CPU core); 1 disables parallel scans. */
+#define UPS_PARAM_SELECT_THREADS        0x00000115
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * The number of threads which flush dirty pages to disk, i.e. when the
+ * cache is purged. Adjacent pages are always written with a single I/O
+ * call; additional threads write several of these runs in parallel.
+ * Default is 1. */
+#define UPS_PARAM_FLUSH_THREADS         0x00000116
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * selects the replacement policy of the page cache. Either
+ * @ref UPS_CACHE_POLICY_LRU (the default) or @ref UPS_CACHE_POLICY_2Q,
+ * which is resistant against large scans: pages which were only
+ * accessed once are purged before pages which are used repeatedly. */
+#define UPS_PARAM_CACHE_POLICY          0x00000117
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * When cursors or scans traverse the leaf pages sequentially, the
+ * following leaf pages are read into the cache in the background. The
+ * number of pages which are read ahead grows while the access pattern
+ * stays sequential, up to this limit. Only applies to pages which are
+ * not memory mapped. Default is 32; 0 disables read-ahead. */
+#define UPS_PARAM_READ_AHEAD_PAGES      0x00000118
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * reserves a percentage of the cache (see @ref UPS_PARAM_CACHE_SIZE) for
+ * internal btree nodes. As long as the internal nodes fit into this
+ * budget, they are not purged from the cache, regardless of how many
+ * leaf and blob pages are accessed. Default is 10; 0 disables the
+ * reservation. */
+#define UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT 0x00000119
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * joins a cache budget which is shared by all Environments of this process
+ * that set this parameter. The value is the capacity (in bytes) of the
+ * shared budget; it is set by the first Environment which joins and kept
+ * while other Environments are still joined. Once the budget is exceeded,
+ * each Environment is entitled to a share proportional to its weight
+ * (see @ref UPS_PARAM_SHARED_CACHE_WEIGHT), and Environments below their
+ * share shrink the caches of idle Environments above their share.
+ * Overrides @ref UPS_PARAM_CACHE_SIZE for purging the cache. Ignored for
+ * In-Memory Environments. Default is 0 (the cache is not shared). */
+#define UPS_PARAM_SHARED_CACHE_SIZE     0x0000011A
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the weight of this Environment in the shared cache budget (see
+ * @ref UPS_PARAM_SHARED_CACHE_SIZE). Must not be 0. Default is 1. */
+#define UPS_PARAM_SHARED_CACHE_WEIGHT   0x0000011B
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * enables a second-level cache which keeps clean pages in compressed form
+ * after they were purged from the cache. When such a page is accessed
+ * again, it is decompressed instead of being read from disk. The value is
+ * the capacity (in bytes of compressed data). Only pages which are not
+ * memory mapped are stored. Default is 0 (disabled). */
+#define UPS_PARAM_COMPRESSED_CACHE_SIZE 0x0000011C
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the compression algorithm of the compressed cache (see
+ * @ref UPS_PARAM_COMPRESSED_CACHE_SIZE). Either @ref UPS_COMPRESSOR_LZF,
+ * @ref UPS_COMPRESSOR_SNAPPY or @ref UPS_COMPRESSOR_ZLIB. Default is
+ * @ref UPS_COMPRESSOR_LZF. */
+#define UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR 0x0000011D
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the number of threads which restore the pages of the journal's
+ * changesets during recovery (see @ref UPS_AUTO_RECOVERY). Each thread
+ * restores a different range of pages. Default is 0 (one thread per CPU
+ * core); 1 disables parallel recovery. */
+#define UPS_PARAM_RECOVERY_THREADS      0x0000011E
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the number of journal files ("segments"). The journal writes to one
+ * segment after the other; a segment is reused as soon as all
+ * Transactions which were logged to it are flushed to the database.
+ * If all segments are still in use then an additional segment is
+ * created, and removed once it is no longer required. Default is 2;
+ * the minimum is 2. */
+#define UPS_PARAM_JOURNAL_SEGMENTS      0x0000011F
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the size of each journal segment (see @ref UPS_PARAM_JOURNAL_SEGMENTS),
+ * in bytes. The segments are preallocated and reused in place; the
+ * journal switches to the next segment when the current one is full,
+ * and @ref UPS_PARAM_JOURNAL_SWITCH_THRESHOLD is ignored. Default is 0:
+ * the segments grow, and are switched after a number of Transactions. */
+#define UPS_PARAM_JOURNAL_SEGMENT_SIZE  0x00000120
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the journal starts a checkpoint after this many bytes were written
+ * since the previous checkpoint. A checkpoint waits in the background
+ * till all modified pages of older changesets are written to the
+ * database file; these changesets are then no longer required, and
+ * recovery starts at the newest checkpoint. Smaller values bound the
+ * recovery time and allow the journal segments to be reused earlier.
+ * Default is 0: a checkpoint is only started when the journal switches
+ * to another segment. */
+#define UPS_PARAM_JOURNAL_CHECKPOINT_SIZE 0x00000121
+
+/** Parameter name for @ref ups_env_open, @ref ups_env_create;
+ * the size of the dictionary for journal compression (see
+ * @ref UPS_PARAM_JOURNAL_COMPRESSION), in bytes. The keys and records of
+ * the first Transactions are collected in a dictionary, which is then
+ * stored in each journal segment. Further keys and records are
+ * compressed with this dictionary; small records compress much better
+ * than without one. Only supported by @ref UPS_COMPRESSOR_ZLIB; the
+ * maximum is 32 kb. Default is 0 (no dictionary). */
+#define UPS_PARAM_JOURNAL_DICTIONARY_SIZE 0x00000122
+
 /** Parameter name for @ref ups_env_open, @ref ups_env_create;
  * sets the cache size */
 #define UPS_PARAM_CACHE_SIZE            0x00000100
@@ -1744,6 +1905,12 @@ ups_db_get_parameters(ups_db_t *db, ups_parameter_t *param);
 /** Value for @ref UPS_PARAM_POSIX_FADVISE */
 #define UPS_POSIX_FADVICE_RANDOM                 1
 
+/** Value for @ref UPS_PARAM_CACHE_POLICY */
+#define UPS_CACHE_POLICY_LRU                     0
+
+/** Value for @ref UPS_PARAM_CACHE_POLICY */
+#define UPS_CACHE_POLICY_2Q                      1
+
 /** Value for unlimited record sizes */
 #define UPS_RECORD_SIZE_UNLIMITED       ((uint32_t)-1)
 
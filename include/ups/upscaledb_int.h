@@ -232,6 +232,18 @@ typedef struct ups_env_metrics_t {
   /* the heap size of this process */
   uint64_t mem_heap_size;
 
+  /* number of slabs of the page buffer pools */
+  uint64_t mem_page_pool_slabs;
+
+  /* bytes allocated for the slabs of the page buffer pools */
+  uint64_t mem_page_pool_bytes;
+
+  /* number of page buffers which are currently in use */
+  uint64_t mem_page_pool_current_allocations;
+
+  /* total number of page buffers which were handed out */
+  uint64_t mem_page_pool_total_allocations;
+
   /* amount of pages fetched from disk */
   uint64_t page_count_fetched;
 
@@ -286,6 +298,102 @@ typedef struct ups_env_metrics_t {
   /* log/journal bytes after compression */
   uint64_t journal_bytes_after_compression;
 
+  /* number of commits written to the log/journal */
+  uint64_t journal_commits;
+
+  /* number of fsyncs of the log/journal; journal_commits / journal_fsyncs
+   * is the average number of commits per fsync */
+  uint64_t journal_fsyncs;
+
+  /* number of changeset pages which were logged in full */
+  uint64_t journal_page_images;
+
+  /* number of changeset pages which were logged as deltas (only the
+   * modified bytes) */
+  uint64_t journal_page_deltas;
+
+  /* number of completed journal checkpoints */
+  uint64_t journal_checkpoints;
+
+  /* lsn of the newest completed checkpoint; recovery starts there */
+  uint64_t journal_checkpoint_lsn;
+
+  /* number of lsns which were assigned since the newest completed
+   * checkpoint started; grows with the work which is required for
+   * recovery */
+  uint64_t journal_checkpoint_lsn_lag;
+
+  /* the replacement policy of the cache (UPS_CACHE_POLICY_*) */
+  uint32_t cache_policy;
+
+  /* number of cache hits in the protected queue (UPS_CACHE_POLICY_2Q) */
+  uint64_t cache_hits_protected;
+
+  /* number of pages which were promoted to the protected queue */
+  uint64_t cache_promotions;
+
+  /* number of pages which were demoted from the protected queue */
+  uint64_t cache_demotions;
+
+  /* number of buckets of the cache's hash table */
+  uint64_t cache_buckets;
+
+  /* number of buckets of the cache's hash table which are not empty;
+   * the average chain length is the number of cached pages divided by
+   * this value */
+  uint64_t cache_buckets_used;
+
+  /* the length of the longest chain in the cache's hash table */
+  uint64_t cache_max_chain_length;
+
+  /* number of resize operations of the cache's hash table */
+  uint64_t cache_resizes;
+
+  /* number of pages which were read ahead */
+  uint64_t page_count_read_ahead;
+
+  /* number of cache hits of pages which were read ahead */
+  uint64_t cache_hits_read_ahead;
+
+  /* number of cache hits of internal btree nodes */
+  uint64_t cache_hits_internal;
+
+  /* number of cache misses of internal btree nodes */
+  uint64_t cache_misses_internal;
+
+  /* number of internal btree nodes in the reserved part of the cache */
+  uint64_t cache_internal_nodes;
+
+  /* capacity of the shared cache (0 if the cache is not shared) */
+  uint64_t shared_cache_capacity;
+
+  /* bytes cached by all Environments of the shared cache */
+  uint64_t shared_cache_used_bytes;
+
+  /* this Environment's share of the shared cache */
+  uint64_t shared_cache_share;
+
+  /* number of times the cache was shrunk by other Environments */
+  uint64_t shared_cache_shrinks;
+
+  /* number of pages which were fetched from the compressed cache */
+  uint64_t compressed_cache_hits;
+
+  /* number of pages which were not found in the compressed cache */
+  uint64_t compressed_cache_misses;
+
+  /* number of pages which were not stored because they did not compress */
+  uint64_t compressed_cache_rejected;
+
+  /* number of pages in the compressed cache */
+  uint64_t compressed_cache_pages;
+
+  /* bytes of compressed data in the compressed cache */
+  uint64_t compressed_cache_bytes;
+
+  /* size of the pages in the compressed cache before compression */
+  uint64_t compressed_cache_uncompressed_bytes;
+
   /* record bytes before compression */
   uint64_t record_bytes_before_compression;
 
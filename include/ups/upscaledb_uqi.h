@@ -178,6 +178,13 @@ typedef int (*uqi_plugin_predicate_function)(void *state,
 /** Assigns the results to an @a uqi_result_t structure */
 typedef void (*uqi_plugin_result_function)(void *state, uqi_result_t *result);
 
+/**
+ * Merges the partial aggregation in |other_state| into |state|. Both
+ * states were created by the same plugin; |other_state| aggregated values
+ * which follow those of |state| in the database's sort order.
+ */
+typedef void (*uqi_plugin_combine_function)(void *state, void *other_state);
+
 /** Describes a plugin for predicates */
 #define UQI_PLUGIN_PREDICATE                    1
 
@@ -234,7 +241,10 @@ typedef struct {
    */
   uint32_t flags;
 
-  /** The version of the plugin's interface; always set to 0 */
+  /**
+   * The version of the plugin's interface; set to 0, or to 1 if the
+   * descriptor includes the @a combine function
+   */
   uint32_t plugin_version;
 
   /** The initialization function; can be null */
@@ -264,6 +274,13 @@ typedef struct {
   /** Assigns the result to a @a uqi_result_t structure; must not be null */
   uqi_plugin_result_function results;
 
+  /**
+   * Merges two partial aggregations; can be null. Only available if
+   * @a plugin_version is 1. If set, then aggregate plugins can run in
+   * parallel scans, which are split across several threads.
+   */
+  uqi_plugin_combine_function combine;
+
 } uqi_plugin_t;
 
 
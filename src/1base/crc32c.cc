@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  include <nmmintrin.h>
+#  define UPS_HAVE_CRC32C_SSE42 1
+#  define UPS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#  include <intrin.h>
+#  include <nmmintrin.h>
+#  define UPS_HAVE_CRC32C_SSE42 1
+#  define UPS_TARGET_SSE42
+#endif
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/crc32c.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+// The reflected Castagnoli polynomial
+static const uint32_t kPolynomial = 0x82f63b78;
+
+// Block sizes of the three interleaved streams of the hardware
+// implementation
+enum { kLongBlock = 8192, kShortBlock = 256 };
+
+static inline uint64_t
+load64(const uint8_t *p)
+{
+  uint64_t v;
+  ::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Multiplies the 32x32 bit matrix |mat| with the vector |vec| (over GF(2))
+static uint32_t
+gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+  uint32_t sum = 0;
+  for (; vec; vec >>= 1, mat++)
+    if (vec & 1)
+      sum ^= *mat;
+  return sum;
+}
+
+static void
+gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+  for (int n = 0; n < 32; n++)
+    square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+// The lookup tables; initialized once
+struct Crc32cTables
+{
+  Crc32cTables() {
+    // slicing-by-8
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = n;
+      for (int k = 0; k < 8; k++)
+        crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+      slices[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = slices[0][n];
+      for (int k = 1; k < 8; k++) {
+        crc = slices[0][crc & 0xff] ^ (crc >> 8);
+        slices[k][n] = crc;
+      }
+    }
+
+    // operators which append |kLongBlock| or |kShortBlock| zero bytes to
+    // a CRC; required to combine the interleaved streams
+    initialize_shift(long_shift, kLongBlock);
+    initialize_shift(short_shift, kShortBlock);
+  }
+
+  // Creates the tables for appending |length| zero bytes (a power of two)
+  static void initialize_shift(uint32_t shift[4][256], size_t length) {
+    uint32_t even[32];
+    uint32_t odd[32];
+
+    // the operator for one zero bit
+    odd[0] = kPolynomial;
+    for (int n = 1; n < 32; n++)
+      odd[n] = 1u << (n - 1);
+
+    gf2_matrix_square(even, odd); // two zero bits
+    gf2_matrix_square(odd, even); // four zero bits
+
+    // square till the operator appends |length| bytes
+    const uint32_t *op = odd;
+    do {
+      gf2_matrix_square(even, odd);
+      op = even;
+      length >>= 1;
+      if (length == 0)
+        break;
+      gf2_matrix_square(odd, even);
+      op = odd;
+      length >>= 1;
+    } while (length);
+
+    for (uint32_t n = 0; n < 256; n++) {
+      shift[0][n] = gf2_matrix_times(op, n);
+      shift[1][n] = gf2_matrix_times(op, n << 8);
+      shift[2][n] = gf2_matrix_times(op, n << 16);
+      shift[3][n] = gf2_matrix_times(op, n << 24);
+    }
+  }
+
+  uint32_t slices[8][256];
+  uint32_t long_shift[4][256];
+  uint32_t short_shift[4][256];
+};
+
+static const Crc32cTables &
+tables()
+{
+  static const Crc32cTables t;
+  return t;
+}
+
+uint32_t
+Crc32c::checksum_portable(const void *data, size_t size, uint32_t crc)
+{
+  const Crc32cTables &t = tables();
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  // slicing-by-8 requires little endian loads
+  for (; size > 0; size--, p++)
+    crc = t.slices[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+#else
+  for (; size > 0 && ((uintptr_t)p & 7) != 0; size--, p++)
+    crc = t.slices[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t v = load64(p) ^ crc;
+    crc = t.slices[7][v & 0xff]
+        ^ t.slices[6][(v >> 8) & 0xff]
+        ^ t.slices[5][(v >> 16) & 0xff]
+        ^ t.slices[4][(v >> 24) & 0xff]
+        ^ t.slices[3][(v >> 32) & 0xff]
+        ^ t.slices[2][(v >> 40) & 0xff]
+        ^ t.slices[1][(v >> 48) & 0xff]
+        ^ t.slices[0][v >> 56];
+  }
+
+  for (; size > 0; size--, p++)
+    crc = t.slices[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+#endif
+
+  return ~crc;
+}
+
+#ifdef UPS_HAVE_CRC32C_SSE42
+
+// Appends the zero bytes of |shift| to |crc|
+static inline uint64_t
+shift_crc(const uint32_t shift[4][256], uint64_t crc)
+{
+  return shift[0][crc & 0xff]
+        ^ shift[1][(crc >> 8) & 0xff]
+        ^ shift[2][(crc >> 16) & 0xff]
+        ^ shift[3][(crc >> 24) & 0xff];
+}
+
+// Calculates the CRC of three adjacent blocks of |length| bytes in
+// parallel, then combines them. The crc32 instruction has a latency of
+// three cycles but a throughput of one per cycle.
+UPS_TARGET_SSE42 static inline const uint8_t *
+checksum_blocks(const uint32_t shift[4][256], const uint8_t *p,
+                size_t length, uint64_t *crc)
+{
+  uint64_t crc0 = *crc;
+  uint64_t crc1 = 0;
+  uint64_t crc2 = 0;
+  const uint8_t *end = p + length;
+  for (; p < end; p += 8) {
+    crc0 = _mm_crc32_u64(crc0, load64(p));
+    crc1 = _mm_crc32_u64(crc1, load64(p + length));
+    crc2 = _mm_crc32_u64(crc2, load64(p + 2 * length));
+  }
+  crc0 = shift_crc(shift, crc0) ^ crc1;
+  *crc = shift_crc(shift, crc0) ^ crc2;
+  return p + 2 * length;
+}
+
+UPS_TARGET_SSE42 static uint32_t
+checksum_sse42(const void *data, size_t size, uint32_t crc)
+{
+  const Crc32cTables &t = tables();
+  const uint8_t *p = (const uint8_t *)data;
+  uint64_t crc0 = ~crc;
+
+  for (; size > 0 && ((uintptr_t)p & 7) != 0; size--, p++)
+    crc0 = _mm_crc32_u8((uint32_t)crc0, *p);
+
+  for (; size >= 3 * kLongBlock; size -= 3 * kLongBlock)
+    p = checksum_blocks(t.long_shift, p, kLongBlock, &crc0);
+  for (; size >= 3 * kShortBlock; size -= 3 * kShortBlock)
+    p = checksum_blocks(t.short_shift, p, kShortBlock, &crc0);
+
+  for (; size >= 8; size -= 8, p += 8)
+    crc0 = _mm_crc32_u64(crc0, load64(p));
+  for (; size > 0; size--, p++)
+    crc0 = _mm_crc32_u8((uint32_t)crc0, *p);
+
+  return ~(uint32_t)crc0;
+}
+
+static bool
+cpu_supports_sse42()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif // UPS_HAVE_CRC32C_SSE42
+
+typedef uint32_t (*ChecksumFunction)(const void *, size_t, uint32_t);
+
+static ChecksumFunction
+select_implementation()
+{
+#ifdef UPS_HAVE_CRC32C_SSE42
+  if (cpu_supports_sse42())
+    return checksum_sse42;
+#endif
+  return Crc32c::checksum_portable;
+}
+
+uint32_t
+Crc32c::checksum(const void *data, size_t size, uint32_t crc)
+{
+  static const ChecksumFunction function = select_implementation();
+  return function(data, size, crc);
+}
+
+bool
+Crc32c::is_hardware_accelerated()
+{
+#ifdef UPS_HAVE_CRC32C_SSE42
+  return cpu_supports_sse42();
+#else
+  return false;
+#endif
+}
+
+} // namespace upscaledb
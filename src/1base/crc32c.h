@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * CRC32C (Castagnoli polynomial), as used by iSCSI, ext4 and btrfs.
+ *
+ * On x86-64 the SSE4.2 crc32 instruction is used if the CPU supports it;
+ * the check is performed at runtime. Large buffers are split in three
+ * interleaved streams which are combined afterwards. On other CPUs a
+ * portable slicing-by-8 implementation is used.
+ *
+ * @exception_safe: nothrow
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_CRC32C_H
+#define UPS_CRC32C_H
+
+#include "0root/root.h"
+
+#include <stddef.h>
+
+#include "ups/types.h"
+
+// Always verify that a file of level N does not include headers > N!
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct Crc32c
+{
+  // Returns the CRC32C of |size| bytes at |data|. |crc| is the CRC32C of
+  // the preceding data, or a seed.
+  static uint32_t checksum(const void *data, size_t size, uint32_t crc = 0);
+
+  // Same as |checksum()|, but always uses the portable implementation
+  static uint32_t checksum_portable(const void *data, size_t size,
+                  uint32_t crc = 0);
+
+  // Returns true if the CPU has an instruction for calculating the CRC32C
+  static bool is_hardware_accelerated();
+};
+
+} // namespace upscaledb
+
+#endif // UPS_CRC32C_H
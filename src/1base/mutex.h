@@ -27,8 +27,10 @@
 
 #define BOOST_ALL_NO_LIB // disable MSVC auto-linking
 #include <boost/version.hpp>
+#include <boost/atomic.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/tss.hpp>
 #include <boost/thread/condition.hpp>
@@ -57,6 +59,151 @@ struct Mutex : public boost::mutex
   }
 };
 
+// A reader/writer lock: multiple readers can hold the shared lock at the
+// same time, but the exclusive lock is only granted to a single writer
+struct ReadWriteMutex : public boost::shared_mutex
+{
+};
+
+typedef boost::unique_lock<boost::shared_mutex> ScopedWriteLock;
+typedef boost::shared_lock<boost::shared_mutex> ScopedReadLock;
+
+// Locks a ReadWriteMutex either in shared or in exclusive mode
+struct ScopedReadWriteLock
+{
+  ScopedReadWriteLock()
+    : mutex_(0), shared_(false) {
+  }
+
+  ScopedReadWriteLock(ReadWriteMutex &mutex, bool shared)
+    : mutex_(0), shared_(false) {
+    lock(mutex, shared);
+  }
+
+  ~ScopedReadWriteLock() {
+    unlock();
+  }
+
+  void lock(ReadWriteMutex &mutex, bool shared) {
+    if (shared)
+      mutex.lock_shared();
+    else
+      mutex.lock();
+    mutex_ = &mutex;
+    shared_ = shared;
+  }
+
+  void unlock() {
+    if (mutex_) {
+      if (shared_)
+        mutex_->unlock_shared();
+      else
+        mutex_->unlock();
+      mutex_ = 0;
+    }
+  }
+
+  bool is_shared() const {
+    return mutex_ != 0 && shared_;
+  }
+
+  ReadWriteMutex *mutex_;
+  bool shared_;
+};
+
+// A reader/writer lock with a second group of shared owners: multiple
+// "updaters" can hold the lock at the same time, but never together with
+// readers. The exclusive lock is only granted to a single writer. Waiting
+// writers have priority; if the last owner of a group leaves while the
+// other group is waiting then the lock is handed over to the other group.
+struct ReadWriteUpdateMutex
+{
+  enum {
+    kReaders  = 1,
+    kUpdaters = 2
+  };
+
+  ReadWriteUpdateMutex()
+    : writer_(false), waiting_writers_(0), readers_(0), waiting_readers_(0),
+      updaters_(0), waiting_updaters_(0), handover_(0) {
+  }
+
+  void lock() {
+    boost::mutex::scoped_lock lock(mutex_);
+    waiting_writers_++;
+    while (writer_ || readers_ > 0 || updaters_ > 0)
+      cond_.wait(lock);
+    waiting_writers_--;
+    writer_ = true;
+  }
+
+  bool try_lock() {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (writer_ || readers_ > 0 || updaters_ > 0)
+      return false;
+    writer_ = true;
+    return true;
+  }
+
+  void unlock() {
+    boost::mutex::scoped_lock lock(mutex_);
+    writer_ = false;
+    cond_.notify_all();
+  }
+
+  void lock_shared() {
+    boost::mutex::scoped_lock lock(mutex_);
+    waiting_readers_++;
+    while (writer_ || waiting_writers_ > 0 || updaters_ > 0
+            || handover_ == kUpdaters
+            || (readers_ > 0 && waiting_updaters_ > 0))
+      cond_.wait(lock);
+    waiting_readers_--;
+    readers_++;
+    handover_ = 0;
+  }
+
+  void unlock_shared() {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (--readers_ == 0) {
+      if (waiting_updaters_ > 0)
+        handover_ = kUpdaters;
+      cond_.notify_all();
+    }
+  }
+
+  void lock_update() {
+    boost::mutex::scoped_lock lock(mutex_);
+    waiting_updaters_++;
+    while (writer_ || waiting_writers_ > 0 || readers_ > 0
+            || handover_ == kReaders
+            || (updaters_ > 0 && waiting_readers_ > 0))
+      cond_.wait(lock);
+    waiting_updaters_--;
+    updaters_++;
+    handover_ = 0;
+  }
+
+  void unlock_update() {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (--updaters_ == 0) {
+      if (waiting_readers_ > 0)
+        handover_ = kReaders;
+      cond_.notify_all();
+    }
+  }
+
+  boost::mutex mutex_;
+  Condition cond_;
+  bool writer_;
+  int waiting_writers_;
+  int readers_;
+  int waiting_readers_;
+  int updaters_;
+  int waiting_updaters_;
+  int handover_;
+};
+
 template<typename T>
 struct ScopedTryLock
 {
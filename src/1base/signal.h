@@ -57,6 +57,37 @@ struct Signal
   Condition cond;
 };
 
+// A signal for a group of tasks; wait() returns as soon as every task
+// which was registered with add() called notify()
+struct CountingSignal
+{
+  CountingSignal(size_t pending_ = 0)
+    : pending(pending_) {
+  }
+
+  void add(size_t count = 1) {
+    ScopedLock lock(mutex);
+    pending += count;
+  }
+
+  void wait() {
+    ScopedLock lock(mutex);
+    while (pending > 0)
+      cond.wait(lock);
+  }
+
+  void notify() {
+    ScopedLock lock(mutex);
+    assert(pending > 0);
+    if (--pending == 0)
+      cond.notify_all();
+  }
+
+  size_t pending;
+  Mutex mutex;
+  Condition cond;
+};
+
 } // namespace upscaledb
 
 #endif /* UPS_SIGNAL_H */
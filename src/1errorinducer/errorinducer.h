@@ -61,6 +61,9 @@ struct ErrorInducer {
     // let mmap fail
     kFileMmap,
 
+    // let io_uring_enter() fail
+    kIoUringEnter,
+
     kMaxActions
   };
 
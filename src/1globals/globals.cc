@@ -27,9 +27,9 @@
 
 namespace upscaledb {
 
-uint64_t Globals::ms_extended_keys;
+boost::atomic<uint64_t> Globals::ms_extended_keys(0);
 
-uint64_t Globals::ms_extended_duptables;
+boost::atomic<uint64_t> Globals::ms_extended_duptables(0);
 
 uint32_t Globals::ms_extended_threshold;
 
@@ -52,17 +52,17 @@ void UPS_CALLCONV default_errhandler(int level, const char *message);
 
 ups_error_handler_fun Globals::ms_error_handler = default_errhandler;
 
-uint64_t Globals::ms_bytes_before_compression;
+boost::atomic<uint64_t> Globals::ms_bytes_before_compression(0);
 
-uint64_t Globals::ms_bytes_after_compression;
+boost::atomic<uint64_t> Globals::ms_bytes_after_compression(0);
 
 bool Globals::ms_is_simd_enabled = true;
 
-uint64_t Globals::ms_btree_smo_split;
+boost::atomic<uint64_t> Globals::ms_btree_smo_split(0);
 
-uint64_t Globals::ms_btree_smo_merge;
+boost::atomic<uint64_t> Globals::ms_btree_smo_merge(0);
 
-uint64_t Globals::ms_btree_smo_shift;
+boost::atomic<uint64_t> Globals::ms_btree_smo_shift(0);
 
 int Globals::ms_flush_threshold = 10;
 
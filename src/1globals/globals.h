@@ -25,6 +25,8 @@
 
 #include "0root/root.h"
 
+#include <boost/atomic.hpp>
+
 #include "ups/types.h"
 
 // Always verify that a file of level N does not include headers > N!
@@ -36,12 +38,14 @@
 
 namespace upscaledb {
 
+// The metrics counters are atomic because operations on different
+// databases can run concurrently
 struct Globals {
   // for counting extended keys
-  static uint64_t ms_extended_keys;
+  static boost::atomic<uint64_t> ms_extended_keys;
 
   // for counting extended duplicate tables
-  static uint64_t ms_extended_duptables;
+  static boost::atomic<uint64_t> ms_extended_duptables;
 
   // Move every key > threshold to a blob. For testing purposes.
   // TODO currently gets assigned at runtime
@@ -74,22 +78,22 @@ struct Globals {
   static ups_error_handler_fun ms_error_handler;
 
   // Tracking key bytes before compression
-  static uint64_t ms_bytes_before_compression;
+  static boost::atomic<uint64_t> ms_bytes_before_compression;
 
   // Tracking key bytes after compression
-  static uint64_t ms_bytes_after_compression;
+  static boost::atomic<uint64_t> ms_bytes_after_compression;
 
   // enable/disable SIMD
   static bool ms_is_simd_enabled;
 
   // usage metrics - number of page splits
-  static uint64_t ms_btree_smo_split;
+  static boost::atomic<uint64_t> ms_btree_smo_split;
 
   // usage metrics - number of page merges
-  static uint64_t ms_btree_smo_merge;
+  static boost::atomic<uint64_t> ms_btree_smo_merge;
 
   // usage metrics - number of page shifts
-  static uint64_t ms_btree_smo_shift;
+  static boost::atomic<uint64_t> ms_btree_smo_shift;
 
   // flush threshold for committed transactions
   static int ms_flush_threshold;
@@ -29,6 +29,7 @@
 // Always verify that a file of level N does not include headers > N!
 #include "1os/file.h"
 #include "1mem/mem.h"
+#include "1mem/page_pool.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -57,6 +58,8 @@ Memory::get_global_metrics(ups_env_metrics_t *metrics)
 
   metrics->mem_total_allocations = ms_total_allocations;
   metrics->mem_current_allocations = ms_current_allocations;
+
+  PagePool::get_global_metrics(metrics);
 }
 
 } // namespace upscaledb
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <algorithm>
+
+#include "ups/upscaledb_int.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1os/os.h"
+#include "1mem/page_pool.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+typedef std::map<size_t, PagePool *> PoolMap;
+
+static Spinlock ms_pools_mutex;
+static PoolMap ms_pools;
+
+PagePool *
+PagePool::instance(size_t page_size)
+{
+  ScopedSpinlock lock(ms_pools_mutex);
+  PoolMap::iterator it = ms_pools.find(page_size);
+  if (it != ms_pools.end())
+    return it->second;
+  PagePool *pool = new PagePool(page_size);
+  ms_pools[page_size] = pool;
+  return pool;
+}
+
+void
+PagePool::get_global_metrics(ups_env_metrics_t *metrics)
+{
+  metrics->mem_page_pool_slabs = 0;
+  metrics->mem_page_pool_bytes = 0;
+  metrics->mem_page_pool_current_allocations = 0;
+  metrics->mem_page_pool_total_allocations = 0;
+
+  ScopedSpinlock lock(ms_pools_mutex);
+  for (PoolMap::iterator it = ms_pools.begin(); it != ms_pools.end(); it++) {
+    PagePool *pool = it->second;
+    ScopedSpinlock pool_lock(pool->mutex);
+    metrics->mem_page_pool_slabs += pool->slabs.size();
+    metrics->mem_page_pool_bytes += pool->slabs.size() * pool->slab_size;
+    metrics->mem_page_pool_current_allocations += pool->current_allocations;
+    metrics->mem_page_pool_total_allocations += pool->total_allocations;
+  }
+}
+
+PagePool::PagePool(size_t page_size_)
+  : page_size(page_size_), current_allocations(0), total_allocations(0)
+{
+  assert(page_size >= sizeof(void *));
+  buffers_per_slab = std::max((size_t)1, (size_t)kSlabSize / page_size);
+  slab_size = buffers_per_slab * page_size;
+}
+
+PagePool::Slab *
+PagePool::allocate_slab()
+{
+  Slab *slab = new Slab;
+  try {
+    slab->data = (uint8_t *)os_alloc_pages(slab_size, true);
+  }
+  catch (Exception &) {
+    delete slab;
+    throw;
+  }
+
+  // build the free list in reverse order; the buffers are then handed out
+  // in ascending order
+  for (size_t i = buffers_per_slab; i > 0; i--) {
+    void *buffer = slab->data + (i - 1) * page_size;
+    *(void **)buffer = slab->free_list;
+    slab->free_list = buffer;
+  }
+  slab->free_count = buffers_per_slab;
+
+  slabs[slab->data] = slab;
+  return slab;
+}
+
+uint8_t *
+PagePool::allocate()
+{
+  ScopedSpinlock lock(mutex);
+
+  Slab *slab = partial.head();
+  if (unlikely(!slab)) {
+    slab = allocate_slab();
+    partial.put(slab);
+  }
+
+  void *buffer = slab->free_list;
+  slab->free_list = *(void **)buffer;
+  if (--slab->free_count == 0)
+    partial.del(slab);
+
+  current_allocations++;
+  total_allocations++;
+  return (uint8_t *)buffer;
+}
+
+void
+PagePool::release(void *ptr)
+{
+  if (unlikely(!ptr))
+    return;
+
+  ScopedSpinlock lock(mutex);
+
+  // the slab is the one with the highest start address <= |ptr|
+  std::map<uint8_t *, Slab *>::iterator it = slabs.upper_bound((uint8_t *)ptr);
+  assert(it != slabs.begin());
+  Slab *slab = (--it)->second;
+  assert((uint8_t *)ptr < slab->data + slab_size);
+
+  *(void **)ptr = slab->free_list;
+  slab->free_list = ptr;
+  if (++slab->free_count == 1)
+    partial.put(slab);
+  current_allocations--;
+
+  // return the slab to the OS if it's unused, but keep one slab in reserve
+  if (slab->free_count == buffers_per_slab && partial.size() > 1) {
+    partial.del(slab);
+    slabs.erase(it);
+    os_free_pages(slab->data, slab_size);
+    delete slab;
+  }
+}
+
+} // namespace upscaledb
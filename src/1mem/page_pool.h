@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A pool for page buffers
+ *
+ * Carves page-sized buffers from large slabs (2 MB, backed by huge pages
+ * if the operating system supports it). Each slab manages its own list of
+ * free buffers; released buffers are reused, and a slab is returned to the
+ * operating system as soon as all its buffers are free (unless it is the
+ * last slab with free buffers).
+ *
+ * There is one pool for each page size; the pools are shared by all
+ * Environments and are never destroyed.
+ *
+ * @exception_safe: strong
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_PAGE_POOL_H
+#define UPS_PAGE_POOL_H
+
+#include "0root/root.h"
+
+#include <map>
+
+#include "ups/types.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "1base/intrusive_list.h"
+#include "1base/spinlock.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+struct ups_env_metrics_t;
+
+namespace upscaledb {
+
+struct PagePool
+{
+  enum {
+    // The size of a slab
+    kSlabSize = 2 * 1024 * 1024
+  };
+
+  // A large chunk of memory which is split into page buffers
+  struct Slab {
+    Slab()
+      : data(0), free_list(0), free_count(0) {
+    }
+
+    // The memory of this slab
+    uint8_t *data;
+
+    // Singly linked list of free buffers; the first bytes of each free
+    // buffer point to the next one
+    void *free_list;
+
+    // The number of free buffers
+    size_t free_count;
+
+    // For the list of slabs with free buffers
+    IntrusiveListNode<Slab> list_node;
+  };
+
+  // Returns the pool for buffers of |page_size| bytes
+  static PagePool *instance(size_t page_size);
+
+  // Fills in the metrics of all pools
+  static void get_global_metrics(ups_env_metrics_t *metrics);
+
+  // Constructor
+  PagePool(size_t page_size);
+
+  // Allocates a page buffer; throws UPS_OUT_OF_MEMORY
+  uint8_t *allocate();
+
+  // Releases a page buffer which was allocated with |allocate()|
+  void release(void *ptr);
+
+  // Allocates a new slab and adds all its buffers to its free list
+  Slab *allocate_slab();
+
+  // Protects the pool
+  Spinlock mutex;
+
+  // The size of a buffer
+  size_t page_size;
+
+  // The number of buffers per slab
+  size_t buffers_per_slab;
+
+  // The size of a slab (|kSlabSize|, rounded down to a multiple of
+  // |page_size|)
+  size_t slab_size;
+
+  // All slabs, indexed by their start address
+  std::map<uint8_t *, Slab *> slabs;
+
+  // The slabs which have free buffers
+  IntrusiveList<Slab> partial;
+
+  // The number of buffers which are currently in use
+  uint64_t current_allocations;
+
+  // The total number of buffers which were allocated
+  uint64_t total_allocations;
+};
+
+} // namespace upscaledb
+
+#endif // UPS_PAGE_POOL_H
@@ -41,6 +41,20 @@
 
 namespace upscaledb {
 
+// A buffer for |File::pwritev()|
+struct IoBuffer
+{
+  IoBuffer(const void *data_ = 0, size_t size_ = 0)
+    : data(data_), size(size_) {
+  }
+
+  // The data
+  const void *data;
+
+  // The size of the data
+  size_t size;
+};
+
 class File
 {
   public:
@@ -58,15 +72,19 @@ class File
 #endif
     };
 
+    // The max. alignment which is required for direct I/O
+    enum { kMaxDirectIoAlignment = 4096 };
+
     // Constructor: creates an empty File handle
     File()
-      : m_fd(UPS_INVALID_FD), m_mmaph(UPS_INVALID_FD), m_posix_advice(0) {
+      : m_fd(UPS_INVALID_FD), m_mmaph(UPS_INVALID_FD), m_posix_advice(0),
+        m_alignment(0) {
     }
 
     // Copy constructor: moves ownership of the file handle
     File(File &&other)
       : m_fd(other.m_fd), m_mmaph(other.m_mmaph),
-        m_posix_advice(other.m_posix_advice) {
+        m_posix_advice(other.m_posix_advice), m_alignment(other.m_alignment) {
       other.m_fd = UPS_INVALID_FD;
 	  other.m_mmaph = UPS_INVALID_FD;
     }
@@ -79,21 +97,42 @@ class File
     // Assignment operator: moves ownership of the file handle
     File &operator=(File &&other) {
       m_fd = other.m_fd;
+      m_alignment = other.m_alignment;
       other.m_fd = UPS_INVALID_FD;
       return *this;
     }
 
-    // Creates a new file
-    void create(const char *filename, uint32_t mode);
+    // Creates a new file. If |direct_io| is true then the file bypasses
+    // the page cache of the operating system (O_DIRECT). Not supported
+    // on Win32.
+    void create(const char *filename, uint32_t mode, bool direct_io = false);
 
-    // Opens an existing file
-    void open(const char *filename, bool read_only);
+    // Opens an existing file; see |create()| for |direct_io|
+    void open(const char *filename, bool read_only, bool direct_io = false);
 
     // Returns true if the file is open
     bool is_open() const {
       return m_fd != UPS_INVALID_FD;
     }
 
+    // Returns the file handle
+    ups_fd_t fd() const {
+      return m_fd;
+    }
+
+    // Returns the alignment of offsets, sizes and buffers which is
+    // required by direct I/O, or 0 if the file does not use direct I/O
+    size_t direct_io_alignment() const {
+      return m_alignment;
+    }
+
+    // Returns true if |addr|, |buffer| and |len| fulfill the alignment
+    // which is required by direct I/O
+    bool is_aligned(uint64_t addr, const void *buffer, size_t len) const {
+      return m_alignment == 0
+          || ((addr | (uintptr_t)buffer | len) & (m_alignment - 1)) == 0;
+    }
+
     // Flushes a file
     void flush();
 
@@ -117,6 +156,10 @@ class File
     // Positional write to a file
     void pwrite(uint64_t addr, const void *buffer, size_t len);
 
+    // Positional write of several buffers to adjacent file offsets,
+    // starting at |addr| (vectored I/O)
+    void pwritev(uint64_t addr, const IoBuffer *buffers, size_t count);
+
     // Write data to a file; uses the current file position
     void write(const void *buffer, size_t len);
 
@@ -135,10 +178,24 @@ class File
     // Truncate/resize the file
     void truncate(uint64_t newsize);
 
+    // Reserves disk space till |size| bytes, and grows the file if it is
+    // smaller. Subsequent writes within this range do not extend the file.
+    // Falls back to |truncate()| if the OS cannot preallocate.
+    void allocate(uint64_t size);
+
     // Closes the file descriptor
     void close();
 
   private:
+    // Reads up to |len| bytes; returns less than |len| bytes only at the
+    // end of the file
+    size_t pread_some(uint64_t addr, void *buffer, size_t len);
+
+    // pread() and pwrite() for requests which are not aligned in direct
+    // I/O mode; they are redirected through an aligned buffer
+    void pread_unaligned(uint64_t addr, void *buffer, size_t len);
+    void pwrite_unaligned(uint64_t addr, const void *buffer, size_t len);
+
     // The file handle
     ups_fd_t m_fd;
 
@@ -148,10 +205,12 @@ class File
     // Parameter for posix_fadvise()
     int m_posix_advice;
 
-#ifdef WIN32
-	// A mutex; required for Win32
+    // The alignment for direct I/O; 0 if direct I/O is disabled
+    size_t m_alignment;
+
+	// A mutex; required for Win32, and for unaligned writes in direct I/O
+	// mode (which read and rewrite the surrounding blocks)
 	Mutex m_mutex;
-#endif
 };
 
 } // namespace upscaledb
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define UPS_HAVE_IO_URING 1
+#  endif
+#endif
+
+#ifdef UPS_HAVE_IO_URING
+#  include <errno.h>
+#  include <sched.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <linux/io_uring.h>
+#endif
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
+#include "1errorinducer/errorinducer.h"
+#include "1os/io_uring.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+IoUring::IoUring()
+  : m_fd(-1), m_entries(0), m_sq_ring(0), m_sq_ring_size(0), m_cq_ring(0),
+    m_cq_ring_size(0), m_sqes(0), m_sqes_size(0), m_sq_head(0), m_sq_tail(0),
+    m_sq_mask(0), m_sq_array(0), m_cq_head(0), m_cq_tail(0), m_cq_mask(0), m_cqes(0),
+    m_submissions(0)
+{
+}
+
+#ifdef UPS_HAVE_IO_URING
+
+static bool
+probe()
+{
+  IoUring ring;
+  return ring.open(2);
+}
+
+bool
+IoUring::is_supported()
+{
+  static bool supported = probe();
+  return supported;
+}
+
+bool
+IoUring::open(uint32_t entries)
+{
+  assert(!is_open());
+
+  struct io_uring_params params;
+  ::memset(&params, 0, sizeof(params));
+  int fd = (int)::syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0)
+    return false;
+  m_fd = fd;
+  m_entries = params.sq_entries;
+
+  m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cq_ring_size = params.cq_off.cqes
+                        + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    single_mmap = true;
+    if (m_cq_ring_size > m_sq_ring_size)
+      m_sq_ring_size = m_cq_ring_size;
+    m_cq_ring_size = 0;
+  }
+#endif
+
+  m_sq_ring = ::mmap(0, m_sq_ring_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+  if (m_sq_ring == MAP_FAILED) {
+    m_sq_ring = 0;
+    close();
+    return false;
+  }
+
+  if (single_mmap) {
+    m_cq_ring = m_sq_ring;
+  }
+  else {
+    m_cq_ring = ::mmap(0, m_cq_ring_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+    if (m_cq_ring == MAP_FAILED) {
+      m_cq_ring = 0;
+      close();
+      return false;
+    }
+  }
+
+  m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  m_sqes = ::mmap(0, m_sqes_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+  if (m_sqes == MAP_FAILED) {
+    m_sqes = 0;
+    close();
+    return false;
+  }
+
+  uint8_t *sq = (uint8_t *)m_sq_ring;
+  m_sq_head = (unsigned *)(sq + params.sq_off.head);
+  m_sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  m_sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  m_sq_array = (unsigned *)(sq + params.sq_off.array);
+
+  uint8_t *cq = (uint8_t *)m_cq_ring;
+  m_cq_head = (unsigned *)(cq + params.cq_off.head);
+  m_cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  m_cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  m_cqes = cq + params.cq_off.cqes;
+  return true;
+}
+
+void
+IoUring::close()
+{
+  if (m_sqes)
+    ::munmap(m_sqes, m_sqes_size);
+  if (m_cq_ring && m_cq_ring != m_sq_ring)
+    ::munmap(m_cq_ring, m_cq_ring_size);
+  if (m_sq_ring)
+    ::munmap(m_sq_ring, m_sq_ring_size);
+  if (m_fd != -1)
+    ::close(m_fd);
+  m_fd = -1;
+  m_sq_ring = m_cq_ring = m_sqes = m_cqes = 0;
+}
+
+void
+IoUring::enter(uint32_t to_submit, uint32_t min_complete)
+{
+  UPS_INDUCE_ERROR(ErrorInducer::kIoUringEnter);
+
+  while (true) {
+    int ret = (int)::syscall(__NR_io_uring_enter, m_fd, to_submit,
+                    min_complete, IORING_ENTER_GETEVENTS, 0, 0);
+    if (ret < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      ups_log(("io_uring_enter() failed with status %u (%s)", errno,
+                  strerror(errno)));
+      throw Exception(UPS_IO_ERROR);
+    }
+    // the wait was interrupted after all entries were submitted; the
+    // caller waits again
+    to_submit -= std::min(to_submit, (uint32_t)ret);
+    if (to_submit == 0)
+      return;
+  }
+}
+
+// Writes the remainder of a short write
+static int
+complete_write(ups_fd_t fd, const IoRequest &request, size_t written)
+{
+  while (written < request.length) {
+    ssize_t s = ::pwrite(fd, (uint8_t *)request.buffer + written,
+                    request.length - written, request.offset + written);
+    if (s < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    if (s == 0)
+      return EIO;
+    written += s;
+  }
+  return 0;
+}
+
+uint32_t
+IoUring::reap(ups_fd_t fd, const std::vector<IoRequest> &requests,
+                int *error)
+{
+  struct io_uring_cqe *cqes = (struct io_uring_cqe *)m_cqes;
+  uint32_t completed = 0;
+
+  unsigned head = *m_cq_head;
+  unsigned cq_tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != cq_tail; head++, completed++) {
+    struct io_uring_cqe *cqe = &cqes[head & *m_cq_mask];
+    const IoRequest &request = requests[(size_t)cqe->user_data];
+    int st = 0;
+    if (cqe->res < 0)
+      st = -cqe->res;
+    else if ((size_t)cqe->res < request.length)
+      st = complete_write(fd, request, (size_t)cqe->res);
+    if (st != 0 && *error == 0)
+      *error = st;
+  }
+  __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+  return completed;
+}
+
+void
+IoUring::drain(ups_fd_t fd, const std::vector<IoRequest> &requests,
+                uint32_t inflight)
+{
+  // the kernel only consumes entries in io_uring_enter(); entries beyond
+  // its head were not submitted and are removed from the queue
+  unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+  uint32_t discarded = *m_sq_tail - head;
+  __atomic_store_n(m_sq_tail, head, __ATOMIC_RELEASE);
+  inflight -= std::min(inflight, discarded);
+
+  int error = 0;
+  while (true) {
+    inflight -= std::min(inflight, reap(fd, requests, &error));
+    if (inflight == 0)
+      return;
+    try {
+      enter(0, 1);
+    }
+    catch (Exception &) {
+      // completions are also posted without io_uring_enter()
+      ::sched_yield();
+    }
+  }
+}
+
+void
+IoUring::pwrite(ups_fd_t fd, const std::vector<IoRequest> &requests)
+{
+  assert(is_open());
+
+  std::vector<struct iovec> iov(requests.size());
+  struct io_uring_sqe *sqes = (struct io_uring_sqe *)m_sqes;
+  size_t next = 0;
+  uint32_t inflight = 0;
+  int error = 0;
+
+  // do not return before all requests completed; the kernel still
+  // accesses the buffers of the pending requests
+  while (next < requests.size() || inflight > 0) {
+    uint32_t queued = 0;
+    unsigned tail = *m_sq_tail;
+    for (; next < requests.size() && inflight + queued < m_entries;
+                    next++, queued++, tail++) {
+      iov[next].iov_base = requests[next].buffer;
+      iov[next].iov_len = requests[next].length;
+
+      unsigned index = tail & *m_sq_mask;
+      struct io_uring_sqe *sqe = &sqes[index];
+      ::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->fd = fd;
+      sqe->addr = (uint64_t)(uintptr_t)&iov[next];
+      sqe->len = 1;
+      sqe->off = requests[next].offset;
+      sqe->user_data = next;
+      m_sq_array[index] = index;
+    }
+    if (queued > 0) {
+      __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+      m_submissions++;
+    }
+
+    try {
+      enter(queued, 1);
+    }
+    catch (Exception &) {
+      // |iov| and the buffers must stay valid till the kernel completed
+      // the submitted requests
+      drain(fd, requests, inflight + queued);
+      throw;
+    }
+    inflight += queued;
+    inflight -= reap(fd, requests, &error);
+  }
+
+  if (error != 0) {
+    ups_log(("io_uring write failed with status %u (%s)", error,
+                strerror(error)));
+    throw Exception(UPS_IO_ERROR);
+  }
+}
+
+#else // !UPS_HAVE_IO_URING
+
+bool
+IoUring::is_supported()
+{
+  return false;
+}
+
+bool
+IoUring::open(uint32_t)
+{
+  return false;
+}
+
+void
+IoUring::close()
+{
+}
+
+void
+IoUring::enter(uint32_t, uint32_t)
+{
+}
+
+void
+IoUring::pwrite(ups_fd_t, const std::vector<IoRequest> &)
+{
+  throw Exception(UPS_NOT_IMPLEMENTED);
+}
+
+#endif // UPS_HAVE_IO_URING
+
+} // namespace upscaledb
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A minimal wrapper around a Linux io_uring instance, based on the raw
+ * system calls (liburing is not required). Submits a batch of positional
+ * writes with a single system call and waits till all of them completed.
+ *
+ * On other platforms (or if the kernel does not support io_uring),
+ * |is_supported()| returns false and |open()| fails.
+ *
+ * @exception_safe: basic
+ * @thread_safe: no
+ */
+
+#ifndef UPS_IO_URING_H
+#define UPS_IO_URING_H
+
+#include "0root/root.h"
+
+#include <vector>
+
+#include "ups/types.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1os/os.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+// A single positional write which is submitted to the IoUring
+struct IoRequest
+{
+  IoRequest(uint64_t offset_ = 0, void *buffer_ = 0, size_t length_ = 0)
+    : offset(offset_), buffer(buffer_), length(length_) {
+  }
+
+  // The file offset
+  uint64_t offset;
+
+  // The data
+  void *buffer;
+
+  // The size of the data
+  size_t length;
+};
+
+class IoUring
+{
+  public:
+    // The default number of entries of the submission queue
+    enum { kQueueDepth = 128 };
+
+    // Constructor; the ring is not yet set up
+    IoUring();
+
+    // Destructor; closes the ring
+    ~IoUring() {
+      close();
+    }
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    // Returns true if io_uring was compiled in and is supported by the
+    // running kernel
+    static bool is_supported();
+
+    // Sets up the ring with |entries| submission queue entries. Returns
+    // false if io_uring is not available.
+    bool open(uint32_t entries = kQueueDepth);
+
+    // Returns true if the ring was set up
+    bool is_open() const {
+      return m_fd != -1;
+    }
+
+    // Releases the ring
+    void close();
+
+    // Writes all |requests| to |fd| and waits till they completed. Short
+    // writes are completed synchronously. Throws UPS_IO_ERROR on failure.
+    void pwrite(ups_fd_t fd, const std::vector<IoRequest> &requests);
+
+    // Returns the number of batches which were submitted
+    uint64_t submissions() const {
+      return m_submissions;
+    }
+
+  private:
+    // Submits |to_submit| entries and waits for |min_complete| completions
+    void enter(uint32_t to_submit, uint32_t min_complete);
+
+    // Processes the available completions of |requests|. Short writes are
+    // completed synchronously; the first error is stored in |error|.
+    // Returns the number of completions.
+    uint32_t reap(ups_fd_t fd, const std::vector<IoRequest> &requests,
+                    int *error);
+
+    // Discards the entries which were queued but not submitted, and waits
+    // till the |inflight| submitted requests completed. Called before an
+    // exception is propagated, because the kernel still accesses the
+    // buffers of the submitted requests. Does not throw.
+    void drain(ups_fd_t fd, const std::vector<IoRequest> &requests,
+                    uint32_t inflight);
+
+    // The file descriptor of the ring
+    int m_fd;
+
+    // The number of submission queue entries
+    uint32_t m_entries;
+
+    // The mapped submission queue, completion queue and submission
+    // queue entries, and their sizes
+    void *m_sq_ring;
+    size_t m_sq_ring_size;
+    void *m_cq_ring;
+    size_t m_cq_ring_size;
+    void *m_sqes;
+    size_t m_sqes_size;
+
+    // Pointers into the mapped rings
+    unsigned *m_sq_head;
+    unsigned *m_sq_tail;
+    unsigned *m_sq_mask;
+    unsigned *m_sq_array;
+    unsigned *m_cq_head;
+    unsigned *m_cq_tail;
+    unsigned *m_cq_mask;
+    void *m_cqes;
+
+    // The number of batches which were submitted
+    uint64_t m_submissions;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_IO_URING_H */
@@ -66,6 +66,20 @@ typedef SOCKET             ups_socket_t;
 extern bool
 os_has_avx();
 
+// Allocates |size| bytes of anonymous memory, aligned to the page size of
+// the operating system. If |huge_pages| is true then the operating system
+// is asked to back the memory with huge pages. Throws UPS_OUT_OF_MEMORY.
+extern void *
+os_alloc_pages(size_t size, bool huge_pages);
+
+// Releases memory which was allocated with |os_alloc_pages()|
+extern void
+os_free_pages(void *ptr, size_t size);
+
+// Deletes a file; returns false if it does not exist or cannot be deleted
+extern bool
+os_unlink(const char *path);
+
 } // namespace upscaledb
 
 #endif /* UPS_OS_H */
@@ -22,13 +22,21 @@
 #include "0root/root.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <algorithm>
 #if HAVE_MMAP
 #  include <sys/mman.h>
 #endif
 #if HAVE_WRITEV
 #  include <sys/uio.h>
+#  if defined(__linux__) || defined(__FreeBSD__)
+#    define UPS_HAVE_PWRITEV 1
+#  endif
+#endif
+#if defined(__linux__) || defined(__FreeBSD__)
+#  define UPS_HAVE_POSIX_FALLOCATE 1
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -43,6 +51,7 @@
 #include "1base/error.h"
 #include "1errorinducer/errorinducer.h"
 #include "1os/file.h"
+#include "1os/os.h"
 #include "1os/socket.h"
 
 #ifndef UPS_ROOT_H
@@ -95,6 +104,46 @@ enable_largefile(int fd)
 #endif
 }
 
+// Opens a file; with |direct_io|, the page cache of the operating system is
+// bypassed. Falls back to buffered I/O if the file system does not support
+// O_DIRECT. Returns the alignment which is required for direct I/O in
+// |alignment|.
+static ups_fd_t
+open_file(const char *filename, int osflags, uint32_t mode, bool direct_io,
+                size_t *alignment)
+{
+  *alignment = 0;
+
+#ifdef O_DIRECT
+  if (direct_io) {
+    ups_fd_t fd = ::open(filename, osflags | O_DIRECT, mode);
+    if (fd >= 0) {
+      // O_DIRECT requires the logical block size of the device; the
+      // preferred I/O size of the file system is a multiple of it
+      struct stat st;
+      *alignment = File::kMaxDirectIoAlignment;
+      if (::fstat(fd, &st) == 0 && st.st_blksize >= 512
+              && st.st_blksize <= File::kMaxDirectIoAlignment
+              && (st.st_blksize & (st.st_blksize - 1)) == 0)
+        *alignment = (size_t)st.st_blksize;
+      return fd;
+    }
+    if (errno != EINVAL)
+      return fd;
+    ups_log(("O_DIRECT is not supported for file %s, using buffered I/O",
+                filename));
+  }
+#endif
+
+  ups_fd_t fd = ::open(filename, osflags, mode);
+#if defined(__APPLE__) && defined(F_NOCACHE)
+  // Mac OS X has no O_DIRECT, but F_NOCACHE does not require alignment
+  if (fd >= 0 && direct_io)
+    (void)::fcntl(fd, F_NOCACHE, 1);
+#endif
+  return fd;
+}
+
 static void
 os_read(ups_fd_t fd, uint8_t *buffer, size_t len)
 {
@@ -218,13 +267,10 @@ File::munmap(void *buffer, size_t size)
 #endif
 }
 
-void
-File::pread(uint64_t addr, void *buffer, size_t len)
+size_t
+File::pread_some(uint64_t addr, void *buffer, size_t len)
 {
-  os_log(("File::pread: fd=%d, address=%lld, size=%lld", m_fd, addr, len));
-
-#if HAVE_PREAD
-  int r;
+  ssize_t r;
   size_t total = 0;
 
   while (total < len) {
@@ -239,6 +285,83 @@ File::pread(uint64_t addr, void *buffer, size_t len)
       break;
     total += r;
   }
+  return total;
+}
+
+void
+File::pread_unaligned(uint64_t addr, void *buffer, size_t len)
+{
+  uint64_t start = addr & ~((uint64_t)m_alignment - 1);
+  uint64_t end = (addr + len + m_alignment - 1) & ~((uint64_t)m_alignment - 1);
+  size_t size = (size_t)(end - start);
+  uint8_t *p = (uint8_t *)os_alloc_pages(size, false);
+
+  size_t total = 0;
+  try {
+    total = pread_some(start, p, size);
+  }
+  catch (Exception &) {
+    os_free_pages(p, size);
+    throw;
+  }
+
+  if (total < addr - start + len) {
+    os_free_pages(p, size);
+    ups_log(("File::pread() failed with short read (%s)", strerror(errno)));
+    throw Exception(UPS_IO_ERROR);
+  }
+
+  ::memcpy(buffer, p + (addr - start), len);
+  os_free_pages(p, size);
+}
+
+void
+File::pwrite_unaligned(uint64_t addr, const void *buffer, size_t len)
+{
+  uint64_t start = addr & ~((uint64_t)m_alignment - 1);
+  uint64_t end = (addr + len + m_alignment - 1) & ~((uint64_t)m_alignment - 1);
+  size_t size = (size_t)(end - start);
+  uint8_t *p = (uint8_t *)os_alloc_pages(size, false);
+
+  // read the partially overwritten blocks; concurrent writes to the same
+  // blocks would get lost, therefore the whole cycle is serialized
+  ScopedLock lock(m_mutex);
+  try {
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+      ups_log(("fstat failed with status %u (%s)", errno, strerror(errno)));
+      throw Exception(UPS_IO_ERROR);
+    }
+
+    size_t total = pread_some(start, p, size);
+    ::memset(p + total, 0, size - total);
+    ::memcpy(p + (addr - start), buffer, len);
+    pwrite(start, p, size);
+
+    // the padding of the last block must not grow the file
+    uint64_t new_size = std::max((uint64_t)st.st_size, addr + len);
+    if (end > new_size)
+      truncate(new_size);
+  }
+  catch (Exception &) {
+    os_free_pages(p, size);
+    throw;
+  }
+  os_free_pages(p, size);
+}
+
+void
+File::pread(uint64_t addr, void *buffer, size_t len)
+{
+  os_log(("File::pread: fd=%d, address=%lld, size=%lld", m_fd, addr, len));
+
+#if HAVE_PREAD
+  if (unlikely(!is_aligned(addr, buffer, len))) {
+    pread_unaligned(addr, buffer, len);
+    return;
+  }
+
+  size_t total = pread_some(addr, buffer, len);
 
   if (total != len) {
     ups_log(("File::pread() failed with short read (%s)", strerror(errno)));
@@ -256,11 +379,17 @@ File::pwrite(uint64_t addr, const void *buffer, size_t len)
   os_log(("File::pwrite: fd=%d, address=%lld, size=%lld", m_fd, addr, len));
 
 #if HAVE_PWRITE
+  if (unlikely(!is_aligned(addr, buffer, len))) {
+    pwrite_unaligned(addr, buffer, len);
+    return;
+  }
+
   ssize_t s;
   size_t total = 0;
 
   while (total < len) {
-    s = ::pwrite(m_fd, buffer, len, addr + total);
+    s = ::pwrite(m_fd, (const uint8_t *)buffer + total, len - total,
+                    addr + total);
     if (s < 0) {
       ups_log(("pwrite() failed with status %u (%s)", errno, strerror(errno)));
       throw Exception(UPS_IO_ERROR);
@@ -280,6 +409,67 @@ File::pwrite(uint64_t addr, const void *buffer, size_t len)
 #endif
 }
 
+void
+File::pwritev(uint64_t addr, const IoBuffer *buffers, size_t count)
+{
+  os_log(("File::pwritev: fd=%d, address=%lld, count=%lld", m_fd, addr,
+              count));
+
+#if UPS_HAVE_PWRITEV
+  // with direct I/O, unaligned buffers are written one by one
+  bool aligned = is_aligned(addr, 0, 0);
+  for (size_t i = 0; i < count && aligned; i++)
+    aligned = is_aligned(0, buffers[i].data, buffers[i].size);
+
+  if (likely(aligned)) {
+    enum { kMaxIoVectors = 64 };
+    struct iovec iov[kMaxIoVectors];
+
+    while (count > 0) {
+      int left = (int)std::min(count, (size_t)kMaxIoVectors);
+      for (int i = 0; i < left; i++) {
+        iov[i].iov_base = (void *)buffers[i].data;
+        iov[i].iov_len = buffers[i].size;
+      }
+      buffers += left;
+      count -= left;
+
+      struct iovec *v = &iov[0];
+      while (left > 0) {
+        ssize_t s = ::pwritev(m_fd, v, left, addr);
+        if (s < 0) {
+          if (errno == EINTR)
+            continue;
+          ups_log(("pwritev() failed with status %u (%s)", errno,
+                      strerror(errno)));
+          throw Exception(UPS_IO_ERROR);
+        }
+        if (s == 0) {
+          ups_log(("pwritev() failed with short write"));
+          throw Exception(UPS_IO_ERROR);
+        }
+        addr += s;
+
+        // skip the buffers which were written completely
+        while (left > 0 && (size_t)s >= v->iov_len) {
+          s -= v->iov_len;
+          v++;
+          left--;
+        }
+        if (left > 0) {
+          v->iov_base = (uint8_t *)v->iov_base + s;
+          v->iov_len -= s;
+        }
+      }
+    }
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < count; addr += buffers[i].size, i++)
+    pwrite(addr, buffers[i].data, buffers[i].size);
+}
+
 void
 File::write(const void *buffer, size_t len)
 {
@@ -323,14 +513,34 @@ File::truncate(uint64_t newsize)
 }
 
 void
-File::create(const char *filename, uint32_t mode)
+File::allocate(uint64_t size)
+{
+  os_log(("File::allocate: fd=%d, size=%lld", m_fd, size));
+  if (file_size() >= size)
+    return;
+#if UPS_HAVE_POSIX_FALLOCATE
+  int st = ::posix_fallocate(m_fd, 0, size);
+  if (st == 0)
+    return;
+  // not supported by the file system; use a sparse file instead
+  if (st != EINVAL && st != EOPNOTSUPP) {
+    ups_log(("posix_fallocate failed with status %d (%s)", st, strerror(st)));
+    throw Exception(UPS_IO_ERROR);
+  }
+#endif
+  truncate(size);
+}
+
+void
+File::create(const char *filename, uint32_t mode, bool direct_io)
 {
   int osflags = O_CREAT | O_RDWR | O_TRUNC;
 #if HAVE_O_NOATIME
   osflags |= O_NOATIME;
 #endif
 
-  ups_fd_t fd = ::open(filename, osflags, mode ? mode : 0644);
+  ups_fd_t fd = open_file(filename, osflags, mode ? mode : 0644, direct_io,
+                  &m_alignment);
   if (fd < 0) {
     ups_log(("creating file %s failed with status %u (%s)", filename,
         errno, strerror(errno)));
@@ -364,7 +574,7 @@ File::flush()
 }
 
 void
-File::open(const char *filename, bool read_only)
+File::open(const char *filename, bool read_only, bool direct_io)
 {
   int osflags = 0;
 
@@ -376,7 +586,7 @@ File::open(const char *filename, bool read_only)
   osflags |= O_NOATIME;
 #endif
 
-  ups_fd_t fd = ::open(filename, osflags);
+  ups_fd_t fd = open_file(filename, osflags, 0, direct_io, &m_alignment);
   if (fd < 0) {
     ups_log(("opening file %s failed with status %u (%s)", filename,
         errno, strerror(errno)));
@@ -475,4 +685,45 @@ Socket::close()
   }
 }
 
+void *
+os_alloc_pages(size_t size, bool huge_pages)
+{
+#if HAVE_MMAP && defined(MAP_ANONYMOUS)
+  void *p = ::mmap(0, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    ups_log(("mmap failed with status %d (%s)", errno, strerror(errno)));
+    throw Exception(UPS_OUT_OF_MEMORY);
+  }
+#  if HAVE_MADVISE && defined(MADV_HUGEPAGE)
+  // only a hint; the kernel falls back to regular pages
+  if (huge_pages)
+    (void)::madvise(p, size, MADV_HUGEPAGE);
+#  endif
+  return p;
+#else
+  void *p = 0;
+  if (::posix_memalign(&p, (size_t)::getpagesize(), size) != 0)
+    throw Exception(UPS_OUT_OF_MEMORY);
+  return p;
+#endif
+}
+
+void
+os_free_pages(void *ptr, size_t size)
+{
+#if HAVE_MMAP && defined(MAP_ANONYMOUS)
+  if (::munmap(ptr, size) != 0)
+    ups_log(("munmap failed with status %d (%s)", errno, strerror(errno)));
+#else
+  ::free(ptr);
+#endif
+}
+
+bool
+os_unlink(const char *path)
+{
+  return ::unlink(path) == 0;
+}
+
 } // namespace upscaledb
@@ -29,6 +29,7 @@
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
 #include "1os/file.h"
+#include "1os/os.h"
 #include "1os/socket.h"
 
 #ifndef UPS_ROOT_H
@@ -231,6 +232,13 @@ File::pwrite(uint64_t addr, const void *buffer, size_t len)
     throw Exception(UPS_IO_ERROR);
 }
 
+void
+File::pwritev(uint64_t addr, const IoBuffer *buffers, size_t count)
+{
+  for (size_t i = 0; i < count; addr += buffers[i].size, i++)
+    pwrite(addr, buffers[i].data, buffers[i].size);
+}
+
 void
 File::write(const void *buffer, size_t len)
 {
@@ -330,7 +338,15 @@ File::truncate(uint64_t newsize)
 }
 
 void
-File::create(const char *filename, uint32_t mode)
+File::allocate(uint64_t size)
+{
+  // NTFS allocates the clusters when the end of file is moved
+  if (file_size() < size)
+    truncate(size);
+}
+
+void
+File::create(const char *filename, uint32_t mode, bool direct_io)
 {
   ups_status_t st;
   DWORD share = 0; /* 1.1.0: default behaviour is exclusive locking */
@@ -384,7 +400,7 @@ File::flush()
 }
 
 void
-File::open(const char *filename, bool read_only)
+File::open(const char *filename, bool read_only, bool direct_io)
 {
   ups_status_t st;
   DWORD share = 0; /* 1.1.0: default behaviour is exclusive locking */
@@ -552,4 +568,40 @@ Socket::close()
   }
 }
 
+void *
+os_alloc_pages(size_t size, bool huge_pages)
+{
+  // large pages require the SeLockMemoryPrivilege; |huge_pages| is ignored
+  void *p = ::VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (!p) {
+    ups_log(("VirtualAlloc failed with OS status %u", GetLastError()));
+    throw Exception(UPS_OUT_OF_MEMORY);
+  }
+  return p;
+}
+
+void
+os_free_pages(void *ptr, size_t size)
+{
+  if (!::VirtualFree(ptr, 0, MEM_RELEASE))
+    ups_log(("VirtualFree failed with OS status %u", GetLastError()));
+}
+
+bool
+os_unlink(const char *path)
+{
+#ifdef UNICODE
+  int fnameWlen = calc_wlen4str(path);
+  WCHAR *wpath = (WCHAR *)malloc(fnameWlen * sizeof(wpath[0]));
+  if (!wpath)
+    throw Exception(UPS_OUT_OF_MEMORY);
+  utf8_string(path, wpath, fnameWlen);
+  BOOL ok = ::DeleteFileW(wpath);
+  free(wpath);
+  return ok != 0;
+#else
+  return ::DeleteFileA(path) != 0;
+#endif
+}
+
 } // namespace upscaledb
@@ -30,6 +30,7 @@
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/dynamic_array.h"
+#include "1base/error.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -72,6 +73,33 @@ struct Compressor {
   virtual void decompress(const uint8_t *inp, uint32_t inlength,
                   uint32_t outlength, uint8_t *destination) = 0;
 
+  // Returns true if the compressor supports preset dictionaries (see
+  // compress_with_dictionary())
+  virtual bool supports_dictionary() const {
+    return false;
+  }
+
+  // Compresses |inlength| bytes of data in |inp|, using the |dictlength|
+  // bytes in |dict| as a preset dictionary. Small inputs compress much
+  // better if the dictionary contains similar data. The same dictionary
+  // is required for decompression.
+  //
+  // Returns the length of the compressed data.
+  virtual uint32_t compress_with_dictionary(const uint8_t *inp,
+                  uint32_t inlength, const uint8_t *dict,
+                  uint32_t dictlength) {
+    throw Exception(UPS_NOT_IMPLEMENTED);
+  }
+
+  // Decompresses |inlength| bytes of data in |inp|, which were compressed
+  // with compress_with_dictionary(). |outlength| is the expected size of
+  // the decompressed data. Uses the caller's |arena| for storage.
+  virtual void decompress_with_dictionary(const uint8_t *inp,
+                  uint32_t inlength, uint32_t outlength, const uint8_t *dict,
+                  uint32_t dictlength, ByteArray *arena) {
+    throw Exception(UPS_NOT_IMPLEMENTED);
+  }
+
   // Reserves |n| bytes in the output buffer; can be used by the caller
   // to insert flags or sizes
   void reserve(int n) {
@@ -138,6 +166,35 @@ struct CompressorImpl : public Compressor
   T impl;
 };
 
+// A compressor whose implementation also supports preset dictionaries
+template<typename T>
+struct DictionaryCompressorImpl : public CompressorImpl<T>
+{
+  // Returns true; dictionaries are supported
+  virtual bool supports_dictionary() const {
+    return true;
+  }
+
+  // Compresses |inlength| bytes of data in |inp| with a preset dictionary
+  virtual uint32_t compress_with_dictionary(const uint8_t *inp,
+                  uint32_t inlength, const uint8_t *dict,
+                  uint32_t dictlength) {
+    int skip = this->skip;
+    this->arena.resize(skip + this->impl.compressed_length(inlength));
+    return this->impl.compress(inp, inlength, dict, dictlength,
+                    this->arena.data() + skip, this->arena.size() - skip);
+  }
+
+  // Decompresses data which was compressed with a preset dictionary
+  virtual void decompress_with_dictionary(const uint8_t *inp,
+                  uint32_t inlength, uint32_t outlength, const uint8_t *dict,
+                  uint32_t dictlength, ByteArray *arena) {
+    arena->resize(outlength);
+    this->impl.decompress(inp, inlength, dict, dictlength, arena->data(),
+                    outlength);
+  }
+};
+
 }; // namespace upscaledb
 
 #endif // UPS_COMPRESSOR_H
@@ -72,7 +72,7 @@ CompressorFactory::create(int type)
   switch (type) {
     case UPS_COMPRESSOR_ZLIB:
 #ifdef HAVE_ZLIB_H
-      return new CompressorImpl<ZlibCompressor>();
+      return new DictionaryCompressorImpl<ZlibCompressor>();
 #else
       ups_log(("upscaledb was built without support for zlib compression"));
       throw Exception(UPS_INV_PARAMETER);
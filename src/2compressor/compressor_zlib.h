@@ -30,6 +30,7 @@
 
 #include "0root/root.h"
 
+#include <string.h>
 #include <zlib.h>
 
 #include "2compressor/compressor.h"
@@ -37,6 +38,17 @@
 namespace upscaledb {
 
 struct ZlibCompressor {
+  ZlibCompressor()
+    : deflate_initialized(false), inflate_initialized(false) {
+  }
+
+  ~ZlibCompressor() {
+    if (deflate_initialized)
+      ::deflateEnd(&deflate_stream);
+    if (inflate_initialized)
+      ::inflateEnd(&inflate_stream);
+  }
+
   uint32_t compressed_length(uint32_t length) {
     return ::compressBound(length);
   }
@@ -59,6 +71,74 @@ struct ZlibCompressor {
     if (zret != 0)
       throw Exception(UPS_INTERNAL_ERROR);
   }
+
+  // Compresses with a preset dictionary. The output is a raw deflate
+  // stream without zlib header and checksum; these would add 10 bytes
+  // to each (usually small) input. The streams are reused, therefore
+  // their buffers are only allocated once.
+  uint32_t compress(const uint8_t *inp, uint32_t inlength,
+                  const uint8_t *dict, uint32_t dictlength,
+                  uint8_t *outp, uint32_t outlength) {
+    int zret;
+    if (!deflate_initialized) {
+      ::memset(&deflate_stream, 0, sizeof(deflate_stream));
+      zret = ::deflateInit2(&deflate_stream, Z_DEFAULT_COMPRESSION,
+                      Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+      if (zret != Z_OK)
+        throw Exception(UPS_INTERNAL_ERROR);
+      deflate_initialized = true;
+    }
+    else if (::deflateReset(&deflate_stream) != Z_OK)
+      throw Exception(UPS_INTERNAL_ERROR);
+
+    if (::deflateSetDictionary(&deflate_stream, (const Bytef *)dict,
+                dictlength) != Z_OK)
+      throw Exception(UPS_INTERNAL_ERROR);
+
+    deflate_stream.next_in = (Bytef *)inp;
+    deflate_stream.avail_in = inlength;
+    deflate_stream.next_out = (Bytef *)outp;
+    deflate_stream.avail_out = outlength;
+    if (::deflate(&deflate_stream, Z_FINISH) != Z_STREAM_END)
+      throw Exception(UPS_INTERNAL_ERROR);
+    return outlength - deflate_stream.avail_out;
+  }
+
+  // Decompresses data which was compressed with a preset dictionary
+  void decompress(const uint8_t *inp, uint32_t inlength,
+                  const uint8_t *dict, uint32_t dictlength,
+                  uint8_t *outp, uint32_t outlength) {
+    int zret;
+    if (!inflate_initialized) {
+      ::memset(&inflate_stream, 0, sizeof(inflate_stream));
+      if (::inflateInit2(&inflate_stream, -MAX_WBITS) != Z_OK)
+        throw Exception(UPS_INTERNAL_ERROR);
+      inflate_initialized = true;
+    }
+    else if (::inflateReset(&inflate_stream) != Z_OK)
+      throw Exception(UPS_INTERNAL_ERROR);
+
+    // a raw stream accepts the dictionary before the first input
+    if (::inflateSetDictionary(&inflate_stream, (const Bytef *)dict,
+                dictlength) != Z_OK)
+      throw Exception(UPS_INTERNAL_ERROR);
+
+    inflate_stream.next_in = (Bytef *)inp;
+    inflate_stream.avail_in = inlength;
+    inflate_stream.next_out = (Bytef *)outp;
+    inflate_stream.avail_out = outlength;
+    zret = ::inflate(&inflate_stream, Z_FINISH);
+    if (zret != Z_STREAM_END || inflate_stream.avail_out != 0)
+      throw Exception(UPS_INTERNAL_ERROR);
+  }
+
+  // Stream for compress() with a dictionary
+  z_stream deflate_stream;
+  bool deflate_initialized;
+
+  // Stream for decompress() with a dictionary
+  z_stream inflate_stream;
+  bool inflate_initialized;
 };
 
 }; // namespace upscaledb;
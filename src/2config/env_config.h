@@ -45,6 +45,15 @@ namespace upscaledb {
 
 struct EnvConfig
 {
+  // The algorithms for the page checksums
+  enum {
+    // MurmurHash3; used by older files, which leave the header field 0
+    kChecksumMurmurHash3 = 0,
+
+    // the default for new files
+    kChecksumCrc32c = 1
+  };
+
   // Constructor initializes with default values
   EnvConfig()
     : flags(0), file_mode(0644), max_databases(0),
@@ -53,7 +62,16 @@ struct EnvConfig
       file_size_limit_bytes(std::numeric_limits<size_t>::max()), 
       remote_timeout_sec(0), journal_compressor(0),
       is_encryption_enabled(false), journal_switch_threshold(0),
-      posix_advice(UPS_POSIX_FADVICE_NORMAL) {
+      journal_segments(0), journal_segment_size(0),
+      journal_checkpoint_size(0), journal_dictionary_size(0),
+      journal_group_commit_delay(0), journal_group_commit_size(0),
+      posix_advice(UPS_POSIX_FADVICE_NORMAL), select_threads(0),
+      flush_threads(1), cache_policy(UPS_CACHE_POLICY_LRU),
+      read_ahead_pages(32), cache_internal_nodes_percent(10),
+      shared_cache_size_bytes(0), shared_cache_weight(1),
+      compressed_cache_size_bytes(0),
+      compressed_cache_compressor(UPS_COMPRESSOR_LZF), recovery_threads(0),
+      page_checksum(kChecksumMurmurHash3) {
   }
 
   // the environment's flags
@@ -95,8 +113,60 @@ struct EnvConfig
   // threshold for switching journal files
   size_t journal_switch_threshold;
 
+  // number of journal segments (0: the default)
+  uint32_t journal_segments;
+
+  // size of each journal segment; 0 if the segments are not preallocated
+  uint64_t journal_segment_size;
+
+  // journal bytes which trigger a checkpoint; 0: only at segment switches
+  uint64_t journal_checkpoint_size;
+
+  // size of the dictionary for journal compression; 0 if disabled
+  uint32_t journal_dictionary_size;
+
+  // max. delay (in microseconds) before a group commit is fsync'd
+  uint32_t journal_group_commit_delay;
+
+  // number of commits which trigger a group commit
+  uint32_t journal_group_commit_size;
+
   // parameter for posix_fadvise()
   int posix_advice;
+
+  // number of threads for parallel UQI scans (0: one per core)
+  uint32_t select_threads;
+
+  // number of threads which flush dirty pages
+  uint32_t flush_threads;
+
+  // the replacement policy of the cache (UPS_CACHE_POLICY_*)
+  int cache_policy;
+
+  // maximum number of leaf pages which are read ahead
+  uint32_t read_ahead_pages;
+
+  // percentage of the cache which is reserved for internal btree nodes
+  uint32_t cache_internal_nodes_percent;
+
+  // capacity of the process-wide shared cache; 0 if the cache is not shared
+  uint64_t shared_cache_size_bytes;
+
+  // the weight of this Environment in the shared cache
+  uint32_t shared_cache_weight;
+
+  // capacity of the compressed cache; 0 if it is disabled
+  uint64_t compressed_cache_size_bytes;
+
+  // the compressor of the compressed cache (UPS_COMPRESSOR_*)
+  int compressed_cache_compressor;
+
+  // number of threads which restore pages during recovery (0: one per core)
+  uint32_t recovery_threads;
+
+  // the algorithm of the page checksums (UPS_ENABLE_CRC32); read from the
+  // header of the file
+  int page_checksum;
 };
 
 } // namespace upscaledb
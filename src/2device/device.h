@@ -29,9 +29,12 @@
 
 #include "0root/root.h"
 
+#include <vector>
+
 #include "ups/upscaledb.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1os/file.h"
 #include "2config/env_config.h"
 
 #ifndef UPS_ROOT_H
@@ -90,6 +93,24 @@ struct Device {
   // Writes to the device; this function does not use mmap
   virtual void write(uint64_t offset, void *buffer, size_t len) = 0;
 
+  // Writes several buffers to adjacent offsets, starting at |offset|, with
+  // a single (vectored) write; this function does not use mmap
+  virtual void writev(uint64_t offset, const IoBuffer *buffers,
+                  size_t count) = 0;
+
+  // Returns true if the device writes several pages with a single
+  // submission (see |write_pages|)
+  virtual bool supports_batched_writes() const {
+    return false;
+  }
+
+  // Writes several dirty pages with a single submission and marks them as
+  // flushed. Returns false if this is not supported; the caller then
+  // writes the pages one by one.
+  virtual bool write_pages(std::vector<Page *> &pages) {
+    return false;
+  }
+
   // Allocate storage from this device; this function
   // will *NOT* use mmap. returns the offset of the allocated storage.
   virtual uint64_t alloc(size_t len) = 0;
@@ -21,14 +21,20 @@
  * for most operations, but currently it's possible that the Page is modified
  * if DiskDevice::read_page fails in the middle.
  *
+ * Reads and writes use positional I/O and do not hold the lock; it only
+ * protects the file size, the mappings and the excess storage at the end
+ * of the file.
+ *
  * @exception_safe: basic/strong
- * @thread_safe: no
+ * @thread_safe: yes
  */
 
 #ifndef UPS_DEVICE_DISK_H
 #define UPS_DEVICE_DISK_H
 
 #include <utility>
+#include <algorithm>
+#include <boost/atomic.hpp>
 
 #include "0root/root.h"
 
@@ -36,6 +42,7 @@
 #include "1base/error.h"
 #include "1base/dynamic_array.h"
 #include "1mem/mem.h"
+#include "1mem/page_pool.h"
 #include "1os/file.h"
 #ifdef UPS_ENABLE_ENCRYPTION
 #  include "2aes/aes.h"
@@ -82,9 +89,30 @@ class DiskDevice : public Device {
       }
     };
 
+    // A file range which was mapped when the file grew
+    struct Mapping {
+      // the file offset of the mapped range
+      uint64_t offset;
+
+      // the size of the mapped range
+      uint64_t size;
+
+      // pointer to the mapped data
+      uint8_t *ptr;
+    };
+
+    enum {
+      // The max. number of mappings which are added when the file grows
+      kMaxMappings = 64,
+
+      // The minimum file size and the minimum size of a new mapping
+      kMinMappingGrowth = 1024 * 1024
+    };
+
   public:
     DiskDevice(const EnvConfig &config)
-      : Device(config) {
+      : Device(config), m_page_pool(0), m_mapping_count(0), m_mapped_end(0),
+        m_grow_mapping(false) {
       State state;
       state.mmapptr = 0;
       state.mapped_size = 0;
@@ -98,9 +126,12 @@ class DiskDevice : public Device {
       ScopedSpinlock lock(m_mutex);
 
       File file;
-      file.create(config.filename.c_str(), config.file_mode);
+      file.create(config.filename.c_str(), config.file_mode,
+                      ISSET(config.flags, UPS_ENABLE_DIRECT_IO));
       file.set_posix_advice(config.posix_advice);
       m_state.file = std::move(file);
+
+      enable_mapping_growth(false);
     }
 
     // opens an existing device
@@ -112,7 +143,8 @@ class DiskDevice : public Device {
       ScopedSpinlock lock(m_mutex);
 
       State state = std::move(m_state);
-      state.file.open(config.filename.c_str(), read_only);
+      state.file.open(config.filename.c_str(), read_only,
+                      ISSET(config.flags, UPS_ENABLE_DIRECT_IO));
       state.file.set_posix_advice(config.posix_advice);
 
       // the file size which backs the mapped ptr
@@ -125,10 +157,11 @@ class DiskDevice : public Device {
 
       // make sure we do not exceed the "real" size of the file, otherwise
       // we crash when accessing memory which exceeds the mapping (at least
-      // on Win32)
+      // on Win32). The mapping is added later, when the file grows.
       size_t granularity = File::granularity();
       if (state.file_size == 0 || state.file_size % granularity) {
         swap(m_state, state);
+        enable_mapping_growth(read_only);
         return;
       }
 
@@ -139,8 +172,13 @@ class DiskDevice : public Device {
       catch (Exception &ex) {
         ups_log(("mmap failed with error %d, falling back to read/write",
                     ex.code));
+        state.mapped_size = 0;
+        swap(m_state, state);
+        return;
       }
       swap(m_state, state);
+      m_mapped_end = m_state.mapped_size;
+      enable_mapping_growth(read_only);
     }
 
     // returns true if the device is open
@@ -152,6 +190,12 @@ class DiskDevice : public Device {
     // closes the device
     virtual void close() {
       ScopedSpinlock lock(m_mutex);
+      m_grow_mapping = false;
+      m_mapped_end = 0;
+      for (uint32_t i = 0; i < m_mapping_count; i++)
+        m_state.file.munmap(m_mappings[i].ptr, m_mappings[i].size);
+      m_mapping_count = 0;
+
       State state = std::move(m_state);
       if (state.mmapptr)
         state.file.munmap(state.mmapptr, state.mapped_size);
@@ -160,9 +204,8 @@ class DiskDevice : public Device {
       swap(m_state, state);
     }
 
-    // flushes the device
+    // flushes the device; fsync() does not require the lock
     virtual void flush() {
-      ScopedSpinlock lock(m_mutex);
       m_state.file.flush();
     }
 
@@ -193,7 +236,11 @@ class DiskDevice : public Device {
 
     // reads from the device; this function does NOT use mmap
     virtual void read(uint64_t offset, void *buffer, size_t len) {
+      // pread() does not modify the file position and can run in parallel
+      // to other reads and writes, i.e. while the PageManager flushes
+#if !HAVE_PREAD
       ScopedSpinlock lock(m_mutex);
+#endif
       m_state.file.pread(offset, buffer, len);
 #ifdef UPS_ENABLE_ENCRYPTION
       if (config.is_encryption_enabled) {
@@ -207,7 +254,11 @@ class DiskDevice : public Device {
     // and is responsible for writing the data is run through the file
     // filters
     virtual void write(uint64_t offset, void *buffer, size_t len) {
+      // pwrite() does not modify the file position and can run in
+      // parallel, i.e. when the PageManager flushes with several threads
+#if !HAVE_PWRITE
       ScopedSpinlock lock(m_mutex);
+#endif
 #ifdef UPS_ENABLE_ENCRYPTION
       if (config.is_encryption_enabled) {
         // encryption disables direct I/O -> only full pages are allowed
@@ -223,6 +274,23 @@ class DiskDevice : public Device {
       m_state.file.pwrite(offset, buffer, len);
     }
 
+    // writes several buffers to adjacent offsets with a single pwritev()
+    virtual void writev(uint64_t offset, const IoBuffer *buffers,
+                    size_t count) {
+#ifdef UPS_ENABLE_ENCRYPTION
+      // the buffers are encrypted one by one
+      if (config.is_encryption_enabled) {
+        for (size_t i = 0; i < count; offset += buffers[i].size, i++)
+          write(offset, (void *)buffers[i].data, buffers[i].size);
+        return;
+      }
+#endif
+#if !HAVE_PWRITE
+      ScopedSpinlock lock(m_mutex);
+#endif
+      m_state.file.pwritev(offset, buffers, count);
+    }
+
     // allocate storage from this device; this function
     // will *NOT* return mmapped memory
     virtual uint64_t alloc(size_t requested_length) {
@@ -268,14 +336,14 @@ class DiskDevice : public Device {
     // reads a page from the device; this function CAN return a
 	// pointer to mmapped memory
     virtual void read_page(Page *page, uint64_t address) {
-      ScopedSpinlock lock(m_mutex);
       // if this page is in the mapped area: return a pointer into that area.
       // otherwise fall back to read/write.
-      if (address < m_state.mapped_size && m_state.mmapptr != 0) {
+      uint8_t *mapped = mapped_range(address, config.page_size_bytes);
+      if (mapped) {
         // the following line will not throw a C++ exception, but can
         // raise a signal. If that's the case then we don't catch it because
         // something is seriously wrong and proper recovery is not possible.
-        page->assign_mapped_buffer(&m_state.mmapptr[address], address);
+        page->assign_mapped_buffer(mapped, address);
         return;
       }
 
@@ -284,10 +352,19 @@ class DiskDevice : public Device {
         // note that |p| will not leak if file.pread() throws; |p| is stored
         // in the |page| object and will be cleaned up by the caller in
         // case of an exception.
-        uint8_t *p = Memory::allocate<uint8_t>(config.page_size_bytes);
-        page->assign_allocated_buffer(p, address);
+        PagePool *pool;
+        {
+          ScopedSpinlock lock(m_mutex);
+          pool = page_pool();
+        }
+        uint8_t *p = pool->allocate();
+        page->assign_allocated_buffer(p, address, pool);
       }
 
+      // the lock is not held while the page is read; see read()
+#if !HAVE_PREAD
+      ScopedSpinlock lock(m_mutex);
+#endif
       m_state.file.pread(address, page->data(), config.page_size_bytes);
 #ifdef UPS_ENABLE_ENCRYPTION
       if (config.is_encryption_enabled) {
@@ -304,9 +381,21 @@ class DiskDevice : public Device {
       uint64_t address = alloc(config.page_size_bytes);
       page->set_address(address);
 
+      // the new page is in the mapped area if the mapping grew with the file
+      uint8_t *mapped = mapped_range(address, config.page_size_bytes);
+      if (mapped) {
+        page->assign_mapped_buffer(mapped, address);
+        return;
+      }
+
       // allocate a memory buffer
-      uint8_t *p = Memory::allocate<uint8_t>(config.page_size_bytes);
-      page->assign_allocated_buffer(p, address);
+      PagePool *pool;
+      {
+        ScopedSpinlock lock(m_mutex);
+        pool = page_pool();
+      }
+      uint8_t *p = pool->allocate();
+      page->assign_allocated_buffer(p, address, pool);
     }
 
     // Frees a page on the device; plays counterpoint to |alloc_page|
@@ -318,7 +407,7 @@ class DiskDevice : public Device {
 
     // Returns true if the specified range is in mapped memory
     virtual bool is_mapped(uint64_t file_offset, size_t size) const {
-      return file_offset + size <= m_state.mapped_size;
+      return mapped_range(file_offset, size) != 0;
     }
 
     // Removes unused space at the end of the file
@@ -332,22 +421,159 @@ class DiskDevice : public Device {
 
     // Returns a pointer directly into mapped memory
     uint8_t *mapped_pointer(uint64_t address) const {
-      return &m_state.mmapptr[address];
+      uint8_t *p = mapped_range(address, 1);
+      assert(p != 0);
+      return p;
+    }
+
+  protected:
+    // Returns the pool for the page buffers; the page size can change
+    // when the header page of an existing file is read. Requires |m_mutex|.
+    PagePool *page_pool() {
+      if (unlikely(!m_page_pool
+                  || m_page_pool->page_size != config.page_size_bytes))
+        m_page_pool = PagePool::instance(config.page_size_bytes);
+      return m_page_pool;
     }
 
-  private:
     // truncate/resize the device, sans locking
     void truncate_nolock(uint64_t new_file_size) {
       if (new_file_size > config.file_size_limit_bytes)
         throw Exception(UPS_LIMITS_REACHED);
+      uint64_t old_file_size = m_state.file_size;
       m_state.file.truncate(new_file_size);
       m_state.file_size = new_file_size;
+
+      // the mapped pages beyond the end of the file are no longer used;
+      // they could become stale if the file grows again
+      if (new_file_size < m_mapped_end) {
+        m_mapped_end = new_file_size;
+        m_grow_mapping = false;
+      }
+      else if (m_grow_mapping && NOTSET(config.flags, UPS_DISABLE_MMAP)) {
+        grow_mapping_nolock(old_file_size);
+      }
+    }
+
+    // Returns a pointer to the mapped range [offset, offset + size), or
+    // 0 if the range is not mapped (or spans several mappings). Does not
+    // require |m_mutex|; the mappings are not modified after they were
+    // published.
+    uint8_t *mapped_range(uint64_t offset, uint64_t size) const {
+      if (offset + size > m_mapped_end.load(boost::memory_order_acquire))
+        return 0;
+
+      uint32_t count = m_mapping_count.load(boost::memory_order_acquire);
+      for (uint32_t i = count; i > 0; i--) {
+        const Mapping &m = m_mappings[i - 1];
+        if (offset >= m.offset) {
+          if (offset + size <= m.offset + m.size)
+            return &m.ptr[offset - m.offset];
+          return 0;
+        }
+      }
+
+      if (offset + size <= m_state.mapped_size && m_state.mmapptr != 0)
+        return &m_state.mmapptr[offset];
+      return 0;
+    }
+
+    // Enables (or disables) mapping the file ranges which are added
+    // while the file grows. Requires |m_mutex|.
+    void enable_mapping_growth(bool read_only) {
+#ifdef WIN32
+      // Win32 cannot truncate a mapped file, and File supports only a
+      // single mapping
+      m_grow_mapping = false;
+#else
+      m_grow_mapping = !read_only && NOTSET(config.flags, UPS_DISABLE_MMAP);
+#endif
+    }
+
+    // Extends the mapped range to the new end of the file. The mappings
+    // reserve address space beyond the end of the file, and a new mapping
+    // (as large as the file) is only added if the file outgrows the
+    // reserved space. The existing mappings are never moved because pages
+    // point into them.
+    //
+    // The mapped range must not have holes: pages which were allocated
+    // outside of the mapping have private buffers which are not visible
+    // through the mapping. If a range cannot be mapped then the mapping
+    // stops growing. Requires |m_mutex|.
+    void grow_mapping_nolock(uint64_t old_file_size) {
+      uint64_t file_size = m_state.file_size;
+      uint32_t count = m_mapping_count;
+      uint64_t reserved_end;
+      if (count > 0) {
+        reserved_end = m_mappings[count - 1].offset
+                            + m_mappings[count - 1].size;
+      }
+      else if (m_state.mmapptr != 0) {
+        reserved_end = m_state.mapped_size;
+      }
+      else {
+        // nothing is mapped yet; small files are not mapped at all
+        if (file_size < kMinMappingGrowth)
+          return;
+        reserved_end = old_file_size;
+        m_mapped_end = old_file_size;
+      }
+
+      if (m_mapped_end != old_file_size) {
+        m_grow_mapping = false;
+        return;
+      }
+
+      if (file_size > reserved_end) {
+        size_t granularity = File::granularity();
+        if (count == kMaxMappings || reserved_end % granularity != 0) {
+          m_grow_mapping = false;
+          return;
+        }
+
+        uint64_t size = std::max(file_size, (uint64_t)kMinMappingGrowth);
+        if (size % granularity)
+          size += granularity - size % granularity;
+
+        uint8_t *ptr = 0;
+        try {
+          m_state.file.mmap(reserved_end, (size_t)size, false, &ptr);
+        }
+        catch (Exception &ex) {
+          ups_log(("mmap failed with error %d, the mapping no longer grows",
+                      ex.code));
+          m_grow_mapping = false;
+          return;
+        }
+
+        m_mappings[count].offset = reserved_end;
+        m_mappings[count].size = size;
+        m_mappings[count].ptr = ptr;
+        m_mapping_count.store(count + 1, boost::memory_order_release);
+      }
+
+      m_mapped_end.store(file_size, boost::memory_order_release);
     }
 
     // For synchronizing access
     Spinlock m_mutex;
 
     State m_state;
+
+    // Allocates the page buffers; see |page_pool()|
+    PagePool *m_page_pool;
+
+    // The ranges which were mapped when the file grew
+    Mapping m_mappings[kMaxMappings];
+
+    // The number of entries in |m_mappings|
+    boost::atomic<uint32_t> m_mapping_count;
+
+    // The end of the mapped ranges; pages beyond are read with pread()
+    boost::atomic<uint64_t> m_mapped_end;
+
+    // True if the mapping grows with the file
+    bool m_grow_mapping;
 };
 
 } // namespace upscaledb
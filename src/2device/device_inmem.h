@@ -26,6 +26,8 @@
 
 #include "0root/root.h"
 
+#include <boost/atomic.hpp>
+
 // Always verify that a file of level N does not include headers > N!
 #include "1mem/mem.h"
 #include "2device/device.h"
@@ -106,6 +108,11 @@ struct InMemoryDevice : public Device {
   virtual void write(uint64_t offset, void *buffer, size_t len) {
   }
 
+  // writes several buffers to the device
+  virtual void writev(uint64_t offset, const IoBuffer *buffers,
+                  size_t count) {
+  }
+
   // reads a page from the device 
   virtual void read_page(Page *page, uint64_t address) {
     assert(!"operation is not possible for in-memory-databases");
@@ -162,8 +169,9 @@ struct InMemoryDevice : public Device {
   // flag whether this device was "opened" or is uninitialized
   bool is_open_;
 
-  // the allocated bytes
-  uint64_t allocated_size_;
+  // the allocated bytes; blobs of different databases are allocated
+  // concurrently
+  boost::atomic<uint64_t> allocated_size_;
 };
 
 } // namespace upscaledb
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A DiskDevice which writes batches of pages through io_uring (Linux only).
+ * Enabled with UPS_ENABLE_IO_URING. A batch of pages (i.e. of a changeset,
+ * or of a background flush) is submitted with a single system call instead
+ * of one pwrite() per page. Everything else is inherited from DiskDevice.
+ *
+ * Encrypted Environments fall back to the DiskDevice behaviour.
+ *
+ * @exception_safe: basic
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_DEVICE_URING_H
+#define UPS_DEVICE_URING_H
+
+#include "0root/root.h"
+
+#include <vector>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
+#include "1os/io_uring.h"
+#include "2device/device_disk.h"
+#include "2page/page.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+class UringDevice : public DiskDevice {
+  public:
+    UringDevice(const EnvConfig &config)
+      : DiskDevice(config) {
+    }
+
+    // Create a new device
+    virtual void create() {
+      DiskDevice::create();
+      open_ring();
+    }
+
+    // opens an existing device
+    virtual void open() {
+      DiskDevice::open();
+      open_ring();
+    }
+
+    // closes the device
+    virtual void close() {
+      {
+        ScopedLock lock(m_ring_mutex);
+        m_ring.close();
+      }
+      DiskDevice::close();
+    }
+
+    // Returns true if the ring was set up
+    virtual bool supports_batched_writes() const {
+      return m_ring.is_open();
+    }
+
+    // Writes all |pages| with a single submission
+    virtual bool write_pages(std::vector<Page *> &pages) {
+      if (!supports_batched_writes())
+        return false;
+
+      std::vector<IoRequest> requests;
+      requests.reserve(pages.size());
+      for (std::vector<Page *>::iterator it = pages.begin();
+                      it != pages.end(); it++) {
+        Page *page = *it;
+        // direct I/O requires aligned buffers
+        if (!m_state.file.is_aligned(page->address(), page->data(),
+                                page->persisted_data.size))
+          return false;
+        requests.push_back(IoRequest(page->address(), page->data(),
+                                page->persisted_data.size));
+      }
+
+      for (std::vector<Page *>::iterator it = pages.begin();
+                      it != pages.end(); it++)
+        (*it)->update_crc32();
+
+      {
+        ScopedLock lock(m_ring_mutex);
+        m_ring.pwrite(m_state.file.fd(), requests);
+      }
+
+      for (std::vector<Page *>::iterator it = pages.begin();
+                      it != pages.end(); it++)
+        (*it)->set_flushed();
+      return true;
+    }
+
+    // Returns the number of batches which were submitted
+    uint64_t submissions() {
+      ScopedLock lock(m_ring_mutex);
+      return m_ring.submissions();
+    }
+
+  private:
+    // Sets up the ring; encrypted pages are written by DiskDevice::write()
+    void open_ring() {
+#ifdef UPS_ENABLE_ENCRYPTION
+      if (config.is_encryption_enabled)
+        return;
+#endif
+      ScopedLock lock(m_ring_mutex);
+      if (!m_ring.is_open() && !m_ring.open())
+        ups_log(("io_uring is not available, falling back to pwrite()"));
+    }
+
+    // Serializes the submissions
+    Mutex m_ring_mutex;
+
+    // The io_uring instance
+    IoUring m_ring;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_DEVICE_URING_H */
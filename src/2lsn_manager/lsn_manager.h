@@ -20,7 +20,7 @@
  * Manager for the log sequence number (lsn)
  *
  * @exception_safe: nothrow
- * @thread_safe: no
+ * @thread_safe: yes
  */
  
 #ifndef UPS_LSN_MANAGER_H
@@ -28,6 +28,8 @@
 
 #include "0root/root.h"
 
+#include <boost/atomic.hpp>
+
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
 #endif
@@ -43,11 +45,12 @@ struct LsnManager
 
   // Returns the next lsn
   uint64_t next() {
-    return current++;
+    return current.fetch_add(1);
   }
 
-  // the current lsn
-  uint64_t current;
+  // the current lsn; atomic because operations on different databases
+  // can run concurrently
+  boost::atomic<uint64_t> current;
 };
 
 } // namespace upscaledb
@@ -19,8 +19,10 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <vector>
 #include "3rdparty/murmurhash3/MurmurHash3.h"
 
+#include "1base/crc32c.h"
 #include "1base/error.h"
 #include "1os/os.h"
 #include "2page/page.h"
@@ -29,10 +31,11 @@
 
 namespace upscaledb {
 
-uint64_t Page::ms_page_count_flushed = 0;
+boost::atomic<uint64_t> Page::ms_page_count_flushed(0);
 
 Page::Page(Device *device, LocalDb *db)
-  : device_(device), db_(db), node_proxy_(0)
+  : device_(device), db_(db), node_proxy_(0), changeset_(0), pin_count_(0),
+    is_read_ahead_(false)
 {
   persisted_data.raw_data = 0;
   persisted_data.is_dirty = false;
@@ -79,21 +82,72 @@ void
 Page::flush()
 {
   if (persisted_data.is_dirty) {
-    // update crc32
-    if (ISSET(device_->config.flags, UPS_ENABLE_CRC32)
-        && likely(!persisted_data.is_without_header)) {
-      MurmurHash3_x86_32(persisted_data.raw_data->header.payload,
-                         persisted_data.size - (sizeof(PPageHeader) - 1),
-                         (uint32_t)persisted_data.address,
-                         &persisted_data.raw_data->header.crc32);
-    }
+    update_crc32();
     device_->write(persisted_data.address, persisted_data.raw_data,
                     persisted_data.size);
-    persisted_data.is_dirty = false;
-    ms_page_count_flushed++;
+    set_flushed();
   }
 }
 
+void
+Page::flush_run(Page **pages, size_t count)
+{
+  if (count == 1) {
+    pages[0]->flush();
+    return;
+  }
+
+  std::vector<IoBuffer> buffers(count);
+  for (size_t i = 0; i < count; i++) {
+    assert(pages[i]->is_dirty());
+    assert(i == 0 || pages[i]->address() == pages[i - 1]->address()
+                                + pages[i - 1]->persisted_data.size);
+    pages[i]->update_crc32();
+    buffers[i] = IoBuffer(pages[i]->persisted_data.raw_data,
+                    pages[i]->persisted_data.size);
+  }
+
+  pages[0]->device_->writev(pages[0]->address(), buffers.data(), count);
+
+  for (size_t i = 0; i < count; i++)
+    pages[i]->set_flushed();
+}
+
+void
+Page::update_crc32()
+{
+  if (ISSET(device_->config.flags, UPS_ENABLE_CRC32)
+      && likely(!persisted_data.is_without_header))
+    persisted_data.raw_data->header.crc32 = calculate_crc32();
+}
+
+uint32_t
+Page::calculate_crc32()
+{
+  return checksum(device_->config, persisted_data.raw_data->header.payload,
+                  persisted_data.size - (sizeof(PPageHeader) - 1),
+                  (uint32_t)persisted_data.address);
+}
+
+uint32_t
+Page::checksum(const EnvConfig &config, const void *data, size_t size,
+                uint32_t seed)
+{
+  if (config.page_checksum == EnvConfig::kChecksumCrc32c)
+    return Crc32c::checksum(data, size, seed);
+
+  uint32_t crc32;
+  MurmurHash3_x86_32(data, (int)size, seed, &crc32);
+  return crc32;
+}
+
+void
+Page::set_flushed()
+{
+  persisted_data.is_dirty = false;
+  ms_page_count_flushed++;
+}
+
 void
 Page::free_buffer()
 {
@@ -22,9 +22,12 @@
 #include <string.h>
 #include <stdint.h>
 
+#include <boost/atomic.hpp>
+
 #include "1base/error.h"
 #include "1base/spinlock.h"
 #include "1mem/mem.h"
+#include "1mem/page_pool.h"
 #include "1base/intrusive_list.h"
 #include "3btree/btree_cursor.h"
 
@@ -33,6 +36,8 @@ namespace upscaledb {
 struct Device;
 struct BtreeCursor;
 struct BtreeNodeProxy;
+struct Changeset;
+struct EnvConfig;
 struct LocalDb;
 
 #include "1base/packstart.h"
@@ -84,21 +89,26 @@ class Page {
     struct PersistedData {
       PersistedData()
         : address(0), size(0), is_dirty(false), is_allocated(false),
-          is_without_header(false), raw_data(0) {
+          is_without_header(false), raw_data(0), pool(0) {
       }
 
       PersistedData(const PersistedData &other)
         : address(other.address), size(other.size), is_dirty(other.is_dirty),
           is_allocated(other.is_allocated),
-          is_without_header(other.is_without_header), raw_data(other.raw_data) {
+          is_without_header(other.is_without_header), raw_data(other.raw_data),
+          pool(other.pool) {
       }
 
       ~PersistedData() {
 #ifdef NDEBUG
         mutex.safe_unlock();
 #endif
-        if (is_allocated)
-          Memory::release(raw_data);
+        if (is_allocated) {
+          if (pool)
+            pool->release(raw_data);
+          else
+            Memory::release(raw_data);
+        }
         raw_data = 0;
       }
 
@@ -123,6 +133,9 @@ class Page {
 
       // the persistent data of this page
       PPageData *raw_data;
+
+      // the pool which allocated |raw_data| (if any)
+      PagePool *pool;
     };
 
     // Misc. enums
@@ -136,7 +149,8 @@ class Page {
 
     // The various linked lists (indices in m_prev, m_next)
     enum {
-      // list of all cached pages
+      // list of all cached pages (with UPS_CACHE_POLICY_2Q: only those
+      // in the probation queue)
       kListCache              = 0,
 
       // list of all pages in a changeset
@@ -145,8 +159,14 @@ class Page {
       // a bucket in the hash table of the cache
       kListBucket             = 2,
 
+      // the protected queue of the cache (UPS_CACHE_POLICY_2Q)
+      kListCacheProtected     = 3,
+
+      // the internal btree nodes in the cache
+      kListCacheInternal      = 4,
+
       // array limit
-      kListMax                = 3
+      kListMax                = 5
     };
 
     // non-persistent page flags
@@ -200,6 +220,23 @@ class Page {
       return persisted_data.mutex;
     }
 
+    // Pins the page; pinned pages are used by concurrent readers and
+    // must not be purged from the cache
+    void pin() {
+      pin_count_++;
+    }
+
+    // Releases a pin
+    void unpin() {
+      assert(pin_count_ > 0);
+      pin_count_--;
+    }
+
+    // Returns true if the page is pinned
+    bool is_pinned() const {
+      return pin_count_ > 0;
+    }
+
     // Returns the database which manages this page; can be NULL if this
     // page belongs to the Environment (i.e. for freelist-pages)
     LocalDb *db() {
@@ -301,12 +338,14 @@ class Page {
       persisted_data.is_without_header = is_without_header;
     }
 
-    // Assign a buffer which was allocated with malloc()
-    void assign_allocated_buffer(void *buffer, uint64_t address) {
+    // Assign a buffer which was allocated with malloc(), or from |pool|
+    void assign_allocated_buffer(void *buffer, uint64_t address,
+                    PagePool *pool = 0) {
       free_buffer();
       persisted_data.raw_data = (PPageData *)buffer;
       persisted_data.is_allocated = true;
       persisted_data.address = address;
+      persisted_data.pool = pool;
     }
 
     // Assign a buffer from mmapped storage
@@ -315,6 +354,7 @@ class Page {
       persisted_data.raw_data = (PPageData *)buffer;
       persisted_data.is_allocated = false;
       persisted_data.address = address;
+      persisted_data.pool = 0;
     }
 
     // Free resources associated with the buffer
@@ -330,6 +370,25 @@ class Page {
     // Flushes the page to disk, clears the "dirty" flag
     void flush();
 
+    // Flushes a run of |count| dirty pages with adjacent addresses with a
+    // single (vectored) write, clears their "dirty" flags
+    static void flush_run(Page **pages, size_t count);
+
+    // Updates the checksum (if enabled) before the page is written
+    void update_crc32();
+
+    // Calculates the checksum of the payload
+    uint32_t calculate_crc32();
+
+    // Calculates the checksum of |size| bytes at |data| with the algorithm
+    // of the Environment (EnvConfig::page_checksum)
+    static uint32_t checksum(const EnvConfig &config, const void *data,
+                    size_t size, uint32_t seed);
+
+    // Clears the "dirty" flag after the page was written as part of a
+    // larger write (see PageManager)
+    void set_flushed();
+
     // Returns the cached BtreeNodeProxy
     BtreeNodeProxy *node_proxy() {
       return node_proxy_;
@@ -340,6 +399,26 @@ class Page {
       node_proxy_ = proxy;
     }
 
+    // Returns the Changeset which locked this page, or null
+    Changeset *changeset() const {
+      return changeset_.load(boost::memory_order_relaxed);
+    }
+
+    // Sets the Changeset which locked this page
+    void set_changeset(Changeset *changeset) {
+      changeset_.store(changeset, boost::memory_order_relaxed);
+    }
+
+    // Returns true if this page was read ahead, and not yet accessed
+    bool is_read_ahead() const {
+      return is_read_ahead_;
+    }
+
+    // Sets the flag whether this page was read ahead
+    void set_read_ahead(bool is_read_ahead) {
+      is_read_ahead_ = is_read_ahead;
+    }
+
     // Returns the next page in a linked list
     Page *next(int list) {
       return list_node.next[list];
@@ -350,8 +429,8 @@ class Page {
       return list_node.previous[list];
     }
 
-    // tracks number of flushed pages
-    static uint64_t ms_page_count_flushed;
+    // tracks number of flushed pages; pages are flushed by several threads
+    static boost::atomic<uint64_t> ms_page_count_flushed;
 
     // the persistent data of this page
     PersistedData persisted_data;
@@ -362,6 +441,10 @@ class Page {
     // Intrusive linked btree cursors
     IntrusiveList<BtreeCursor> cursor_list;
 
+    // Protects the |cursor_list|; concurrent readers can couple their
+    // cursors to the same page
+    Spinlock cursor_list_mutex;
+
   private:
     // the Device for allocating storage
     Device *device_;
@@ -370,7 +453,17 @@ class Page {
     LocalDb *db_;
 
     // the cached BtreeNodeProxy object
-    BtreeNodeProxy *node_proxy_;
+    boost::atomic<BtreeNodeProxy *> node_proxy_;
+
+    // the Changeset which locked this page; concurrent writers use
+    // different Changesets
+    boost::atomic<Changeset *> changeset_;
+
+    // number of concurrent readers which are currently using this page
+    boost::atomic<int> pin_count_;
+
+    // true if the page was read ahead, and not yet accessed
+    bool is_read_ahead_;
 };
 
 } // namespace upscaledb
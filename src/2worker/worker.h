@@ -65,6 +65,13 @@ struct WorkerPool {
     strand.post(f);
   }
 
+  // Add a new work item to the pool; unlike |enqueue()|, the work items
+  // are not serialized but run in parallel on all threads
+  template<typename F>
+  void post(F f) {
+    service.post(f);
+  }
+
   // the destructor joins all threads
   ~WorkerPool() {
     service.stop();
@@ -171,16 +171,17 @@ struct BlobManager {
   Device *device;
 
   // Usage tracking - number of bytes before compression
-  uint64_t metric_before_compression;
+  boost::atomic<uint64_t> metric_before_compression;
 
   // Usage tracking - number of bytes after compression
-  uint64_t metric_after_compression;
+  boost::atomic<uint64_t> metric_after_compression;
 
-  // Usage tracking - number of blobs allocated
-  uint64_t metric_total_allocated;
+  // Usage tracking - number of blobs allocated; updated by concurrent
+  // writers of In-Memory Environments
+  boost::atomic<uint64_t> metric_total_allocated;
 
-  // Usage tracking - number of blobs read
-  uint64_t metric_total_read;
+  // Usage tracking - number of blobs read; updated by concurrent readers
+  boost::atomic<uint64_t> metric_total_read;
 };
 
 } // namespace upscaledb
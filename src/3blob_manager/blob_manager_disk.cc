@@ -21,8 +21,6 @@
 #include <algorithm>
 #include <vector>
 
-#include "3rdparty/murmurhash3/MurmurHash3.h"
-
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
 #include "1base/dynamic_array.h"
@@ -305,6 +303,9 @@ uint64_t
 DiskBlobManager::allocate(Context *context, ups_record_t *record,
                 uint32_t flags)
 {
+  // blob pages are shared by all databases; serialize concurrent writers
+  context->changeset.lock_shared_pages();
+
   metric_total_allocated++;
 
   uint8_t *chunk_data[2];
@@ -375,9 +376,8 @@ DiskBlobManager::allocate(Context *context, ups_record_t *record,
     // multi-page blobs store their CRC in the first freelist offset
     if (unlikely(num_pages > 1
             && (config->flags & UPS_ENABLE_CRC32))) {
-      uint32_t crc32 = 0;
-      MurmurHash3_x86_32(record->data, record->size, 0, &crc32);
-      header->freelist[0].offset = crc32;
+      header->freelist[0].offset = Page::checksum(*config, record->data,
+                      record->size, 0);
     }
 
     address = page->address() + kPageOverhead;
@@ -420,6 +420,8 @@ void
 DiskBlobManager::read(Context *context, uint64_t blob_id,
                 ups_record_t *record, uint32_t flags, ByteArray *arena)
 {
+  context->changeset.lock_shared_pages();
+
   metric_total_read++;
 
   // first step: read the blob header
@@ -503,8 +505,8 @@ DiskBlobManager::read(Context *context, uint64_t blob_id,
   if (unlikely(header->num_pages > 1
         && ISSET(config->flags, UPS_ENABLE_CRC32))) {
     uint32_t old_crc32 = header->freelist[0].offset;
-    uint32_t new_crc32;
-    MurmurHash3_x86_32(record->data, record->size, 0, &new_crc32);
+    uint32_t new_crc32 = Page::checksum(*config, record->data, record->size,
+                    0);
 
     if (unlikely(old_crc32 != new_crc32)) {
       ups_trace(("crc32 mismatch in page %lu: 0x%lx != 0x%lx",
@@ -517,6 +519,8 @@ DiskBlobManager::read(Context *context, uint64_t blob_id,
 uint32_t
 DiskBlobManager::blob_size(Context *context, uint64_t blob_id)
 {
+  context->changeset.lock_shared_pages();
+
   // read the blob header
   PBlobHeader *blob_header = (PBlobHeader *)read_chunk(this, context,
                   0, 0, blob_id, true, true);
@@ -531,6 +535,8 @@ uint64_t
 DiskBlobManager::overwrite(Context *context, uint64_t old_blobid,
                 ups_record_t *record, uint32_t flags)
 {
+  context->changeset.lock_shared_pages();
+
   PBlobHeader *old_blob_header, new_blob_header;
 
   // This routine basically ignores compression. The likelyhood that a
@@ -588,9 +594,8 @@ DiskBlobManager::overwrite(Context *context, uint64_t old_blobid,
     // multi-page blobs store their CRC in the first freelist offset
     if (unlikely(header->num_pages > 1
             && ISSET(config->flags, UPS_ENABLE_CRC32))) {
-      uint32_t crc32 = 0;
-      MurmurHash3_x86_32(record->data, record->size, 0, &crc32);
-      header->freelist[0].offset = crc32;
+      header->freelist[0].offset = Page::checksum(*config, record->data,
+                      record->size, 0);
     }
 
     // the old rid is the new rid
@@ -610,6 +615,8 @@ DiskBlobManager::overwrite_regions(Context *context, uint64_t old_blob_id,
                   ups_record_t *record, uint32_t flags,
                   Region *regions, size_t num_regions)
 {
+  context->changeset.lock_shared_pages();
+
   assert(num_regions > 0);
 
   uint32_t page_size = config->page_size_bytes;
@@ -684,9 +691,8 @@ DiskBlobManager::overwrite_regions(Context *context, uint64_t old_blob_id,
   // multi-page blobs store their CRC in the first freelist offset
   if (unlikely(header->num_pages > 1
           && ISSET(config->flags, UPS_ENABLE_CRC32))) {
-    uint32_t crc32 = 0;
-    MurmurHash3_x86_32(record->data, record->size, 0, &crc32);
-    header->freelist[0].offset = crc32;
+    header->freelist[0].offset = Page::checksum(*config, record->data,
+                    record->size, 0);
     page->set_dirty(true);
   }
 
@@ -698,6 +704,8 @@ void
 DiskBlobManager::erase(Context *context, uint64_t blob_id, Page *page,
                 uint32_t flags)
 {
+  context->changeset.lock_shared_pages();
+
   // fetch the blob header
   PBlobHeader *blob_header = (PBlobHeader *)read_chunk(this, context, 0, &page,
                         blob_id, false, false);
@@ -39,7 +39,10 @@ namespace upscaledb {
 static inline void
 remove_cursor_from_page(BtreeCursor *cursor, Page *page)
 {
-  page->cursor_list.del(cursor);
+  {
+    ScopedSpinlock lock(page->cursor_list_mutex);
+    page->cursor_list.del(cursor);
+  }
 
   BtreeCursorState &st_ = cursor->st_;
   st_.coupled_page = 0;
@@ -203,6 +206,8 @@ move_next(BtreeCursor *cursor, Context *context, uint32_t flags)
 
   Page *page = env->page_manager->fetch(context, node->right_sibling(),
                     PageManager::kReadOnly);
+  env->page_manager->read_ahead(st_.read_ahead,
+                    st_.coupled_page->address(), page);
   node = st_.btree->get_node_from_page(page);
 
   // if the right node is empty then continue searching for the next
@@ -349,6 +354,7 @@ BtreeCursor::couple_to(Page *page, uint32_t index, int duplicate_index)
   st_.coupled_page = page;
 
   // add the cursor to the page
+  ScopedSpinlock lock(page->cursor_list_mutex);
   page->cursor_list.put(this);
 }
 
@@ -514,6 +520,8 @@ BtreeCursor::move_to_next_page(Context *context)
 
   Page *page = env->page_manager->fetch(context, node->right_sibling(),
                         PageManager::kReadOnly);
+  env->page_manager->read_ahead(st_.read_ahead,
+                        st_.coupled_page->address(), page);
   couple_to(page, 0, 0);
   return 0;
 }
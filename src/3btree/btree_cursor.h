@@ -49,6 +49,7 @@
 #include "1base/dynamic_array.h"
 #include "1base/error.h"
 #include "1base/intrusive_list.h"
+#include "3page_manager/read_ahead.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -90,6 +91,9 @@ struct BtreeCursorState {
 
   // a ByteArray which backs |uncoupled_key.data|
   ByteArray uncoupled_arena;
+
+  // tracks sequential access to the leaf pages
+  ReadAhead read_ahead;
 };
 
 
@@ -51,6 +51,7 @@ struct BtreeEraseAction : public BtreeUpdateAction
       key(key_) {
     if (cursor)
       duplicate_index = cursor->duplicate_index() + 1;
+    optimistic = context->changeset.is_read_only();
   }
 
   // This is the entry point for the erase operation
@@ -93,6 +94,8 @@ fall_through:
     Page *parent;
     BtreeStatistics::InsertHints hints;
     Page *page = traverse_tree(context, key, hints, &parent);
+    if (unlikely(page == 0))
+      return UPS_WOULD_BLOCK;
     BtreeNodeProxy *node = btree->get_node_from_page(page);
 
     // we have reached the leaf; search the leaf for the key
@@ -189,6 +192,10 @@ fall_through:
       if (ex.code != UPS_LIMITS_REACHED)
         throw ex;
 
+      // only compressed KeyLists grow, and they do not support
+      // optimistic updates
+      assert(!optimistic);
+
       // Split the page in the middle. This will invalidate the |node| pointer
       // and the |slot| of the key, therefore restart the whole operation
       BtreeStatistics::InsertHints hints = {0};
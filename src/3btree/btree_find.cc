@@ -105,7 +105,7 @@ struct BtreeFindAction
         page = btree->find_lower_bound(context, page, key,
                               PageManager::kReadOnly, 0);
         if (unlikely(!page)) {
-          stats->find_failed();
+          find_failed(stats);
           return UPS_KEY_NOT_FOUND;
         }
 
@@ -116,7 +116,7 @@ struct BtreeFindAction
       if (flags == 0 || flags == LocalCursor::kSyncDontLoadKey) {
         slot = node->find(context, key);
         if (unlikely(slot == -1)) {
-          stats->find_failed();
+          find_failed(stats);
           return UPS_KEY_NOT_FOUND;
         }
 
@@ -152,7 +152,7 @@ struct BtreeFindAction
     }
 
     if (unlikely(slot < 0)) {
-      stats->find_failed();
+      find_failed(stats);
       return UPS_KEY_NOT_FOUND;
     }
 
@@ -178,6 +178,13 @@ return_result:
     return 0;
   }
 
+  // Reports a failed lookup; skipped by concurrent readers because the
+  // statistics are not synchronized
+  void find_failed(BtreeStatistics *stats) {
+    if (!context->changeset.is_read_only())
+      stats->find_failed();
+  }
+
   // Searches a leaf node for a key.
   //
   // !!!
@@ -41,12 +41,36 @@ namespace upscaledb {
 Page *
 BtreeIndex::root_page(Context *context)
 {
-  if (unlikely(state.root_page == 0))
-    state.root_page = state.page_manager->fetch(context,
+  Page *page = state.root_page;
+  if (unlikely(page == 0)) {
+    // concurrent readers will fetch the same page from the cache
+    page = state.page_manager->fetch(context,
                             state.btree_header->root_address);
+    state.root_page = page;
+  }
+  else
+    context->changeset.put(page);
+  return page;
+}
+
+BtreeNodeProxy *
+BtreeIndex::create_node_proxy(Page *page)
+{
+  ScopedSpinlock lock(state.node_proxy_mutex);
+
+  // check again; a concurrent reader might have been faster
+  BtreeNodeProxy *proxy = page->node_proxy();
+  if (proxy != 0)
+    return proxy;
+
+  PBtreeNode *node = PBtreeNode::from_page(page);
+  if (node->is_leaf())
+    proxy = leaf_node_from_page_impl(page);
   else
-    context->changeset.put(state.root_page);
-  return state.root_page;
+    proxy = internal_node_from_page_impl(page);
+
+  page->set_node_proxy(proxy);
+  return proxy;
 }
 
 void
@@ -27,6 +27,7 @@
 #include "1base/abi.h"
 #include "1base/dynamic_array.h"
 #include "1base/scoped_ptr.h"
+#include "1base/spinlock.h"
 #include "1globals/globals.h"
 #include "3btree/btree_cursor.h"
 #include "3btree/btree_stats.h"
@@ -155,8 +156,13 @@ struct BtreeIndexState {
   // the index of the PBtreeHeader in the Environment's header page
   PBtreeHeader *btree_header;
 
-  // the root page of the Btree
-  Page *root_page;
+  // the root page of the Btree; loaded lazily, and concurrent readers
+  // can race for it
+  boost::atomic<Page *> root_page;
+
+  // Serializes the creation of BtreeNodeProxy objects; concurrent readers
+  // can race for them, and initializing an empty node writes to the page
+  Spinlock node_proxy_mutex;
 
   // the btree statistics
   BtreeStatistics statistics;
@@ -269,20 +275,15 @@ struct BtreeIndex {
 
   // Returns a BtreeNodeProxy for a Page
   BtreeNodeProxy *get_node_from_page(Page *page) {
-    if (likely(page->node_proxy() != 0))
-      return page->node_proxy();
-
-    BtreeNodeProxy *proxy;
-    PBtreeNode *node = PBtreeNode::from_page(page);
-    if (node->is_leaf())
-      proxy = leaf_node_from_page_impl(page);
-    else
-      proxy = internal_node_from_page_impl(page);
-
-    page->set_node_proxy(proxy);
-    return proxy;
+    BtreeNodeProxy *proxy = page->node_proxy();
+    if (likely(proxy != 0))
+      return proxy;
+    return create_node_proxy(page);
   }
 
+  // Creates the BtreeNodeProxy for a Page
+  BtreeNodeProxy *create_node_proxy(Page *page);
+
   // Returns the usage metrics
   static void fill_metrics(ups_env_metrics_t *metrics) {
     metrics->btree_smo_split = Globals::ms_btree_smo_split;
@@ -54,6 +54,7 @@ struct BtreeInsertAction : public BtreeUpdateAction {
     : BtreeUpdateAction(btree_, context_, cursor_,
                     cursor_ ? cursor_->duplicate_index() : 0),
       key(key_), record(record_), flags(flags_) {
+    optimistic = context->changeset.is_read_only();
   }
 
   // This is the entry point for the actual insert operation
@@ -75,8 +76,14 @@ struct BtreeInsertAction : public BtreeUpdateAction {
      * already full, it will remove the HINT_APPEND (or HINT_PREPEND)
      * flag and call insert()
      */
+    /*
+     * optimistic inserts skip this shortcut: the hinted leaf would be
+     * locked before the tree is traversed, and the traversal must not
+     * lock any further page while the PageManager is locked
+     */
     ups_status_t st;
     if (hints.leaf_page_addr
+            && !optimistic
             && ISSETANY(hints.flags, UPS_HINT_APPEND | UPS_HINT_PREPEND)) {
       st = append_or_prepend_key();
       if (unlikely(st == UPS_LIMITS_REACHED))
@@ -86,6 +93,11 @@ struct BtreeInsertAction : public BtreeUpdateAction {
       st = insert();
     }
 
+    // the insert is repeated exclusively; keep the statistics for the
+    // upcoming split
+    if (unlikely(st == UPS_WOULD_BLOCK))
+      return st;
+
     if (st)
       stats->insert_failed();
     else {
@@ -169,11 +181,15 @@ struct BtreeInsertAction : public BtreeUpdateAction {
     // traverse the tree till a leaf is reached
     Page *parent;
     Page *page = traverse_tree(context, key, hints, &parent);
+    if (unlikely(page == 0))
+      return UPS_WOULD_BLOCK;
 
     // We've reached the leaf; it's still possible that we have to
     // split the page, therefore this case has to be handled
     ups_status_t st = insert_in_page(page, key, record, hints);
     if (unlikely(st == UPS_LIMITS_REACHED)) {
+      if (optimistic)
+        return UPS_WOULD_BLOCK;
       page = split_page(page, parent, key, hints);
       return insert_in_page(page, key, record, hints);
     }
@@ -48,6 +48,7 @@
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/dynamic_array.h"
+#include "1base/spinlock.h"
 #include "2compressor/compressor_factory.h"
 #include "3blob_manager/blob_manager.h"
 #include "3btree/btree_node.h"
@@ -454,8 +455,11 @@ struct VariableLengthKeyList : BaseKeyList {
   }
 
   // Retrieves the extended key at |blobid| and stores it in |key|; will
-  // use the cache.
+  // use the cache. The cache is locked because concurrent readers can
+  // populate it at the same time.
   void get_extended_key(Context *context, uint64_t blob_id, ups_key_t *key) {
+    ScopedSpinlock lock(_extkey_mutex);
+
     if (unlikely(!_extkey_cache))
       _extkey_cache.reset(new ExtKeyCache());
     else {
@@ -558,6 +562,9 @@ struct VariableLengthKeyList : BaseKeyList {
   // Cache for extended keys
   ScopedPtr<ExtKeyCache> _extkey_cache;
 
+  // Protects the |_extkey_cache| against concurrent readers
+  Spinlock _extkey_mutex;
+
   // Threshold for extended keys; if key size is > threshold then the
   // key is moved to a blob
   size_t _extkey_threshold;
@@ -42,6 +42,8 @@ BtreeStatistics::BtreeStatistics()
 void
 BtreeStatistics::find_succeeded(Page *page)
 {
+  ScopedSpinlock lock(mutex);
+
   if (state.last_leaf_pages[kOperationFind] != page->address()) {
     state.last_leaf_pages[kOperationFind] = page->address();
     state.last_leaf_count[kOperationFind] = 0;
@@ -53,6 +55,8 @@ BtreeStatistics::find_succeeded(Page *page)
 void
 BtreeStatistics::find_failed()
 {
+  ScopedSpinlock lock(mutex);
+
   state.last_leaf_pages[kOperationFind] = 0;
   state.last_leaf_count[kOperationFind] = 0;
 }
@@ -60,6 +64,8 @@ BtreeStatistics::find_failed()
 void
 BtreeStatistics::insert_succeeded(Page *page, uint16_t slot)
 {
+  ScopedSpinlock lock(mutex);
+
   if (state.last_leaf_pages[kOperationInsert] != page->address()) {
     state.last_leaf_pages[kOperationInsert] = page->address();
     state.last_leaf_count[kOperationInsert] = 0;
@@ -84,6 +90,8 @@ BtreeStatistics::insert_succeeded(Page *page, uint16_t slot)
 void
 BtreeStatistics::insert_failed()
 {
+  ScopedSpinlock lock(mutex);
+
   state.last_leaf_pages[kOperationInsert] = 0;
   state.last_leaf_count[kOperationInsert] = 0;
   state.append_count = 0;
@@ -93,6 +101,8 @@ BtreeStatistics::insert_failed()
 void
 BtreeStatistics::erase_succeeded(Page *page)
 {
+  ScopedSpinlock lock(mutex);
+
   if (state.last_leaf_pages[kOperationErase] != page->address()) {
     state.last_leaf_pages[kOperationErase] = page->address();
     state.last_leaf_count[kOperationErase] = 0;
@@ -104,6 +114,8 @@ BtreeStatistics::erase_succeeded(Page *page)
 void
 BtreeStatistics::erase_failed()
 {
+  ScopedSpinlock lock(mutex);
+
   state.last_leaf_pages[kOperationErase] = 0;
   state.last_leaf_count[kOperationErase] = 0;
 }
@@ -111,6 +123,7 @@ BtreeStatistics::erase_failed()
 BtreeStatistics::FindHints
 BtreeStatistics::find_hints(uint32_t flags)
 {
+  ScopedSpinlock lock(mutex);
   BtreeStatistics::FindHints hints = {flags, flags, 0, false};
 
   /* if the last 5 lookups hit the same page: reuse that page */
@@ -125,6 +138,7 @@ BtreeStatistics::find_hints(uint32_t flags)
 BtreeStatistics::InsertHints
 BtreeStatistics::insert_hints(uint32_t flags)
 {
+  ScopedSpinlock lock(mutex);
   InsertHints hints = {flags, flags, 0, 0, 0, 0, 0};
 
   /* if the previous insert-operation replaced the upper bound (or
@@ -30,6 +30,7 @@
 #include "ups/upscaledb_int.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/spinlock.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -114,21 +115,25 @@ struct BtreeStatistics {
 
   // Keep track of the KeyList range size
   void set_keylist_range_size(bool leaf, size_t size) {
+    ScopedSpinlock lock(mutex);
     state.keylist_range_size[(int)leaf] = size;
   }
 
   // Retrieves the KeyList range size
   size_t keylist_range_size(bool leaf) const {
+    ScopedSpinlock lock(mutex);
     return state.keylist_range_size[(int)leaf];
   }
 
   // Keep track of the KeyList capacities
   void set_keylist_capacities(bool leaf, size_t capacity) {
+    ScopedSpinlock lock(mutex);
     state.keylist_capacities[(int)leaf] = capacity;
   }
 
   // Retrieves the KeyList capacities size
   size_t keylist_capacities(bool leaf) const {
+    ScopedSpinlock lock(mutex);
     return state.keylist_capacities[(int)leaf];
   }
 
@@ -168,6 +173,10 @@ struct BtreeStatistics {
     // the capacities of the KeyList
     size_t keylist_capacities[2];
   } state;
+
+  // Protects the state; optimistic updates of the same database run
+  // concurrently
+  mutable Spinlock mutex;
 };
 
 } // namespace upscaledb
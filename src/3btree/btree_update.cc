@@ -92,6 +92,8 @@ allocate_new_root(BtreeUpdateAction &state, Page *old_root)
   BtreeNodeProxy *new_node = state.btree->get_node_from_page(new_root);
   new_node->set_left_child(old_root->address());
 
+  // the header page is shared by all databases
+  state.context->changeset.lock_shared_pages();
   state.btree->set_root_page(new_root);
   Page *header = env->page_manager->fetch(state.context, 0);
   header->set_dirty(true);
@@ -139,6 +141,7 @@ collapse_root(BtreeUpdateAction &state, Page *root_page)
   BtreeNodeProxy *node = state.btree->get_node_from_page(root_page);
   assert(node->length() == 0);
 
+  state.context->changeset.lock_shared_pages();
   Page *header = env->page_manager->fetch(state.context, 0);
   header->set_dirty(true);
 
@@ -164,6 +167,13 @@ BtreeUpdateAction::traverse_tree(Context *context, const ups_key_t *key,
 
   *parent = 0;
 
+  if (unlikely(optimistic)) {
+    if (!node->is_leaf())
+      return traverse_tree_optimistic(page, key, parent);
+    context->changeset.lock(page);
+    return page;
+  }
+
   // if the root page is empty with children then collapse it
   if (unlikely(node->length() == 0 && !node->is_leaf())) {
     page = collapse_root(*this, page);
@@ -243,6 +253,43 @@ BtreeUpdateAction::traverse_tree(Context *context, const ups_key_t *key,
   return page;
 }
 
+Page *
+BtreeUpdateAction::traverse_tree_optimistic(Page *page, const ups_key_t *key,
+                Page **parent)
+{
+  BtreeNodeProxy *node = btree->get_node_from_page(page);
+
+  // an empty root page has to be collapsed
+  if (unlikely(node->length() == 0))
+    return 0;
+
+  // Walk down the tree without splitting the internal nodes; a full node
+  // is split by the next exclusive update, and the leaf can still accept
+  // the new key in most cases
+  int slot;
+  Page *child_page;
+  BtreeNodeProxy *child_node;
+  while (true) {
+    child_page = btree->find_lower_bound(context, page, key, 0, &slot);
+    child_node = btree->get_node_from_page(child_page);
+    if (child_node->is_leaf())
+      break;
+    page = child_page;
+    node = child_node;
+  }
+
+  // Lock the leaf; this can block while the PageManager is not locked.
+  // Afterwards it is safe to check whether the leaf has to be merged
+  context->changeset.lock(child_page);
+  if (unlikely(child_node->requires_merge()
+          && ((slot < (int)node->length() - 1 && child_node->right_sibling())
+              || (slot > 0 && child_node->left_sibling()))))
+    return 0;
+
+  *parent = page;
+  return child_page;
+}
+
 Page *
 BtreeUpdateAction::split_page(Page *old_page, Page *parent,
                 const ups_key_t *key, BtreeStatistics::InsertHints &hints)
@@ -43,16 +43,25 @@ struct BtreeUpdateAction {
   BtreeUpdateAction(BtreeIndex *btree_, Context *context_,
                   BtreeCursor *cursor_, uint32_t duplicate_index_)
     : btree(btree_), context(context_), cursor(cursor_),
-      duplicate_index(duplicate_index_) {
+      duplicate_index(duplicate_index_), optimistic(false) {
   }
 
   // Traverses the tree, looking for the leaf with the specified |key|. Will
   // split or merge nodes while descending.
   // Returns the leaf page and the |parent| of the leaf (can be null if
   // there is no parent).
+  //
+  // Optimistic updates do not modify the internal nodes; they are only
+  // pinned, and the leaf is locked. Returns null if a node would have to
+  // be split or merged.
   Page *traverse_tree(Context *context, const ups_key_t *key,
                       BtreeStatistics::InsertHints &hints, Page **parent);
 
+  // Implementation of traverse_tree() for optimistic updates if the root
+  // |page| is an internal node
+  Page *traverse_tree_optimistic(Page *page, const ups_key_t *key,
+                      Page **parent);
+
   // Splits |page| and updates the |parent|. If |parent| is null then
   // it's assumed that |page| is the root node.
   // Returns the new page in the path for |key|; caller can immediately
@@ -78,6 +87,13 @@ struct BtreeUpdateAction {
   // the duplicate index (in case the update is for a duplicate key)
   // 1-based (if 0 then this update is not for a duplicate)
   uint32_t duplicate_index;
+
+  // True if this update runs concurrently with other updates of the
+  // same database. All structure modifications (splits, merges) of the
+  // btree are performed exclusively, therefore the internal nodes do not
+  // change while optimistic updates are running. The caller repeats the
+  // update exclusively if it returns UPS_WOULD_BLOCK.
+  bool optimistic;
 };
 
 } // namespace upscaledb
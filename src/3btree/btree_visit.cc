@@ -83,15 +83,19 @@ struct BtreeVisitAction
     assert(page != 0);
 
     // now visit all leaf nodes
+    ReadAhead read_ahead;
     while (page) {
       BtreeNodeProxy *node = btree->get_node_from_page(page);
       uint64_t right = node->right_sibling();
+      uint64_t address = page->address();
 
       visitor(context, node);
 
       /* follow the pointer to the right sibling */
-      if (likely(right))
+      if (likely(right)) {
         page = env->page_manager->fetch(context, right, page_manager_flags);
+        env->page_manager->read_ahead(read_ahead, address, page);
+      }
       else
         break;
     }
@@ -20,14 +20,31 @@
  * The Cache Manager
  *
  * Stores pages in a non-intrusive hash table (each Page instance keeps
- * next/previous pointers for the overflow bucket). Can efficiently purge
+ * next/previous pointers for the overflow bucket). The number of buckets is
+ * derived from the cache capacity, and doubled whenever the cache stores
+ * more than two pages per bucket. Can efficiently purge
  * unused pages, because all pages are also stored in a (non-intrusive)
  * linked list, and whenever a page is accessed it is removed and re-inserted
  * at the head. The tail therefore points to the page which was not used
  * in a long time, and is the primary candidate for purging.
  *
+ * With UPS_CACHE_POLICY_2Q, the linked list is split in two queues. New
+ * pages are inserted into the probation queue (the "totallist"). Once
+ * they are accessed again they are promoted to the protected queue, which
+ * is managed as a LRU list and limited to 3/4 of the capacity. Pages are
+ * purged from the tail of the probation queue first. A large scan
+ * therefore only replaces pages of the probation queue, and cannot wash
+ * out the frequently used pages.
+ *
+ * Internal btree nodes are moved to a separate list when they are
+ * accessed. A part of the capacity is reserved for this list; its pages
+ * are only purged if they exceed the reserved capacity.
+ *
+ * Clean pages which are purged can be kept in the |compressed| cache;
+ * storing a page removes its compressed copy.
+ *
  * @exception_safe: nothrow
- * @thread_safe: yes
+ * @thread_safe: no (protected by the PageManager's lock)
  */
 
 #ifndef UPS_CACHE_H
@@ -43,7 +60,9 @@
 #include "2page/page.h"
 #include "2page/page_collection.h"
 #include "2config/env_config.h"
+#include "3btree/btree_node.h"
 #include "3cache/cache_state.h"
+#include "3cache/compressed_cache.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -52,11 +71,18 @@
 namespace upscaledb {
 
 namespace Impl {
-// Calculates the hash of a page address
-static inline size_t
+// Calculates the hash of a page address (the finalizer of MurmurHash3).
+// Page addresses are multiples of the page size, therefore all bits are
+// mixed before the lower bits are used as the bucket index.
+static inline uint64_t
 calc_hash(uint64_t value)
 {
-  return (size_t)(value % CacheState::kBucketSize);
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdull;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ull;
+  value ^= value >> 33;
+  return value;
 }
 } // namespace Impl
 
@@ -81,38 +107,104 @@ struct Cache
 
   // The default constructor
   Cache(const EnvConfig &config)
-    : state(config) {
+    : state(config), compressed(config) {
   }
 
-  // Fills in the current metrics
-  void fill_metrics(ups_env_metrics_t *metrics) const {
+  // Fills in the current metrics, including the statistics of the hash
+  // table's chain lengths
+  void fill_metrics(ups_env_metrics_t *metrics) {
     metrics->cache_hits = state.cache_hits;
     metrics->cache_misses = state.cache_misses;
+    metrics->cache_policy = (uint32_t)state.policy;
+    metrics->cache_hits_protected = state.cache_hits_protected;
+    metrics->cache_promotions = state.cache_promotions;
+    metrics->cache_demotions = state.cache_demotions;
+    metrics->cache_hits_read_ahead = state.cache_hits_read_ahead;
+    metrics->cache_hits_internal = state.cache_hits_internal;
+    metrics->cache_misses_internal = state.cache_misses_internal;
+    metrics->cache_internal_nodes = state.internallist.size();
+    compressed.fill_metrics(metrics);
+
+    metrics->cache_buckets = state.buckets.size();
+    metrics->cache_buckets_used = state.buckets_used;
+    metrics->cache_max_chain_length = state.max_chain_length;
+    metrics->cache_resizes = state.resizes;
   }
 
   // Retrieves a page from the cache, also removes the page from the cache
-  // and re-inserts it at the front. Returns null if the page was not cached.
+  // and re-inserts it at the front (with UPS_CACHE_POLICY_2Q: at the front
+  // of the protected queue). Returns null if the page was not cached.
   Page *get(uint64_t address) {
-    size_t hash = Impl::calc_hash(address);
-
-    Page *page = state.buckets[hash].get(address);
+    Page *page = lookup(address);
     if (!page) {
       state.cache_misses++;
       return 0;
     }
 
+    state.cache_hits++;
+
+    // Internal btree nodes are moved to their own list
+    if (state.internal_capacity > 0 && is_internal_node(page)) {
+      if (!state.internallist.del(page)) {
+        if (!state.totallist.del(page))
+          state.protectedlist.del(page);
+      }
+      state.internallist.put(page);
+      state.cache_hits_internal++;
+      return page;
+    }
+
+    // ... and back, if the page is no longer an internal node
+    if (unlikely(state.internallist.del(page)))
+      state.totallist.put(page);
+
+    if (unlikely(page->is_read_ahead())) {
+      page->set_read_ahead(false);
+      state.cache_hits_read_ahead++;
+      // This is the first access of a page which was read ahead; it is
+      // therefore not promoted to the protected queue
+      if (state.policy == UPS_CACHE_POLICY_2Q) {
+        state.totallist.del(page);
+        state.totallist.put(page);
+        return page;
+      }
+    }
+
+    if (state.policy == UPS_CACHE_POLICY_2Q) {
+      // The page was accessed at least twice; move it to the head of the
+      // protected queue
+      if (state.protectedlist.del(page)) {
+        state.cache_hits_protected++;
+      }
+      else {
+        state.totallist.del(page);
+        state.cache_promotions++;
+      }
+      state.protectedlist.put(page);
+      shrink_protectedlist();
+      return page;
+    }
+
     // Now re-insert the page at the head of the "totallist", and
     // thus move far away from the tail. The pages at the tail are highest
     // candidates to be deleted when the cache is purged.
     state.totallist.del(page);
     state.totallist.put(page);
-    state.cache_hits++;
     return page;
   }
 
   // Stores a page in the cache
   void put(Page *page) {
-    size_t hash = Impl::calc_hash(page->address());
+    if (unlikely(!state.pending_reads.empty()))
+      invalidate_pending_read(page->address());
+
+    // the compressed copy would be outdated as soon as the page is modified
+    compressed.erase(page->address());
+
+    // A page in the protected queue (or in the list of internal nodes)
+    // stays where it is
+    if (state.protectedlist.has(page) || state.internallist.has(page))
+      return;
 
     /* First remove the page from the cache, if it's already cached
      *
@@ -124,49 +216,120 @@ struct Cache
     if (page->is_allocated())
       state.alloc_elements++;
 
-    state.buckets[hash].put(page);
+    if (insert(page) && state.size > state.buckets.size() * 2)
+      grow();
   }
 
   // Removes a page from the cache
   void del(Page *page) {
     assert(page->address() != 0);
 
+    if (unlikely(!state.pending_reads.empty()))
+      invalidate_pending_read(page->address());
+
     /* remove it from the list of all cached pages */
-    if (state.totallist.del(page) && page->is_allocated())
+    if ((state.totallist.del(page) || state.protectedlist.del(page)
+              || state.internallist.del(page))
+            && page->is_allocated())
       state.alloc_elements--;
 
     /* remove the page from the cache buckets */
-    size_t hash = Impl::calc_hash(page->address());
-    state.buckets[hash].del(page);
+    CacheState::CacheLine &bucket = bucket_of(page->address());
+    if (bucket.del(page)) {
+      state.size--;
+      if (bucket.is_empty())
+        state.buckets_used--;
+    }
   }
 
-  // Purges the cache. Implements a LRU eviction algorithm. Dirty pages are
-  // forwarded to the |processor()| for flushing.
+  // Returns a cached page, but does not update the statistics or the
+  // order of the pages. Returns null if the page was not cached.
+  Page *peek(uint64_t address) {
+    return lookup(address);
+  }
+
+  // Announces that the page at |address| is not cached and will be read
+  // from the device while the PageManager is not locked. Counts a cache miss.
+  void begin_read(uint64_t address) {
+    state.cache_misses++;
+    state.pending_reads[address].readers++;
+  }
+
+  // Ends a read which was announced with |begin_read()|. Returns false if
+  // a page with the same address was stored or removed in the meantime;
+  // the page which was read might be stale and has to be discarded.
+  bool end_read(uint64_t address) {
+    std::map<uint64_t, CacheState::PendingRead>::iterator it
+            = state.pending_reads.find(address);
+    assert(it != state.pending_reads.end());
+    bool invalidated = it->second.invalidated;
+    if (--it->second.readers == 0)
+      state.pending_reads.erase(it);
+    return !invalidated;
+  }
+
+  // Announces that the page at |address| will be read ahead. Returns
+  // false if the page is already cached (also in the |compressed| cache)
+  // or currently read.
+  bool begin_read_ahead(uint64_t address) {
+    if (lookup(address) || state.pending_reads.count(address)
+          || compressed.pages.count(address))
+      return false;
+    state.pending_reads[address].readers++;
+    return true;
+  }
+
+  // Announces that a purged page is compressed while the PageManager is
+  // not locked. |end_read()| returns false if a page with the same address
+  // was stored or removed in the meantime; the compressed copy is then
+  // outdated and has to be discarded.
+  void begin_compress(uint64_t address) {
+    state.pending_reads[address].readers++;
+  }
+
+  // Stores a page which was read ahead, unless a page with the same address
+  // was stored or removed since |begin_read_ahead()|; its contents might be
+  // stale. |page| can be null if reading the page failed. Returns true if
+  // the page was stored.
+  bool end_read_ahead(uint64_t address, Page *page) {
+    if (!end_read(address) || !page || lookup(address))
+      return false;
+    page->set_read_ahead(true);
+    put(page);
+    return true;
+  }
+
+  // Purges the cache. Implements a LRU eviction algorithm; with
+  // UPS_CACHE_POLICY_2Q the probation queue is purged before the protected
+  // queue. Internal btree nodes are only purged if they exceed their
+  // reserved capacity. Dirty pages are forwarded to the |processor()| for flushing.
   // The |ignore_page| is passed by the caller; this page will not be purged
   // under any circumstance. This is used by the PageManager to make sure
   // that the "last blob page" is not evicted by the cache.
   void purge_candidates(std::vector<uint64_t> &candidates,
                   std::vector<Page *> &garbage,
                   Page *ignore_page) {
-    int limit = (int)(current_elements()
-                      - (state.capacity_bytes / state.page_size_bytes));
+    purge_candidates(candidates, garbage, ignore_page, state.capacity_bytes);
+  }
 
-    Page *page = state.totallist.tail();
-    for (int i = 0; i < limit && page != 0; i++) {
-      if (page->mutex().try_lock()) {
-        if (page->cursor_list.size() == 0
-              && page != ignore_page
-              && page->type() != Page::kTypeBroot) {
-          if (page->is_dirty())
-            candidates.push_back(page->address());
-          else
-            garbage.push_back(page);
-        }
-        page->mutex().unlock();
-      }
+  // Same as above, but purges the cache down to |capacity_bytes| instead
+  // of the configured capacity
+  void purge_candidates(std::vector<uint64_t> &candidates,
+                  std::vector<Page *> &garbage,
+                  Page *ignore_page, uint64_t capacity_bytes) {
+    int limit = (int)(current_elements()
+                      - (capacity_bytes / state.page_size_bytes));
 
-      page = page->previous(Page::kListCache);
+    if (state.internallist.size() > state.internal_capacity) {
+      int excess = std::min(limit, (int)(state.internallist.size()
+                                          - state.internal_capacity));
+      limit -= excess - purge_candidates(state.internallist, excess,
+                                          candidates, garbage, ignore_page);
     }
+    limit = purge_candidates(state.totallist, limit, candidates, garbage,
+                    ignore_page);
+    purge_candidates(state.protectedlist, limit, candidates, garbage,
+                    ignore_page);
   }
 
   // Visits all pages in the "totallist". If |cb| returns true then the
@@ -176,12 +339,18 @@ struct Cache
   void purge_if(Purger &purger) {
     PurgeIfSelector<Purger> selector(this, purger);
     state.totallist.extract(selector);
+    state.protectedlist.extract(selector);
+    state.internallist.extract(selector);
   }
 
   // Returns true if the capacity limits are exceeded
   bool is_cache_full() const {
-    return state.totallist.size() * state.page_size_bytes
-            > state.capacity_bytes;
+    return is_cache_full(state.capacity_bytes);
+  }
+
+  // Returns true if the cache exceeds |capacity_bytes|
+  bool is_cache_full(uint64_t capacity_bytes) const {
+    return current_elements() * state.page_size_bytes > capacity_bytes;
   }
 
   // Returns the capacity (in bytes)
@@ -191,7 +360,8 @@ struct Cache
 
   // Returns the number of currently cached elements
   size_t current_elements() const {
-    return state.totallist.size();
+    return state.totallist.size() + state.protectedlist.size()
+            + state.internallist.size();
   }
 
   // Returns the number of currently cached elements (excluding those that
@@ -200,7 +370,107 @@ struct Cache
     return state.alloc_elements;
   }
 
+  // Returns true if |page| is an internal btree node
+  static bool is_internal_node(Page *page) {
+    return !page->is_without_header()
+            && (page->type() == Page::kTypeBindex
+                || page->type() == Page::kTypeBroot)
+            && !PBtreeNode::from_page(page)->is_leaf();
+  }
+
+  // Marks a pending read of |address| as invalid
+  void invalidate_pending_read(uint64_t address) {
+    std::map<uint64_t, CacheState::PendingRead>::iterator it
+            = state.pending_reads.find(address);
+    if (it != state.pending_reads.end())
+      it->second.invalidated = true;
+  }
+
+  // Returns the bucket of a page address
+  CacheState::CacheLine &bucket_of(uint64_t address) {
+    uint64_t hash = Impl::calc_hash(address);
+    return state.buckets[hash & (state.buckets.size() - 1)];
+  }
+
+  // Looks up a page in the hash table
+  Page *lookup(uint64_t address) {
+    return bucket_of(address).get(address);
+  }
+
+  // Inserts a page in the hash table and updates the chain statistics.
+  // Returns false if the page was already stored.
+  bool insert(Page *page) {
+    CacheState::CacheLine &bucket = bucket_of(page->address());
+    if (!bucket.put(page))
+      return false;
+    state.size++;
+    if (bucket.size() == 1)
+      state.buckets_used++;
+    if (bucket.size() > state.max_chain_length)
+      state.max_chain_length = bucket.size();
+    return true;
+  }
+
+  // Doubles the number of buckets and re-distributes the pages
+  void grow() {
+    std::vector<CacheState::CacheLine> buckets(state.buckets.size() * 2);
+    buckets.swap(state.buckets);
+    state.size = 0;
+    state.buckets_used = 0;
+    state.max_chain_length = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+      while (Page *page = buckets[i].head()) {
+        buckets[i].del(page);
+        insert(page);
+      }
+    }
+    state.resizes++;
+  }
+
+  // Collects up to |limit| purge candidates, starting at the tail of
+  // |list|. Returns the remaining |limit|.
+  template<typename List>
+  int purge_candidates(List &list, int limit,
+                  std::vector<uint64_t> &candidates,
+                  std::vector<Page *> &garbage, Page *ignore_page) {
+    Page *page = list.tail();
+    for (; limit > 0 && page != 0; limit--) {
+      if (!page->is_pinned() && page->mutex().try_lock()) {
+        ScopedSpinlock lock(page->cursor_list_mutex);
+        if (page->cursor_list.size() == 0
+              && page != ignore_page
+              && page->type() != Page::kTypeBroot) {
+          if (page->is_dirty())
+            candidates.push_back(page->address());
+          else
+            garbage.push_back(page);
+        }
+        page->mutex().unlock();
+      }
+
+      page = page->previous(list.id());
+    }
+    return limit;
+  }
+
+  // UPS_CACHE_POLICY_2Q: limits the protected queue to 3/4 of the capacity;
+  // the least recently used pages are moved back to the probation queue
+  void shrink_protectedlist() {
+    uint64_t max_pages = state.capacity_bytes / state.page_size_bytes / 4 * 3;
+    if (max_pages == 0)
+      max_pages = 1;
+    while (state.protectedlist.size() > max_pages) {
+      Page *page = state.protectedlist.tail();
+      state.protectedlist.del(page);
+      state.totallist.put(page);
+      state.cache_demotions++;
+    }
+  }
+
   CacheState state;
+
+  // The compressed second-level cache
+  CompressedCache compressed;
 };
 
 } // namespace upscaledb
@@ -21,6 +21,7 @@
 
 #include "0root/root.h"
 
+#include <map>
 #include <vector>
 
 #include "ups/types.h"
@@ -40,10 +41,28 @@ struct CacheState
 {
   typedef PageCollection<Page::kListBucket> CacheLine;
 
+  // A page which is currently read from the device while the PageManager
+  // is not locked
+  struct PendingRead {
+    PendingRead()
+      : readers(0), invalidated(false) {
+    }
+
+    // the number of threads which read the page
+    int readers;
+
+    // set to true if a page with this address is stored or removed in the
+    // meantime; the pages which were read are then discarded
+    bool invalidated;
+  };
+
   enum {
-    // The number of buckets should be a prime number or similar, as it
-    // is used in a MODULO hash scheme
-    kBucketSize = 10317,
+    // The minimum number of buckets
+    kMinBuckets = 1024,
+
+    // The maximum number of buckets which are allocated up front; if the
+    // cache grows beyond this size then the buckets are resized
+    kMaxInitialBuckets = 1024 * 1024,
   };
 
   CacheState(const EnvConfig &config)
@@ -51,8 +70,27 @@ struct CacheState
                             ? std::numeric_limits<uint64_t>::max()
                             : config.cache_size_bytes),
       page_size_bytes(config.page_size_bytes), alloc_elements(0),
-      buckets(kBucketSize), cache_hits(0), cache_misses(0) {
+      policy(config.cache_policy), size(0), buckets_used(0),
+      max_chain_length(0), resizes(0), cache_hits(0), cache_misses(0),
+      cache_hits_protected(0), cache_promotions(0), cache_demotions(0),
+      cache_hits_read_ahead(0), cache_hits_internal(0),
+      cache_misses_internal(0) {
     assert(capacity_bytes > 0);
+
+    // one bucket per page, if the cache is full; an unlimited cache starts
+    // small and grows on demand
+    uint64_t pages = ISSET(config.flags, UPS_CACHE_UNLIMITED)
+                        ? 0
+                        : capacity_bytes / page_size_bytes;
+    size_t initial = kMinBuckets;
+    while (initial < pages && initial < kMaxInitialBuckets)
+      initial <<= 1;
+    buckets.resize(initial);
+
+    uint64_t capacity_pages = capacity_bytes / page_size_bytes;
+    uint64_t percent = config.cache_internal_nodes_percent;
+    internal_capacity = capacity_pages / 100 * percent
+                            + capacity_pages % 100 * percent / 100;
   }
 
   // the capacity (in bytes)
@@ -65,17 +103,70 @@ struct CacheState
   // mapped)
   size_t alloc_elements;
 
-  // linked list of ALL cached pages
+  // the replacement policy (UPS_CACHE_POLICY_*)
+  int policy;
+
+  // linked list of ALL cached pages; with UPS_CACHE_POLICY_2Q this is the
+  // probation queue, and contains only the pages which are not in the
+  // |protectedlist|
   PageCollection<Page::kListCache> totallist;
 
-  // The hash table buckets - each is a linked list of Page pointers
+  // UPS_CACHE_POLICY_2Q: linked list of the pages which were accessed
+  // at least twice
+  PageCollection<Page::kListCacheProtected> protectedlist;
+
+  // the number of pages which are reserved for internal btree nodes
+  uint64_t internal_capacity;
+
+  // linked list of the internal btree nodes; they are not stored in the
+  // |totallist| or the |protectedlist|
+  PageCollection<Page::kListCacheInternal> internallist;
+
+  // The hash table buckets - each is a linked list of Page pointers. The
+  // number of buckets is always a power of two.
   std::vector<CacheLine> buckets;
 
+  // the number of pages stored in the |buckets|
+  size_t size;
+
+  // the number of |buckets| which are not empty
+  size_t buckets_used;
+
+  // the length of the longest chain since the last resize; chains are
+  // not re-measured when pages are removed
+  size_t max_chain_length;
+
+  // counts the resize operations of the |buckets|
+  uint64_t resizes;
+
+  // The addresses of pages which are currently read ahead, compressed
+  // after they were purged, or fetched by threads which released the
+  // PageManager's lock during the read
+  std::map<uint64_t, PendingRead> pending_reads;
+
   // counts the cache hits
   uint64_t cache_hits;
 
   // counts the cache misses
   uint64_t cache_misses;
+
+  // counts the cache hits in the |protectedlist|
+  uint64_t cache_hits_protected;
+
+  // counts the pages moved to the |protectedlist|
+  uint64_t cache_promotions;
+
+  // counts the pages moved from the |protectedlist| to the |totallist|
+  uint64_t cache_demotions;
+
+  // counts the cache hits of pages which were read ahead
+  uint64_t cache_hits_read_ahead;
+
+  // counts the cache hits of internal btree nodes
+  uint64_t cache_hits_internal;
+
+  // counts the cache misses of internal btree nodes
+  uint64_t cache_misses_internal;
 };
 
 } // namespace upscaledb
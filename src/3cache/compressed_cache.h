@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * The compressed (second-level) cache
+ *
+ * Keeps clean pages which were purged from the Cache in compressed form,
+ * with a LRU list and a capacity limit (in bytes of compressed data).
+ * When a page is fetched again, it is decompressed instead of being read
+ * from disk.
+ *
+ * A page is either in the Cache or in the compressed cache, but never in
+ * both: the Cache removes the compressed copy whenever a page is stored,
+ * and the compressed copy is removed when it is fetched. Therefore a
+ * compressed copy is never older than the page on disk.
+ *
+ * Pages which do not compress to less than 7/8 of their size are not
+ * stored.
+ *
+ * @exception_safe: strong
+ * @thread_safe: no (except for |compress()|)
+ */
+
+#ifndef UPS_COMPRESSED_CACHE_H
+#define UPS_COMPRESSED_CACHE_H
+
+#include "0root/root.h"
+
+#include <map>
+#include <boost/atomic.hpp>
+
+#include "ups/upscaledb_int.h"
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/intrusive_list.h"
+#include "1base/mutex.h"
+#include "1base/scoped_ptr.h"
+#include "1mem/mem.h"
+#include "1mem/page_pool.h"
+#include "2config/env_config.h"
+#include "2compressor/compressor_factory.h"
+#include "2page/page.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+// A compressed copy of a page
+struct CompressedPage
+{
+  CompressedPage(uint64_t address_, const uint8_t *data_, uint32_t size_)
+    : address(address_), size(size_),
+      data(Memory::allocate<uint8_t>(size_)) {
+    ::memcpy(data, data_, size);
+  }
+
+  ~CompressedPage() {
+    Memory::release(data);
+  }
+
+  // The address of the page
+  uint64_t address;
+
+  // The size of the compressed data
+  uint32_t size;
+
+  // The compressed data
+  uint8_t *data;
+
+  // For the LRU list
+  IntrusiveListNode<CompressedPage> list_node;
+};
+
+struct CompressedCache
+{
+  typedef std::map<uint64_t, CompressedPage *> PageMap;
+
+  // Constructor; the compressed cache is disabled if
+  // UPS_PARAM_COMPRESSED_CACHE_SIZE is 0
+  CompressedCache(const EnvConfig &config)
+    : capacity_bytes(config.compressed_cache_size_bytes),
+      page_size_bytes(config.page_size_bytes), used_bytes(0),
+      pool(PagePool::instance(config.page_size_bytes)), hits(0),
+      misses(0), rejected(0) {
+    if (capacity_bytes > 0)
+      compressor.reset(CompressorFactory::create(
+                              config.compressed_cache_compressor));
+  }
+
+  // Destructor
+  ~CompressedCache() {
+    clear();
+  }
+
+  // Returns true if the compressed cache is enabled
+  bool is_enabled() const {
+    return capacity_bytes > 0;
+  }
+
+  // Stores a compressed copy of the page at |address|. Purges the least
+  // recently used pages if the capacity is exceeded.
+  void put(uint64_t address, const uint8_t *data) {
+    CompressedPage *page = compress(address, data);
+    if (page)
+      put(page);
+    else
+      erase(address);
+  }
+
+  // Compresses the page at |address|. Returns null if the page does not
+  // compress to less than 7/8 of its size. Does not modify the cached
+  // pages and can be called without holding the PageManager's lock.
+  CompressedPage *compress(uint64_t address, const uint8_t *data) {
+    ScopedLock lock(compressor_mutex);
+    uint32_t size = compressor->compress(data, (uint32_t)page_size_bytes);
+    if (size >= page_size_bytes / 8 * 7 || size > capacity_bytes) {
+      rejected++;
+      return 0;
+    }
+    return new CompressedPage(address, compressor->arena.data(), size);
+  }
+
+  // Stores a page which was compressed with |compress()|; replaces an
+  // older copy. Purges the least recently used pages if the capacity is
+  // exceeded.
+  void put(CompressedPage *page) {
+    erase(page->address);
+
+    while (used_bytes + page->size > capacity_bytes)
+      erase(lru.tail());
+
+    pages[page->address] = page;
+    lru.put(page);
+    used_bytes += page->size;
+  }
+
+  // Decompresses the page at |address| into a new buffer of |page|, then
+  // removes the compressed copy. Returns false if the page is not cached.
+  bool fetch(uint64_t address, Page *page) {
+    PageMap::iterator it = pages.find(address);
+    if (it == pages.end()) {
+      misses++;
+      return false;
+    }
+
+    CompressedPage *compressed = it->second;
+    uint8_t *p = pool->allocate();
+    page->assign_allocated_buffer(p, address, pool);
+    compressor->decompress(compressed->data, compressed->size,
+                    (uint32_t)page_size_bytes, p);
+    erase(compressed);
+    hits++;
+    return true;
+  }
+
+  // Removes the page at |address|, if it is cached
+  void erase(uint64_t address) {
+    if (pages.empty())
+      return;
+    PageMap::iterator it = pages.find(address);
+    if (it != pages.end())
+      erase(it->second);
+  }
+
+  // Removes a page
+  void erase(CompressedPage *page) {
+    lru.del(page);
+    pages.erase(page->address);
+    used_bytes -= page->size;
+    delete page;
+  }
+
+  // Removes all pages
+  void clear() {
+    while (CompressedPage *page = lru.head())
+      erase(page);
+  }
+
+  // Fills in the current metrics
+  void fill_metrics(ups_env_metrics_t *metrics) const {
+    metrics->compressed_cache_hits = hits;
+    metrics->compressed_cache_misses = misses;
+    metrics->compressed_cache_rejected = rejected;
+    metrics->compressed_cache_pages = pages.size();
+    metrics->compressed_cache_bytes = used_bytes;
+    metrics->compressed_cache_uncompressed_bytes = pages.size()
+                                                    * page_size_bytes;
+  }
+
+  // The capacity (in bytes of compressed data)
+  uint64_t capacity_bytes;
+
+  // The page size
+  uint64_t page_size_bytes;
+
+  // The number of bytes which are currently used
+  uint64_t used_bytes;
+
+  // The pool for the buffers of the decompressed pages
+  PagePool *pool;
+
+  // The compressor
+  ScopedPtr<Compressor> compressor;
+
+  // Protects the |compressor|'s output buffer in |compress()|
+  Mutex compressor_mutex;
+
+  // The cached pages, indexed by their address
+  PageMap pages;
+
+  // The pages in LRU order; the least recently stored page is at the tail
+  IntrusiveList<CompressedPage> lru;
+
+  // Number of pages which were fetched from this cache
+  uint64_t hits;
+
+  // Number of pages which were not found in this cache
+  uint64_t misses;
+
+  // Number of pages which were not stored because they did not compress
+  boost::atomic<uint64_t> rejected;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_COMPRESSED_CACHE_H */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+#include "0root/root.h"
+
+#include <algorithm>
+
+// Always verify that a file of level N does not include headers > N!
+#include "3cache/shared_cache.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+typedef std::pair<uint64_t, SharedCacheMember *> Overuse;
+
+static bool
+compare_overuse(const Overuse &lhs, const Overuse &rhs)
+{
+  return lhs.first > rhs.first;
+}
+
+SharedCache *
+SharedCache::instance()
+{
+  static SharedCache shared_cache;
+  return &shared_cache;
+}
+
+void
+SharedCache::join(SharedCacheMember *member, uint64_t capacity)
+{
+  ScopedLock lock(mutex);
+  if (members.empty())
+    capacity_bytes = capacity;
+  members.push_back(member);
+  total_weight += member->weight;
+  used_bytes += member->used_bytes;
+}
+
+void
+SharedCache::leave(SharedCacheMember *member)
+{
+  ScopedLock lock(mutex);
+  std::vector<SharedCacheMember *>::iterator it = std::find(members.begin(),
+                  members.end(), member);
+  if (it == members.end())
+    return;
+  members.erase(it);
+  total_weight -= member->weight;
+  used_bytes -= member->used_bytes;
+}
+
+void
+SharedCache::account(SharedCacheMember *member, uint64_t used)
+{
+  uint64_t previous = member->used_bytes.exchange(used);
+  used_bytes += used - previous;
+}
+
+uint64_t
+SharedCache::update(SharedCacheMember *member, uint64_t used)
+{
+  account(member, used);
+  if (used_bytes <= capacity_bytes)
+    return used;
+
+  ScopedLock lock(mutex);
+  uint64_t total = used_bytes;
+  if (total <= capacity_bytes)
+    return used;
+  uint64_t excess = total - capacity_bytes;
+
+  // above the share: purge the own cache
+  uint64_t share = share_of_nolock(member);
+  if (used > share)
+    return std::max(share, used - std::min(used, excess));
+
+  // below the share: shrink the members which exceed their share, starting
+  // with the one which exceeds it the most
+  std::vector<Overuse> overuse;
+  for (std::vector<SharedCacheMember *>::iterator it = members.begin();
+                  it != members.end(); it++) {
+    SharedCacheMember *m = *it;
+    uint64_t s = share_of_nolock(m);
+    uint64_t u = m->used_bytes;
+    if (m != member && u > s)
+      overuse.push_back(Overuse(u - s, m));
+  }
+  std::sort(overuse.begin(), overuse.end(), compare_overuse);
+
+  for (std::vector<Overuse>::iterator it = overuse.begin();
+                  it != overuse.end() && excess > 0; it++) {
+    uint64_t amount = std::min(it->first, excess);
+    if (it->second->try_shrink(it->second->used_bytes - amount)) {
+      it->second->shrinks++;
+      excess -= amount;
+    }
+  }
+
+  // the remaining excess is purged by the busy members when they exceed
+  // their share
+  return used;
+}
+
+uint64_t
+SharedCache::share_of(const SharedCacheMember *member)
+{
+  ScopedLock lock(mutex);
+  return share_of_nolock(member);
+}
+
+} // namespace upscaledb
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * A cache budget which is shared by several Environments
+ *
+ * All Environments of a process which set UPS_PARAM_SHARED_CACHE_SIZE join
+ * the same SharedCache. Each Environment still manages its own Cache, but
+ * purges it according to the shared capacity. As long as all Environments
+ * together stay below that capacity, no Environment purges its cache.
+ *
+ * Once the capacity is exceeded, each Environment is entitled to a share
+ * of the capacity which is proportional to its weight
+ * (UPS_PARAM_SHARED_CACHE_WEIGHT). An Environment above its share purges
+ * its own cache. An Environment below its share asks the Environments
+ * above their share to shrink their caches; idle Environments therefore
+ * hand their memory over to busy ones.
+ *
+ * @exception_safe: basic
+ * @thread_safe: yes
+ */
+
+#ifndef UPS_SHARED_CACHE_H
+#define UPS_SHARED_CACHE_H
+
+#include "0root/root.h"
+
+#include <vector>
+#include <boost/atomic.hpp>
+
+// Always verify that a file of level N does not include headers > N!
+#include "1base/mutex.h"
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+// An Environment which joined the SharedCache
+struct SharedCacheMember
+{
+  SharedCacheMember(uint32_t weight_)
+    : weight(weight_), used_bytes(0), shrinks(0) {
+  }
+
+  virtual ~SharedCacheMember() {
+  }
+
+  // Purges the cache of this member down to |capacity_bytes|. Called by
+  // other Environments; returns false if the member is currently busy.
+  virtual bool try_shrink(uint64_t capacity_bytes) = 0;
+
+  // The weight of this member
+  uint32_t weight;
+
+  // The number of bytes which are currently cached by this member
+  boost::atomic<uint64_t> used_bytes;
+
+  // Counts how often this member was shrunk by other members
+  boost::atomic<uint64_t> shrinks;
+};
+
+struct SharedCache
+{
+  // Returns the SharedCache of this process
+  static SharedCache *instance();
+
+  // Constructor
+  SharedCache()
+    : capacity_bytes(0), used_bytes(0), total_weight(0) {
+  }
+
+  // Adds a member. If it is the only member then the capacity is set to
+  // |capacity_bytes|, otherwise the current capacity is kept.
+  void join(SharedCacheMember *member, uint64_t capacity_bytes);
+
+  // Removes a member; does nothing if |member| is not a member
+  void leave(SharedCacheMember *member);
+
+  // Updates the number of bytes cached by |member|, without locking
+  void account(SharedCacheMember *member, uint64_t used_bytes);
+
+  // Updates the number of bytes cached by |member| and returns the capacity
+  // to which the member has to purge its cache. If the member is below its
+  // share then other members are shrunk instead.
+  uint64_t update(SharedCacheMember *member, uint64_t used_bytes);
+
+  // Returns the share of the capacity to which |member| is entitled
+  uint64_t share_of(const SharedCacheMember *member);
+
+  // Returns the share of |member|; the caller has to lock |mutex|
+  uint64_t share_of_nolock(const SharedCacheMember *member) const {
+    if (total_weight == 0)
+      return capacity_bytes;
+    return capacity_bytes / total_weight * member->weight;
+  }
+
+  // Protects the members
+  Mutex mutex;
+
+  // The capacity of the shared cache
+  boost::atomic<uint64_t> capacity_bytes;
+
+  // The number of bytes which are cached by all members
+  boost::atomic<uint64_t> used_bytes;
+
+  // The sum of the weights of all members
+  uint64_t total_weight;
+
+  // All members
+  std::vector<SharedCacheMember *> members;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_SHARED_CACHE_H */
@@ -20,6 +20,8 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
+
 // Always verify that a file of level N does not include headers > N!
 #include "1base/signal.h"
 #include "1errorinducer/errorinducer.h"
@@ -41,6 +43,7 @@ void (*g_CHANGESET_POST_LOG_HOOK)(void);
 
 struct UnlockPage {
   bool operator()(Page *page) {
+    page->set_changeset(0);
 #ifdef UPS_ENABLE_HELGRIND
     page->mutex().try_lock();
 #endif
@@ -53,6 +56,7 @@ struct FlushChangesetVisitor {
   bool operator()(Page *page) {
     assert(page->mutex().try_lock() == false);
 
+    page->set_changeset(0);
     if (page->is_dirty())
       list.push_back(page);
     else
@@ -63,6 +67,12 @@ struct FlushChangesetVisitor {
   std::vector<Page *> list;
 };
 
+static bool
+compare_address(const Page *lhs, const Page *rhs)
+{
+  return lhs->address() < rhs->address();
+}
+
 static void
 flush_changeset_to_file(std::vector<Page *> list, Device *device,
                 Journal *journal, uint64_t lsn, bool enable_fsync)
@@ -79,11 +89,30 @@ flush_changeset_to_file(std::vector<Page *> list, Device *device,
 
     if (likely(page->is_without_header() == false))
       page->set_lsn(lsn);
+  }
 
-    page->flush();
-    page->mutex().unlock();
+  // a device with batched writes submits all pages at once
+  if (list.size() > 1 && device->write_pages(list)) {
+    for (it = list.begin(); it != list.end(); it++)
+      (*it)->mutex().unlock();
     UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
   }
+  // otherwise pages with adjacent addresses are written with a single
+  // pwritev()
+  else {
+    std::sort(list.begin(), list.end(), compare_address);
+    size_t first = 0;
+    for (size_t i = 1; i <= list.size(); i++) {
+      if (i < list.size() && list[i]->address() == list[i - 1]->address()
+                                + list[i - 1]->persisted_data.size)
+        continue;
+
+      Page::flush_run(&list[first], i - first);
+      for (; first < i; first++)
+        list[first]->mutex().unlock();
+      UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
+    }
+  }
 
   /* flush the file handle (if required) */
   if (enable_fsync)
@@ -92,12 +121,32 @@ flush_changeset_to_file(std::vector<Page *> list, Device *device,
   UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
 }
 
+void
+Changeset::lock_shared_pages()
+{
+  if (read_only || shared_pages_locked || !env)
+    return;
+  env->shared_pages_mutex.lock();
+  shared_pages_locked = true;
+}
+
 void
 Changeset::clear()
 {
   UnlockPage unlocker;
   collection.for_each(unlocker);
   collection.clear();
+
+  for (std::vector<Page *>::iterator it = pinned.begin();
+                  it != pinned.end();
+                  it++)
+    (*it)->unpin();
+  pinned.clear();
+
+  if (shared_pages_locked) {
+    shared_pages_locked = false;
+    env->shared_pages_mutex.unlock();
+  }
 }
 
 void
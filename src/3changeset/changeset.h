@@ -30,6 +30,7 @@
 #include "0root/root.h"
 
 #include <stdlib.h>
+#include <vector>
 
 // Always verify that a file of level N does not include headers > N!
 #include "2config/env_config.h"
@@ -45,8 +46,8 @@ namespace upscaledb {
 struct LocalEnv;
 
 struct Changeset {
-  Changeset(LocalEnv *env_)
-  : env(env_) {
+  Changeset(LocalEnv *env_, bool read_only_ = false)
+  : env(env_), read_only(read_only_), shared_pages_locked(false) {
   }
 
   /*
@@ -57,30 +58,77 @@ struct Changeset {
     return collection.get(address);
   }
 
-  /* Append a new page to the changeset. The page is locked. */
+  /*
+   * Append a new page to the changeset. The page is locked, or pinned
+   * if the changeset is read-only.
+   */
   void put(Page *page) {
-    if (!has(page))
+    if (read_only) {
+      page->pin();
+      pinned.push_back(page);
+      return;
+    }
+    if (!has(page)) {
+      page->mutex().lock();
+      page->set_changeset(this);
+      collection.put(page);
+    }
+  }
+
+  /*
+   * Locks a page which was pinned by a read-only changeset (i.e. the leaf
+   * of an optimistic update). The changeset is no longer read-only, all
+   * following pages are locked as well. Must not be called while the
+   * PageManager is locked, since this can block.
+   */
+  void lock(Page *page) {
+    read_only = false;
+    if (!has(page)) {
       page->mutex().lock();
-    collection.put(page);
+      page->set_changeset(this);
+      collection.put(page);
+    }
   }
 
   /* Removes a page from the changeset. The page is unlocked. */
   void del(Page *page) {
-    page->mutex().unlock();
     collection.del(page);
+    page->set_changeset(0);
+    page->mutex().unlock();
   }
 
-  /* Check if the page is already part of the changeset */
+  /*
+   * Check if the page is already part of the changeset. The page can be
+   * part of another thread's Changeset if several writers run concurrently.
+   */
   bool has(Page *page) const {
-    return collection.has(page);
+    return page->changeset() == this;
   }
 
   /* Returns true if the changeset is empty */
   bool is_empty() const {
-    return collection.is_empty();
+    return collection.is_empty() && pinned.empty();
   }
 
-  /* Removes all pages from the changeset. The pages are unlocked. */
+  /* Returns true if the pages are pinned instead of locked */
+  bool is_read_only() const {
+    return read_only;
+  }
+
+  /*
+   * Acquires the Environment's lock for pages which are shared by all
+   * databases (blob pages and the header page) before such a page is
+   * fetched. Writers of different databases run concurrently and otherwise
+   * only lock pages of their own database. The lock is held till clear()
+   * unlocked the pages. Not required for read-only changesets, since they
+   * never wait for a page.
+   */
+  void lock_shared_pages();
+
+  /*
+   * Removes all pages from the changeset. The pages are unlocked, then
+   * the lock for the shared pages is released.
+   */
   void clear();
 
   /*
@@ -95,6 +143,19 @@ struct Changeset {
 
   /* The pages which were added to this Changeset */
   PageCollection<Page::kListChangeset> collection;
+
+  /*
+   * Read-only operations run concurrently and therefore do not lock their
+   * pages; they are pinned instead, which protects them from being purged.
+   * A page can be pinned multiple times.
+   */
+  bool read_only;
+
+  /* The pinned pages of a read-only Changeset */
+  std::vector<Page *> pinned;
+
+  /* True if this Changeset holds the lock for the shared pages */
+  bool shared_pages_locked;
 };
 
 } // namespace upscaledb
@@ -19,15 +19,19 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <algorithm>
 #ifndef WIN32
 #  include <libgen.h>
 #endif
 
 #include "1base/error.h"
+#include "1base/signal.h"
+#include "1base/util.h"
 #include "1errorinducer/errorinducer.h"
 #include "1os/os.h"
 #include "2device/device.h"
 #include "2compressor/compressor_factory.h"
+#include "2worker/worker.h"
 #include "3journal/journal.h"
 #include "3page_manager/page_manager.h"
 #include "4db/db.h"
@@ -47,21 +51,63 @@ enum {
   // switch log file after |kSwitchTxnThreshold| transactions
   kSwitchTxnThreshold = 32,
 
+  // the minimum (and default) number of journal segments
+  kMinSegments = 2,
+
   // flush buffers if this limit is exceeded
   kBufferLimit = 1024 * 1024, // 1 mb
+
+  // max. size of the page images which are kept for calculating deltas
+  kPageImageLimit = 4 * 1024 * 1024, // 4 mb
+
+  // modified byte ranges of a page delta are merged if they are separated
+  // by less than |kDeltaMergeGap| unmodified bytes
+  kDeltaMergeGap = 16,
+
+  // min. number of pages per thread when restoring the changesets
+  kRecoveryPagesPerThread = 16,
 };
 
+static inline uint64_t
+load64(const uint8_t *p)
+{
+  uint64_t v;
+  ::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Discards all page images; the next changeset entry of each page will
+// store the full page
 static inline void
-clear_file(JournalState &state, int idx)
+clear_page_images(JournalState &state)
 {
-  if (state.files[idx].is_open()) {
-    state.files[idx].truncate(0);
+  state.page_images.clear();
+  state.page_images_lru.clear();
+}
 
-    // after truncate, the file pointer is far beyond the new end of file;
-    // reset the file pointer, or the next write will resize the file to
-    // the original size
-    state.files[idx].seek(0, File::kSeekSet);
+// Discards the contents of a segment. Preallocated segments keep their
+// size; an empty entry at the beginning marks them as empty
+static inline void
+clear_file(JournalState &state, int idx)
+{
+  JournalState::Segment &segment = state.segments[idx];
+
+  if (segment.file.is_open()) {
+    if (state.segment_size > 0) {
+      PJournalEntry end;
+      segment.file.pwrite(0, &end, sizeof(end));
+      // the old entries must not be recovered if the segment is reused
+      // and the system crashes before the next fsync
+      if (ISSET(state.env->flags(), UPS_ENABLE_FSYNC))
+        segment.file.flush();
+    }
+    else {
+      segment.file.truncate(0);
+    }
   }
+
+  segment.position = 0;
+  segment.sequence = 0;
 }
 
 static inline std::string
@@ -86,25 +132,198 @@ log_file_path(JournalState &state, int i)
     path += ::basename((char *)state.env->config.filename.c_str());
 #endif
   }
-  if (i == 0)
-    path += ".jrn0";
-  else if (i == 1)
-    path += ".jrn1";
-  else
-    assert(!"invalid index");
+
+  char suffix[32];
+  util_snprintf(suffix, sizeof(suffix), ".jrn%d", i);
+  path += suffix;
   return (path);
 }
 
+// Creates the file of a new segment; preallocates the file if
+// |segment_size| is set
+static inline void
+create_segment(JournalState &state, int i, JournalState::Segment *segment)
+{
+  std::string path = log_file_path(state, i);
+  segment->file.create(path.c_str(), 0644);
+  if (state.segment_size > 0)
+    segment->file.allocate(state.segment_size);
+}
+
+// Waits till a running fsync is finished. Journal::sync() accesses the
+// segments without holding the lock; they must not be added or removed
+// in the meantime
 static inline void
-flush_buffer(JournalState &state, int idx, bool fsync = false)
+wait_for_sync(JournalState &state, ScopedLock &lock)
+{
+  while (state.sync_in_progress)
+    state.sync_cond.wait(lock);
+}
+
+// Reads the headers of all entries of a segment, and sets the position
+// after the last valid entry. Returns the highest lsn of the segment.
+static inline uint64_t
+scan_segment(JournalState::Segment &segment)
+{
+  PJournalEntry entry;
+  uint64_t offset = 0;
+  uint64_t max_lsn = 0;
+  uint64_t file_size = segment.file.file_size();
+
+  while (offset + sizeof(entry) <= file_size) {
+    segment.file.pread(offset, &entry, sizeof(entry));
+    // the end of a preallocated segment, or a truncated entry
+    if (entry.lsn == 0
+          || entry.followup_size > file_size - offset - sizeof(entry))
+      break;
+    max_lsn = std::max(max_lsn, entry.lsn);
+    offset += sizeof(entry) + entry.followup_size;
+  }
+
+  segment.position = offset;
+  return max_lsn;
+}
+
+// Returns the indices of all segments which are not empty, from the
+// oldest to the newest
+static inline std::vector<uint32_t>
+ordered_segments(JournalState &state)
+{
+  std::vector<std::pair<uint64_t, uint32_t> > sequences;
+  for (uint32_t i = 0; i < state.segments.size(); i++) {
+    if (state.segments[i].position > 0)
+      sequences.push_back(std::make_pair(state.segments[i].sequence, i));
+  }
+  std::sort(sequences.begin(), sequences.end());
+
+  std::vector<uint32_t> segments;
+  for (size_t i = 0; i < sequences.size(); i++)
+    segments.push_back(sequences[i].second);
+  return segments;
+}
+
+// Writes the buffer to the file. |lsn| is the lsn of the newest entry in
+// the buffer. The data is not yet durable; see Journal::sync().
+static inline void
+flush_buffer(JournalState &state, int idx, uint64_t lsn = 0)
 {
   if (likely(state.buffer.size() > 0)) {
-    state.files[idx].write(state.buffer.data(), state.buffer.size());
-    state.count_bytes_flushed += state.buffer.size();
+    JournalState::Segment &segment = state.segments[idx];
+    size_t size = state.buffer.size();
+
+    // a preallocated segment can contain older entries behind the new
+    // data; they are hidden by an empty entry, which is overwritten
+    // by the next write
+    if (state.segment_size > 0) {
+      PJournalEntry end;
+      state.buffer.append((uint8_t *)&end, sizeof(end));
+    }
+
+    segment.file.pwrite(segment.position, state.buffer.data(),
+                    state.buffer.size());
+    segment.position += size;
+    state.count_bytes_flushed += size;
+    state.bytes_since_checkpoint += size;
 
     state.buffer.clear();
-    if (unlikely(fsync))
-      state.files[idx].flush();
+
+    ScopedLock lock(state.sync_mutex);
+    segment.unsynced = true;
+    if (lsn > state.written_lsn)
+      state.written_lsn = lsn;
+  }
+}
+
+// Called by the worker thread of the PageManager. The worker processes
+// its messages in order; all pages of the changesets which were logged
+// before the checkpoint started are now written to the database file
+static void
+notify_checkpoint(boost::shared_ptr<JournalState::Checkpoint> checkpoint)
+{
+  checkpoint->completed.notify();
+}
+
+// Appends an empty checkpoint record and writes it to the current segment.
+// Checkpoint records do not consume an lsn; they share the lsn with the
+// next entry, which keeps the segments in order
+static inline uint64_t
+append_checkpoint_record(JournalState &state, uint32_t type)
+{
+  PJournalEntry entry;
+  entry.type = type;
+  entry.lsn = state.env->lsn_manager.current;
+
+  state.buffer.append((uint8_t *)&entry, sizeof(entry));
+  flush_buffer(state, state.current_fd);
+  return entry.lsn;
+}
+
+// Starts a new checkpoint in the current segment
+static inline void
+begin_checkpoint(JournalState &state)
+{
+  assert(state.checkpoint.get() == 0);
+
+  state.checkpoint.reset(new JournalState::Checkpoint);
+  state.checkpoint->lsn = append_checkpoint_record(state,
+                  Journal::kEntryTypeCheckpointBegin);
+  state.checkpoint->sequence = state.segments[state.current_fd].sequence;
+  state.bytes_since_checkpoint = 0;
+
+  // changesets after the checkpoint are recovered without the older ones;
+  // they must not store deltas of older page images
+  clear_page_images(state);
+
+  state.env->page_manager->run_async(boost::bind(&notify_checkpoint,
+                          state.checkpoint));
+}
+
+// Completes the running checkpoint; the segments which are older than
+// its "begin" record can now be reused
+static inline void
+end_checkpoint(JournalState &state)
+{
+  append_checkpoint_record(state, Journal::kEntryTypeCheckpointEnd);
+
+  state.checkpoint_sequence = state.checkpoint->sequence;
+  state.checkpoint_lsn = state.checkpoint->lsn;
+  state.count_checkpoints++;
+  state.checkpoint.reset();
+}
+
+// Completes the running checkpoint if the worker thread is done with it,
+// and starts a new one if enough data was written since the last one
+static inline void
+checkpoint_maybe(JournalState &state)
+{
+  if (state.checkpoint) {
+    ScopedLock lock(state.checkpoint->completed.mutex);
+    if (!state.checkpoint->completed.completed)
+      return;
+    lock.unlock();
+    end_checkpoint(state);
+  }
+
+  if (state.checkpoint_size > 0
+        && state.bytes_since_checkpoint >= state.checkpoint_size)
+    begin_checkpoint(state);
+}
+
+// Blocks till all segments before the current one are covered by a
+// completed checkpoint
+static inline void
+checkpoint_now(JournalState &state)
+{
+  // the running checkpoint might already be sufficient
+  if (state.checkpoint) {
+    state.checkpoint->completed.wait();
+    end_checkpoint(state);
+  }
+
+  if (state.checkpoint_sequence < state.segments[state.current_fd].sequence) {
+    begin_checkpoint(state);
+    state.checkpoint->completed.wait();
+    end_checkpoint(state);
   }
 }
 
@@ -122,43 +341,32 @@ read_entry(JournalState &state, Journal::Iterator *iter, PJournalEntry *entry,
 {
   auxbuffer->clear();
 
-  // if iter->offset is 0, then the iterator was created from scratch
-  // and we start reading from the first (oldest) entry.
-  //
-  // The oldest of the two logfiles is always the "other" one (the one
-  // NOT in current_fd).
-  if (iter->offset == 0) {
-    iter->fdstart = iter->fdidx =
-                        state.current_fd == 0
-                            ? 1
-                            : 0;
-  }
-
-  // get the size of the journal file
-  uint64_t filesize = state.files[iter->fdidx].file_size();
-
-  // reached EOF? then either skip to the next file or we're done
-  if (filesize == iter->offset) {
-    if (iter->fdstart == iter->fdidx) {
-      iter->fdidx = iter->fdidx == 1 ? 0 : 1;
-      iter->offset = 0;
-      filesize = state.files[iter->fdidx].file_size();
-    }
-    else {
-      entry->lsn = 0;
-      return;
-    }
+  // if the iterator was created from scratch then collect the segments;
+  // we start reading from the first (oldest) entry
+  if (iter->segments.empty() && iter->offset == 0) {
+    iter->segments = ordered_segments(state);
+    iter->fdidx = 0;
+  }
+
+  // reached the end of the segment? then skip to the next one
+  while (iter->fdidx < iter->segments.size()
+          && iter->offset
+                >= state.segments[iter->segments[iter->fdidx]].position) {
+    iter->fdidx++;
+    iter->offset = 0;
   }
 
-  // second file is also empty? then return
-  if (filesize == iter->offset) {
+  // all segments were read? then we're done
+  if (iter->fdidx == iter->segments.size()) {
     entry->lsn = 0;
     return;
   }
 
+  File &file = state.segments[iter->segments[iter->fdidx]].file;
+
   // now try to read the next entry
   try {
-    state.files[iter->fdidx].pread(iter->offset, entry, sizeof(*entry));
+    file.pread(iter->offset, entry, sizeof(*entry));
 
     iter->offset += sizeof(*entry);
 
@@ -166,7 +374,7 @@ read_entry(JournalState &state, Journal::Iterator *iter, PJournalEntry *entry,
     if (entry->followup_size) {
       auxbuffer->resize((uint32_t)entry->followup_size);
 
-      state.files[iter->fdidx].pread(iter->offset, auxbuffer->data(),
+      file.pread(iter->offset, auxbuffer->data(),
                       (size_t)entry->followup_size);
       iter->offset += entry->followup_size;
     }
@@ -199,26 +407,224 @@ append_entry(JournalState &state, int idx,
     state.buffer.append(ptr5, ptr5_size);
 }
 
-// Switches the log file if necessary; returns the new log descriptor in the
-// transaction
+// Returns true if the current segment has no space for another |size|
+// bytes
+static inline bool
+is_segment_full(JournalState &state, uint64_t size)
+{
+  if (state.segment_size == 0)
+    return state.num_transactions > state.threshold;
+
+  // data which does not even fit into an empty segment is written
+  // nevertheless, and extends the file. The segment also needs space for
+  // the records of a checkpoint, and the terminating empty entry
+  uint64_t position = state.segments[state.current_fd].position
+                        + state.buffer.size();
+  // the dictionary is stored before the first entry which uses it
+  if (state.dictionary_size > 0 && !state.dictionary_stored)
+    size += sizeof(PJournalEntry) + state.dictionary_size;
+  return position > 0
+          && position + size + 3 * sizeof(PJournalEntry) > state.segment_size;
+}
+
+// Deletes the additional segments at the end of the ring, as soon as they
+// are no longer in use
+static inline void
+remove_unused_segments(JournalState &state)
+{
+  while (state.segments.size() > state.num_segments) {
+    uint32_t idx = state.segments.size() - 1;
+    if (idx == state.current_fd || state.segments[idx].open_txns > 0)
+      return;
+
+    {
+      ScopedLock lock(state.sync_mutex);
+      wait_for_sync(state, lock);
+      state.segments.pop_back();
+    }
+
+    std::string path = log_file_path(state, idx);
+    os_unlink(path.c_str());
+  }
+}
+
+// Returns the oldest segment which can be reused, or |segments.size()| if
+// all segments are in use. If |checkpointed| is false then segments are
+// also returned if their changesets are possibly not yet written to the
+// database file.
+static inline uint32_t
+find_free_segment(JournalState &state, bool checkpointed)
+{
+  uint32_t next = state.segments.size();
+  for (uint32_t i = 0; i < state.segments.size(); i++) {
+    JournalState::Segment &segment = state.segments[i];
+    if (i == state.current_fd || segment.open_txns > 0)
+      continue;
+    if (checkpointed && segment.position > 0
+          && segment.sequence >= state.checkpoint_sequence)
+      continue;
+    if (next == state.segments.size()
+          || segment.sequence < state.segments[next].sequence)
+      next = i;
+  }
+  return next;
+}
+
+// Switches the log file if necessary; returns the log descriptor for the
+// next |size| bytes.
+//
+// The journal continues with the oldest segment which is no longer in use.
+// If all segments are in use then a new segment is appended.
 static inline int
-switch_files_maybe(JournalState &state)
+switch_files_maybe(JournalState &state, uint64_t size = 0)
 {
-  int other = state.current_fd ? 0 : 1;
+  checkpoint_maybe(state);
+
+  if (likely(!is_segment_full(state, size)))
+    return state.current_fd;
 
-  // determine the journal file which is used for this transaction 
-  // if the "current" file is not yet full, continue to write to this file
-  //
-  // otherwise delete the other file and use the other file as the current file
-  if (unlikely(state.num_transactions > state.threshold)) {
-    clear_file(state, other);
-    state.current_fd = other;
-    state.num_transactions = 0;
+  uint32_t next = find_free_segment(state, true);
+
+  // a segment is no longer in use, but its checkpoint is not yet
+  // completed; wait for the worker thread instead of adding a segment
+  if (next == state.segments.size()
+        && find_free_segment(state, false) < state.segments.size()) {
+    checkpoint_now(state);
+    next = find_free_segment(state, true);
   }
 
+  if (next == state.segments.size()) {
+    JournalState::Segment segment;
+    create_segment(state, next, &segment);
+
+    ScopedLock lock(state.sync_mutex);
+    wait_for_sync(state, lock);
+    state.segments.push_back(std::move(segment));
+  }
+  else if (state.segments[next].position > 0) {
+    clear_file(state, next);
+  }
+
+  state.current_fd = next;
+  state.segments[next].sequence = ++state.sequence;
+  state.num_transactions = 0;
+  state.dictionary_stored = false;
+  // page deltas must not refer to images in the other file
+  clear_page_images(state);
+
+  remove_unused_segments(state);
+
+  // the older segments can be reused as soon as this checkpoint completed
+  if (!state.checkpoint)
+    begin_checkpoint(state);
   return state.current_fd;
 }
 
+// Marks |txn| as logged to the segment |idx|. The segment is not reused
+// till the Txn was flushed (see Journal::release_segment()).
+static inline void
+pin_segment(JournalState &state, LocalTxn *txn, int idx)
+{
+  std::vector<int> &pinned = txn->log_descriptors;
+  if (std::find(pinned.begin(), pinned.end(), idx) == pinned.end()) {
+    pinned.push_back(idx);
+    state.segments[idx].open_txns++;
+  }
+}
+
+// Returns the log descriptor for the next |size| bytes of |txn|, and pins
+// the segment. A Txn which does not fit into the current segment continues
+// in the next one; the buffered entries are written to the current segment
+// before the journal switches.
+static inline int
+switch_files_for_txn(JournalState &state, LocalTxn *txn, uint64_t size)
+{
+  int idx = state.current_fd;
+  if (txn->log_descriptors.empty() || state.segment_size > 0) {
+    if (state.segment_size > 0 && is_segment_full(state, size))
+      flush_buffer(state, state.current_fd);
+    idx = switch_files_maybe(state, size);
+  }
+  pin_segment(state, txn, idx);
+  return idx;
+}
+
+// Returns the max. number of bytes which are logged for |txn|
+static inline uint64_t
+estimate_txn_size(LocalTxn *txn)
+{
+  uint64_t size = 2 * sizeof(PJournalEntry) + txn->name.size() + 1;
+  for (TxnOperation *op = txn->oldest_op; op != 0; op = op->next_in_txn)
+    size += sizeof(PJournalEntry) + sizeof(PJournalEntryInsert)
+                + op->node->key()->size + op->record.size;
+  return size;
+}
+
+// Returns true if the keys and records of the next entry are compressed
+// with the dictionary. The dictionary is stored in the current segment
+// before its first use.
+static inline bool
+prepare_dictionary(JournalState &state)
+{
+  if (state.dictionary_size == 0
+        || state.dictionary.size() < state.dictionary_size)
+    return false;
+
+  if (!state.dictionary_stored) {
+    // like checkpoint records, the dictionary does not consume an lsn
+    PJournalEntry entry;
+    entry.type = Journal::kEntryTypeDictionary;
+    entry.lsn = state.env->lsn_manager.current;
+    entry.followup_size = state.dictionary.size();
+    append_entry(state, state.current_fd, (uint8_t *)&entry, sizeof(entry),
+                state.dictionary.data(), state.dictionary.size());
+    state.dictionary_stored = true;
+  }
+  return true;
+}
+
+// Compresses a key or record. Returns the length of the compressed data
+// (stored in |state.compressor->arena|), or 0 if the data remains
+// uncompressed because compression does not reduce its size.
+// |use_dictionary| is the result of prepare_dictionary().
+static inline uint32_t
+compress_payload(JournalState &state, const void *data, uint32_t size,
+                bool use_dictionary)
+{
+  uint32_t len;
+  if (use_dictionary)
+    len = state.compressor->compress_with_dictionary((const uint8_t *)data,
+                    size, state.dictionary.data(), state.dictionary.size());
+  else
+    len = state.compressor->compress((const uint8_t *)data, size);
+  if (len >= size)
+    len = 0;
+
+  state.count_bytes_before_compression += size;
+  state.count_bytes_after_compression += len > 0 ? len : size;
+
+  // the first keys and records are collected for the dictionary
+  if (state.dictionary.size() < state.dictionary_size)
+    state.dictionary.append((const uint8_t *)data,
+                    std::min<size_t>(size,
+                        state.dictionary_size - state.dictionary.size()));
+  return len;
+}
+
+// Decompresses a key or record into |arena|. |dictionary| is null if
+// the data was compressed without dictionary.
+static inline void
+decompress_payload(JournalState &state, const uint8_t *data, uint32_t size,
+                uint32_t original_size, const ByteArray *dictionary,
+                ByteArray *arena)
+{
+  if (dictionary)
+    state.compressor->decompress_with_dictionary(data, size, original_size,
+                    dictionary->data(), dictionary->size(), arena);
+  else
+    state.compressor->decompress(data, size, original_size, arena);
+}
+
 // Returns a pointer to database. If the database was not yet opened then
 // it is opened implicitly.
 static inline Db *
@@ -283,18 +689,138 @@ abort_uncommitted_txns(JournalState &state, LocalTxnManager *txn_manager)
   }
 }
 
+// Calculates the modified byte ranges of |data| (compared to |image|) and
+// stores them in |delta| as a sequence of PJournalPageRange structures.
+// Returns false if the delta would exceed |limit| bytes.
+static inline bool
+calculate_page_delta(const uint8_t *image, const uint8_t *data,
+                uint32_t size, uint32_t limit, ByteArray *delta)
+{
+  delta->clear(false);
+
+  uint32_t i = 0;
+  while (i < size) {
+    // skip the unmodified bytes
+    while (i + sizeof(uint64_t) <= size
+            && load64(image + i) == load64(data + i))
+      i += sizeof(uint64_t);
+    while (i < size && image[i] == data[i])
+      i++;
+    if (i == size)
+      break;
+
+    // extend the range till the next gap of unmodified bytes
+    PJournalPageRange range;
+    range.offset = i;
+    uint32_t end = i + 1;
+    for (i = end; i < size && i - end < kDeltaMergeGap; i++) {
+      if (image[i] != data[i])
+        end = i + 1;
+    }
+    range.size = end - range.offset;
+
+    if (delta->size() + sizeof(range) + range.size > limit)
+      return false;
+    delta->append((uint8_t *)&range, sizeof(range));
+    delta->append(data + range.offset, range.size);
+  }
+
+  // the page was not modified; store an empty range, because an empty
+  // delta would describe a full page
+  if (delta->size() == 0) {
+    PJournalPageRange range = {0, 0};
+    delta->append((uint8_t *)&range, sizeof(range));
+  }
+  return true;
+}
+
+static inline void
+throw_corrupt_delta()
+{
+  ups_log(("journal is corrupt: invalid page delta"));
+  throw Exception(UPS_IO_ERROR);
+}
+
+// Applies a delta (see calculate_page_delta) to |data|
+static inline void
+apply_page_delta(const uint8_t *delta, uint32_t delta_size, uint8_t *data,
+                uint32_t size)
+{
+  const uint8_t *end = delta + delta_size;
+  while (delta < end) {
+    PJournalPageRange range;
+    if ((size_t)(end - delta) < sizeof(range))
+      throw_corrupt_delta();
+    ::memcpy(&range, delta, sizeof(range));
+    delta += sizeof(range);
+    if (range.size > (size_t)(end - delta)
+        || range.offset > size || range.size > size - range.offset)
+      throw_corrupt_delta();
+    ::memcpy(data + range.offset, delta, range.size);
+    delta += range.size;
+  }
+}
+
+// Stores |data| as the most recent image of the page at |address|. The
+// least recently logged images are discarded if the limit is exceeded.
+static inline void
+store_page_image(JournalState &state, uint64_t address, const uint8_t *data,
+                uint32_t page_size)
+{
+  JournalState::PageImageMap::iterator it = state.page_images.find(address);
+
+  if (it == state.page_images.end()) {
+    size_t limit = std::max<size_t>(kPageImageLimit / page_size, 1);
+    while (state.page_images.size() >= limit) {
+      state.page_images.erase(state.page_images_lru.back());
+      state.page_images_lru.pop_back();
+    }
+
+    it = state.page_images.insert(std::make_pair(address,
+                            JournalState::PageImage())).first;
+    state.page_images_lru.push_front(address);
+    it->second.lru = state.page_images_lru.begin();
+  }
+  else {
+    state.page_images_lru.splice(state.page_images_lru.begin(),
+                    state.page_images_lru, it->second.lru);
+  }
+
+  it->second.data.assign(data, data + page_size);
+}
+
 // Helper function which adds a single page from the changeset to
-// the Journal; returns the page size (or compressed size, if compression
-// was enabled)
+// the Journal. If the page was already logged to the current file then
+// only the modified bytes are stored. Returns the number of bytes which
+// were appended.
 static inline uint32_t
 append_changeset_page(JournalState &state, Page *page, uint32_t page_size)
 {
-  PJournalEntryPageHeader header(page->address());
+  PJournalEntryPageDelta header(page->address());
+  const uint8_t *data = (const uint8_t *)page->data();
+  const uint8_t *payload = data;
+  uint32_t payload_size = page_size;
+
+  // only store the delta if it is significantly smaller than the page
+  JournalState::PageImageMap::iterator it
+          = state.page_images.find(page->address());
+  if (it != state.page_images.end()
+        && calculate_page_delta(it->second.data.data(), data, page_size,
+                    page_size / 2, &state.delta)) {
+    header.delta_size = state.delta.size();
+    payload = state.delta.data();
+    payload_size = header.delta_size;
+    state.count_page_deltas++;
+  }
+  else {
+    state.count_page_images++;
+  }
+
+  store_page_image(state, page->address(), data, page_size);
 
   if (state.compressor.get()) {
-    state.count_bytes_before_compression += page_size;
-    header.compressed_size = state.compressor->compress((uint8_t *)page->data(),
-                    page_size);
+    state.count_bytes_before_compression += payload_size;
+    header.compressed_size = state.compressor->compress(payload, payload_size);
     append_entry(state, state.current_fd, (uint8_t *)&header, sizeof(header),
                     state.compressor->arena.data(),
                     header.compressed_size);
@@ -303,144 +829,297 @@ append_changeset_page(JournalState &state, Page *page, uint32_t page_size)
   }
 
   append_entry(state, state.current_fd, (uint8_t *)&header, sizeof(header),
-                (uint8_t *)page->data(), page_size);
-  return page_size + sizeof(header);
+                payload, payload_size);
+  return payload_size + sizeof(header);
 }
 
-// Scans a file for the oldest changeset. Returns the lsn of this
-// changeset.
-static inline uint64_t
-scan_for_oldest_changeset(JournalState &state, File *file)
+// A page of a changeset which is restored during recovery
+struct RecoveryPage {
+  // the index of the journal segment
+  int fdidx;
+
+  // the offset of the page data in the journal file
+  uint64_t offset;
+
+  // the header of the page
+  PJournalEntryPageDelta header;
+};
+
+// The changeset entries of a single page, in chronological order. The
+// first entry is always a full image of the page; older entries are
+// irrelevant for recovery and are discarded.
+typedef std::vector<RecoveryPage> RecoveryChain;
+
+// The changeset entries of all pages, sorted by address
+typedef std::map<uint64_t, RecoveryChain> RecoveryChainMap;
+
+// Reads all Changesets of a segment, starting at |offset|, in chronological
+// order, and adds their pages to |chains|. |file_size| is updated with the
+// size of the database file after recovery.
+static inline void
+collect_changesets(JournalState &state, int fdidx, uint64_t offset,
+                RecoveryChainMap *chains, uint64_t *file_size)
 {
   Journal::Iterator it;
   PJournalEntry entry;
-  ByteArray buffer;
-
-  // get the next entry
-  try {
-    uint64_t filesize = file->file_size();
-
-    while (it.offset < filesize) {
-      file->pread(it.offset, &entry, sizeof(entry));
+  uint32_t page_size = state.env->config.page_size_bytes;
+  File &file = state.segments[fdidx].file;
 
-      if (entry.lsn == 0)
-        break;
+  // for each entry...
+  uint64_t log_file_size = state.segments[fdidx].position;
+  it.offset = offset;
 
-      if (entry.type == Journal::kEntryTypeChangeset) {
-        return entry.lsn;
-      }
+  while (it.offset < log_file_size) {
+    file.pread(it.offset, &entry, sizeof(entry));
 
-      // increment the offset
+    // Skip all log entries which are NOT from a changeset
+    if (entry.type != Journal::kEntryTypeChangeset) {
       it.offset += sizeof(entry) + entry.followup_size;
+      continue;
     }
-  }
-  catch (Exception &ex) {
-    ups_log(("exception (error %d) while reading journal", ex.code));
-  }
 
-  return 0;
-}
+    it.offset += sizeof(entry);
 
-// Redo all Changesets of a log file, in chronological order
-// Returns the highest lsn of the last changeset applied
-static inline uint64_t
-redo_all_changesets(JournalState &state, int fdidx)
-{
-  Journal::Iterator it;
-  PJournalEntry entry;
-  ByteArray buffer;
-  uint64_t max_lsn = 0;
+    // Read the Changeset header
+    PJournalEntryChangeset changeset;
+    file.pread(it.offset, &changeset, sizeof(changeset));
+    it.offset += sizeof(changeset);
 
-  // for each entry...
-  try {
-    uint64_t log_file_size = state.files[fdidx].file_size();
+    bool page_deltas = ISSET(entry.flags, PJournalEntry::kFlagPageDeltas);
 
-    while (it.offset < log_file_size) {
-      state.files[fdidx].pread(it.offset, &entry, sizeof(entry));
+    // for each page in this changeset...
+    for (uint32_t i = 0; i < changeset.num_pages; i++) {
+      RecoveryPage page;
+      page.fdidx = fdidx;
+      if (page_deltas) {
+        file.pread(it.offset, &page.header, sizeof(page.header));
+        it.offset += sizeof(page.header);
+      }
+      else {
+        PJournalEntryPageHeader old_header;
+        file.pread(it.offset, &old_header, sizeof(old_header));
+        it.offset += sizeof(old_header);
+        page.header.address = old_header.address;
+        page.header.compressed_size = old_header.compressed_size;
+      }
 
-      // Skip all log entries which are NOT from a changeset
-      if (entry.type != Journal::kEntryTypeChangeset) {
-        it.offset += sizeof(entry) + entry.followup_size;
-        continue;
+      // skip the page data; it is read when the page is restored
+      page.offset = it.offset;
+      if (page.header.compressed_size > 0)
+        it.offset += page.header.compressed_size;
+      else if (page.header.delta_size > 0)
+        it.offset += page.header.delta_size;
+      else
+        it.offset += page_size;
+      if (it.offset > log_file_size) {
+        ups_log(("journal is corrupt: truncated changeset"));
+        throw Exception(UPS_IO_ERROR);
       }
 
-      max_lsn = entry.lsn;
+      // a full image replaces all older entries of this page; a delta is
+      // applied to the previous image
+      RecoveryChain &chain = (*chains)[page.header.address];
+      if (page.header.delta_size == 0)
+        chain.clear();
+      else if (chain.empty()) {
+        ups_log(("journal is corrupt: delta of page %lu without image",
+                (unsigned long)page.header.address));
+        throw Exception(UPS_IO_ERROR);
+      }
+      chain.push_back(page);
 
-      it.offset += sizeof(entry);
+      if (page.header.address + page_size > *file_size)
+        *file_size = page.header.address + page_size;
+    }
+  }
+}
 
-      // Read the Changeset header
-      PJournalEntryChangeset changeset;
-      state.files[fdidx].pread(it.offset, &changeset, sizeof(changeset));
-      it.offset += sizeof(changeset);
+// Restores a single page from its changeset entries and writes it to disk
+static inline void
+redo_page(JournalState &state, Compressor *compressor, uint64_t address,
+                RecoveryChain &chain, ByteArray *arena, ByteArray *tmp)
+{
+  uint32_t page_size = state.env->config.page_size_bytes;
 
-      uint32_t page_size = state.env->config.page_size_bytes;
-      ByteArray arena(page_size);
-      ByteArray tmp;
+  Page *page;
+  ScopedPtr<Page> page_deleter;
+  if (address == 0)
+    page = state.env->header->header_page;
+  else
+    page_deleter.reset(page = new Page(state.env->device.get()));
+  page->fetch(address);
+
+  for (RecoveryChain::iterator it = chain.begin(); it != chain.end(); ++it) {
+    File &file = state.segments[it->fdidx].file;
+    uint32_t size = it->header.delta_size > 0
+                        ? it->header.delta_size
+                        : page_size;
+
+    // an uncompressed image is read directly into the page
+    if (it->header.compressed_size == 0 && it->header.delta_size == 0) {
+      file.pread(it->offset, page->data(), page_size);
+      continue;
+    }
 
-      uint64_t file_size = state.env->device->file_size();
+    if (it->header.compressed_size > 0) {
+      tmp->resize(it->header.compressed_size);
+      file.pread(it->offset, tmp->data(), it->header.compressed_size);
+      compressor->decompress(tmp->data(), it->header.compressed_size,
+                      size, arena);
+    }
+    else {
+      arena->resize(size);
+      file.pread(it->offset, arena->data(), size);
+    }
 
-      state.env->page_manager->set_last_blob_page_id(changeset.last_blob_page);
+    if (it->header.delta_size > 0)
+      apply_page_delta(arena->data(), size, (uint8_t *)page->data(),
+                      page_size);
+    else
+      ::memcpy(page->data(), arena->data(), page_size);
+  }
 
-      // for each page in this changeset...
-      for (uint32_t i = 0; i < changeset.num_pages; i++) {
-        PJournalEntryPageHeader page_header;
-        state.files[fdidx].pread(it.offset, &page_header,
-                        sizeof(page_header));
-        it.offset += sizeof(page_header);
-        if (page_header.compressed_size > 0) {
-          tmp.resize(page_size);
-          state.files[fdidx].pread(it.offset, tmp.data(),
-                        page_header.compressed_size);
-          it.offset += page_header.compressed_size;
-          state.compressor->decompress(tmp.data(),
-                        page_header.compressed_size, page_size, &arena);
-        }
-        else {
-          state.files[fdidx].pread(it.offset, arena.data(), page_size);
-          it.offset += page_size;
-        }
+  // flush the modified page to disk
+  page->set_dirty(true);
+  page->flush();
+}
 
-        Page *page;
+// A range of pages which is restored by a single thread
+struct RecoveryPartition {
+  JournalState *state;
+  RecoveryChainMap::iterator begin;
+  RecoveryChainMap::iterator end;
+  ups_status_t st;
+  CountingSignal *signal;
+};
 
-        // now write the page to disk
-        if (page_header.address == file_size) {
-          file_size += page_size;
+static void
+redo_partition(RecoveryPartition *partition)
+{
+  JournalState &state = *partition->state;
 
-          page = new Page(state.env->device.get());
-          page->alloc(0);
-        }
-        else if (page_header.address > file_size) {
-          file_size = (size_t)page_header.address + page_size;
-          state.env->device->truncate(file_size);
+  try {
+    // the compressor is not thread-safe; each thread uses its own
+    ScopedPtr<Compressor> compressor;
+    if (state.compressor.get())
+      compressor.reset(CompressorFactory::create(
+                              state.env->config.journal_compressor));
+
+    ByteArray arena;
+    ByteArray tmp;
+    for (RecoveryChainMap::iterator it = partition->begin;
+                    it != partition->end; ++it)
+      redo_page(state, compressor.get(), it->first, it->second, &arena, &tmp);
+  }
+  catch (Exception &ex) {
+    partition->st = ex.code;
+  }
 
-          page = new Page(state.env->device.get());
-          page->fetch(page_header.address);
-        }
-        else {
-          if (page_header.address == 0)
-            page = state.env->header->header_page;
-          else
-            page = new Page(state.env->device.get());
-          page->fetch(page_header.address);
-        }
-        assert(page->address() == page_header.address);
+  if (partition->signal)
+    partition->signal->notify();
+}
 
-        // overwrite the page data
-        ::memcpy(page->data(), arena.data(), page_size);
+// Restores the pages of all changesets. Pages are independent of each
+// other; they are split in ranges which are restored in parallel. Each
+// page is written only once.
+static inline void
+redo_all_changesets(JournalState &state, RecoveryChainMap &chains,
+                uint64_t file_size)
+{
+  if (chains.empty())
+    return;
 
-        // flush the modified page to disk
-        page->set_dirty(true);
-        page->flush();
+  // grow the file if the changesets contain pages beyond its end
+  if (file_size > state.env->device->file_size())
+    state.env->device->truncate(file_size);
+
+  size_t threads = state.env->config.recovery_threads;
+  if (threads == 0)
+    threads = boost::thread::hardware_concurrency();
+  threads = std::min(threads, chains.size() / kRecoveryPagesPerThread);
+  threads = std::max<size_t>(threads, 1);
+
+  std::vector<RecoveryPartition> partitions(threads);
+  RecoveryChainMap::iterator it = chains.begin();
+  for (size_t i = 0; i < threads; i++) {
+    RecoveryPartition &p = partitions[i];
+    p.state = &state;
+    p.begin = it;
+    std::advance(it, (i + 1) * chains.size() / threads
+                        - i * chains.size() / threads);
+    p.end = it;
+    p.st = 0;
+    p.signal = 0;
+  }
 
-        if (page_header.address != 0)
-          delete page;
-      }
+  if (threads == 1) {
+    redo_partition(&partitions[0]);
+  }
+  else {
+    CountingSignal signal(threads);
+    WorkerPool pool(threads);
+    for (size_t i = 0; i < threads; i++) {
+      partitions[i].signal = &signal;
+      pool.post(boost::bind(&redo_partition, &partitions[i]));
     }
+    signal.wait();
   }
-  catch (Exception &) {
-    ups_trace(("Exception when applying changeset"));
-    // propagate error
-    throw;
+
+  for (size_t i = 0; i < threads; i++) {
+    if (partitions[i].st) {
+      ups_trace(("Exception when applying changeset"));
+      throw Exception(partitions[i].st);
+    }
+  }
+}
+
+// Reads the headers of all entries in |segments|, and finds the "begin"
+// record of the newest completed checkpoint. |first| and |offset| are set
+// to its position; they remain unchanged if there is no completed
+// checkpoint. Also restores the last blob page of the PageManager.
+// Returns the highest lsn of all changesets
+static inline uint64_t
+find_checkpoint(JournalState &state, const std::vector<uint32_t> &segments,
+                size_t *first, uint64_t *offset)
+{
+  PJournalEntry entry;
+  uint64_t max_lsn = 0;
+  size_t begin_segment = 0;
+  uint64_t begin_offset = 0;
+  bool begin_found = false;
+
+  for (size_t i = 0; i < segments.size(); i++) {
+    JournalState::Segment &segment = state.segments[segments[i]];
+
+    for (uint64_t pos = 0; pos < segment.position;
+                    pos += sizeof(entry) + entry.followup_size) {
+      segment.file.pread(pos, &entry, sizeof(entry));
+
+      switch (entry.type) {
+        case Journal::kEntryTypeChangeset: {
+          PJournalEntryChangeset changeset;
+          segment.file.pread(pos + sizeof(entry), &changeset,
+                          sizeof(changeset));
+          state.env->page_manager->set_last_blob_page_id(
+                          changeset.last_blob_page);
+          max_lsn = std::max(max_lsn, entry.lsn);
+          break;
+        }
+        case Journal::kEntryTypeCheckpointBegin:
+          begin_segment = i;
+          begin_offset = pos;
+          begin_found = true;
+          break;
+        case Journal::kEntryTypeCheckpointEnd:
+          // only one checkpoint is running at a time; the end record
+          // belongs to the previous begin record
+          if (begin_found) {
+            *first = begin_segment;
+            *offset = begin_offset;
+          }
+          break;
+      }
+    }
   }
 
   return max_lsn;
@@ -451,22 +1130,24 @@ redo_all_changesets(JournalState &state, int fdidx)
 static inline uint64_t
 recover_changeset(JournalState &state)
 {
-  // scan through both files, look for the file with the oldest changeset.
-  uint64_t lsn1 = scan_for_oldest_changeset(state, &state.files[0]);
-  uint64_t lsn2 = scan_for_oldest_changeset(state, &state.files[1]);
-
-  // both files are empty or do not contain a changeset?
-  if (lsn1 == 0 && lsn2 == 0)
-    return 0;
-
-  // now redo all changesets chronologically
-  state.current_fd = lsn1 < lsn2 ? 0 : 1;
-
-  uint64_t max_lsn1 = redo_all_changesets(state, state.current_fd);
-  uint64_t max_lsn2 = redo_all_changesets(state, state.current_fd == 0 ? 1 : 0);
+  // collect all changesets chronologically, from the newest checkpoint
+  // to the newest segment
+  std::vector<uint32_t> segments = ordered_segments(state);
+  size_t first = 0;
+  uint64_t offset = 0;
+  uint64_t max_lsn = find_checkpoint(state, segments, &first, &offset);
+
+  RecoveryChainMap chains;
+  uint64_t file_size = state.env->device->file_size();
+  for (size_t i = first; i < segments.size(); i++)
+    collect_changesets(state, segments[i], i == first ? offset : 0,
+                    &chains, &file_size);
+
+  // then restore the pages
+  redo_all_changesets(state, chains, file_size);
 
   // return the lsn of the newest changeset
-  return std::max(max_lsn1, max_lsn2);
+  return max_lsn;
 }
 
 // Recovers the logical journal
@@ -477,6 +1158,8 @@ recover_journal(JournalState &state, Context *context,
   ups_status_t st = 0;
   Journal::Iterator it;
   ByteArray buffer;
+  ByteArray dictionary;
+  size_t dictionary_segment = 0;
 
   /* recovering the journal is rather simple - we iterate over the
    * files and re-apply EVERY operation (incl. txn_begin and txn_abort),
@@ -507,6 +1190,25 @@ recover_journal(JournalState &state, Context *context,
     if (!entry.lsn)
       break;
 
+    // each segment stores its own dictionary
+    if (it.fdidx != dictionary_segment) {
+      dictionary.clear();
+      dictionary_segment = it.fdidx;
+    }
+
+    // compressed keys and records might require the dictionary
+    const ByteArray *dict = 0;
+    if (ISSET(entry.flags, PJournalEntry::kFlagDictionary)
+          && (entry.type == Journal::kEntryTypeInsert
+            || entry.type == Journal::kEntryTypeErase)) {
+      if (dictionary.is_empty()) {
+        ups_log(("journal is corrupt: dictionary is missing"));
+        st = UPS_IO_ERROR;
+        goto bail;
+      }
+      dict = &dictionary;
+    }
+
     // re-apply this operation
     switch (entry.type) {
       case Journal::kEntryTypeTxnBegin: {
@@ -550,9 +1252,8 @@ recover_journal(JournalState &state, Context *context,
         // extract the key - it can be compressed or uncompressed
         ByteArray keyarena;
         if (ins->compressed_key_size != 0) {
-          state.compressor->decompress(payload, ins->compressed_key_size,
-                          ins->key_size);
-          keyarena.append(state.compressor->arena.data(), ins->key_size);
+          decompress_payload(state, payload, ins->compressed_key_size,
+                          ins->key_size, dict, &keyarena);
           key.data = keyarena.data();
           payload += ins->compressed_key_size;
         }
@@ -564,9 +1265,8 @@ recover_journal(JournalState &state, Context *context,
         // extract the record - it can be compressed or uncompressed
         ByteArray recarena;
         if (ins->compressed_record_size != 0) {
-          state.compressor->decompress(payload, ins->compressed_record_size,
-                          ins->record_size);
-          recarena.append(state.compressor->arena.data(), ins->record_size);
+          decompress_payload(state, payload, ins->compressed_record_size,
+                          ins->record_size, dict, &recarena);
           record.data = recarena.data();
           payload += ins->compressed_record_size;
         }
@@ -609,11 +1309,11 @@ recover_journal(JournalState &state, Context *context,
         if (entry.txn_id)
           txn = get_txn(state, txn_manager, entry.txn_id);
         db = get_db(state, entry.dbname);
-        key.data = e->key_data();
+        ByteArray keyarena;
         if (e->compressed_key_size != 0) {
-          state.compressor->decompress(e->key_data(), e->compressed_key_size,
-                          e->key_size);
-          key.data = state.compressor->arena.data();
+          decompress_payload(state, e->key_data(), e->compressed_key_size,
+                          e->key_size, dict, &keyarena);
+          key.data = keyarena.data();
         }
         else
           key.data = e->key_data();
@@ -626,8 +1326,14 @@ recover_journal(JournalState &state, Context *context,
           st = 0;
         break;
       }
-      case Journal::kEntryTypeChangeset: {
-        // skip this; the changeset was already applied
+      case Journal::kEntryTypeChangeset:
+      case Journal::kEntryTypeCheckpointBegin:
+      case Journal::kEntryTypeCheckpointEnd: {
+        // skip these; the changesets were already applied
+        break;
+      }
+      case Journal::kEntryTypeDictionary: {
+        dictionary.copy(buffer.data(), buffer.size());
         break;
       }
       default:
@@ -659,13 +1365,25 @@ bail:
 
 
 JournalState::JournalState(LocalEnv *env_)
-  : env(env_), current_fd(0), num_transactions(0),
-    threshold(env_->config.journal_switch_threshold),
+  : env(env_), current_fd(0),
+    num_segments(env_->config.journal_segments),
+    segment_size(env_->config.journal_segment_size), sequence(0),
+    checkpoint_size(env_->config.journal_checkpoint_size),
+    bytes_since_checkpoint(0), checkpoint_sequence(0), checkpoint_lsn(0),
+    count_checkpoints(0), num_transactions(0), threshold(env_->config.journal_switch_threshold),
     disable_logging(false), count_bytes_flushed(0),
-    count_bytes_before_compression(0), count_bytes_after_compression(0)
+    count_bytes_before_compression(0), count_bytes_after_compression(0),
+    count_commits(0), count_fsyncs(0), count_page_images(0),
+    count_page_deltas(0), written_lsn(0), durable_lsn(0),
+    sync_in_progress(false), pending_commits(0),
+    group_commit_delay(env_->config.journal_group_commit_delay),
+    group_commit_size(env_->config.journal_group_commit_size),
+    dictionary_size(0), dictionary_stored(false)
 {
   if (threshold == 0)
     threshold = kSwitchTxnThreshold;
+  if (num_segments < kMinSegments)
+    num_segments = kMinSegments;
 }
 
 Journal::Journal(LocalEnv *env)
@@ -674,33 +1392,101 @@ Journal::Journal(LocalEnv *env)
   int algo = env->config.journal_compressor;
   if (algo)
     state.compressor.reset(CompressorFactory::create(algo));
+  if (state.compressor.get() && state.compressor->supports_dictionary())
+    state.dictionary_size = env->config.journal_dictionary_size;
 }
 
 void
 Journal::create()
 {
-  // create the two files
-  for (int i = 0; i < 2; i++) {
+  state.segments.clear();
+
+  // create the segments
+  state.segments.resize(state.num_segments);
+  try {
+    for (uint32_t i = 0; i < state.num_segments; i++)
+      create_segment(state, i, &state.segments[i]);
+  }
+  catch (Exception &) {
+    state.segments.clear();
+    throw;
+  }
+
+  // delete the additional segments of a previous journal
+  for (uint32_t i = state.num_segments; ; i++) {
     std::string path = log_file_path(state, i);
-    state.files[i].create(path.c_str(), 0644);
+    if (!os_unlink(path.c_str()))
+      break;
   }
+
+  state.current_fd = 0;
+  state.segments[0].sequence = state.sequence = 1;
+  state.checkpoint.reset();
+  state.checkpoint_sequence = 0;
+  state.dictionary_stored = false;
 }
 
 void
 Journal::open()
 {
-  // open the two files
+  state.segments.clear();
+
+  // open the segments; the first two segments must exist. Missing
+  // segments are created if the journal was configured with fewer
+  // segments, and additional segments are opened if they exist.
   try {
-    std::string path = log_file_path(state, 0);
-    state.files[0].open(path.c_str(), false);
-    path = log_file_path(state, 1);
-    state.files[1].open(path.c_str(), 0);
+    for (uint32_t i = 0; ; i++) {
+      std::string path = log_file_path(state, i);
+      JournalState::Segment segment;
+      try {
+        segment.file.open(path.c_str(), false);
+      }
+      catch (Exception &ex) {
+        if (ex.code != UPS_FILE_NOT_FOUND || i < kMinSegments)
+          throw;
+        if (i >= state.num_segments)
+          break;
+        create_segment(state, i, &segment);
+      }
+      state.segments.push_back(std::move(segment));
+    }
   }
-  catch (Exception &ex) {
-    state.files[1].close();
-    state.files[0].close();
-    throw ex;
+  catch (Exception &) {
+    state.segments.clear();
+    throw;
+  }
+
+  // find the end of each segment, and restore the order of the segments
+  std::vector<std::pair<uint64_t, uint32_t> > lsns;
+  for (uint32_t i = 0; i < state.segments.size(); i++) {
+    JournalState::Segment &segment = state.segments[i];
+    uint64_t max_lsn = scan_segment(segment);
+    if (segment.position > 0)
+      lsns.push_back(std::make_pair(max_lsn, i));
+    // empty segments are truncated (or preallocated); all new data is
+    // appended at |position|
+    else if (state.segment_size > 0)
+      segment.file.allocate(state.segment_size);
+    else if (segment.file.file_size() > 0)
+      segment.file.truncate(0);
+  }
+  std::sort(lsns.begin(), lsns.end());
+
+  state.sequence = 0;
+  for (size_t i = 0; i < lsns.size(); i++)
+    state.segments[lsns[i].second].sequence = ++state.sequence;
+
+  // continue with the newest segment
+  if (lsns.empty()) {
+    state.current_fd = 0;
+    state.segments[0].sequence = ++state.sequence;
   }
+  else
+    state.current_fd = lsns.back().second;
+
+  state.checkpoint.reset();
+  state.checkpoint_sequence = 0;
+  state.dictionary_stored = false;
 }
 
 void
@@ -718,7 +1504,10 @@ Journal::append_txn_begin(LocalTxn *txn, const char *name, uint64_t lsn)
   if (name)
     entry.followup_size = ::strlen(name) + 1;
 
-  int cur = txn->log_descriptor = switch_files_maybe(state);
+  // the whole Txn is preferably logged to a single segment; if it does not
+  // fit then it is split, and each of its segments is pinned
+  uint64_t size = state.segment_size > 0 ? estimate_txn_size(txn) : 0;
+  int cur = switch_files_for_txn(state, txn, size);
 
   if (unlikely(txn->name.size()))
     append_entry(state, cur, (uint8_t *)&entry, (uint32_t)sizeof(entry),
@@ -742,11 +1531,13 @@ Journal::append_txn_commit(LocalTxn *txn, uint64_t lsn)
   entry.txn_id = txn->id;
   entry.type = Journal::kEntryTypeTxnCommit;
 
-  append_entry(state, txn->log_descriptor, (uint8_t *)&entry, sizeof(entry));
+  int idx = switch_files_for_txn(state, txn, sizeof(entry));
+  append_entry(state, idx, (uint8_t *)&entry, sizeof(entry));
 
-  // flush after commit
-  flush_buffer(state, state.current_fd,
-                  ISSET(state.env->flags(), UPS_ENABLE_FSYNC));
+  // flush after commit; the fsync is performed by the caller after the
+  // Environment lock was released (see Journal::sync())
+  flush_buffer(state, state.current_fd, lsn);
+  state.count_commits++;
 }
 
 void
@@ -771,12 +1562,15 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   int idx;
   if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
     entry.txn_id = 0;
-    idx = switch_files_maybe(state);
+    idx = switch_files_maybe(state, sizeof(PJournalEntry)
+                    + sizeof(PJournalEntryInsert) + key->size + record->size);
+    pin_segment(state, txn, idx);
     state.num_transactions++;
   }
   else {
     entry.txn_id = txn->id;
-    idx = txn->log_descriptor;
+    idx = switch_files_for_txn(state, txn, sizeof(PJournalEntry)
+                    + sizeof(PJournalEntryInsert) + key->size + record->size);
   }
 
   PJournalEntryInsert insert;
@@ -784,6 +1578,11 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   insert.record_size = record->size;
   insert.insert_flags = flags;
 
+  // the dictionary (if any) is appended before the entry
+  bool use_dictionary = state.compressor.get() && prepare_dictionary(state);
+  if (use_dictionary)
+    entry.flags |= PJournalEntry::kFlagDictionary;
+
   // we need the current position in the file buffer. if compression is enabled
   // then we do not know the actual followup-size of this entry. it will be
   // patched in later.
@@ -798,14 +1597,13 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   const void *key_data = key->data;
   uint32_t key_size = key->size;
   if (state.compressor.get()) {
-    state.count_bytes_before_compression += key_size;
-    uint32_t len = state.compressor->compress((uint8_t *)key->data, key->size);
-    if (len < key->size) {
+    uint32_t len = compress_payload(state, key->data, key->size,
+                    use_dictionary);
+    if (len > 0) {
       key_size = len;
       key_data = state.compressor->arena.data();
       insert.compressed_key_size = len;
     }
-    state.count_bytes_after_compression += key_size;
   }
   append_entry(state, idx, (uint8_t *)key_data, key_size);
   entry.followup_size += key_size;
@@ -814,15 +1612,13 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   const void *record_data = record->data;
   uint32_t record_size = record->size;
   if (state.compressor.get()) {
-    state.count_bytes_before_compression += record_size;
-    uint32_t len = state.compressor->compress((uint8_t *)record->data,
-                    record_size);
-    if (len < record_size) {
+    uint32_t len = compress_payload(state, record->data, record->size,
+                    use_dictionary);
+    if (len > 0) {
       record_size = len;
       record_data = state.compressor->arena.data();
       insert.compressed_record_size = len;
     }
-    state.count_bytes_after_compression += record_size;
   }
   append_entry(state, idx, (uint8_t *)record_data, record_size);
   entry.followup_size += record_size;
@@ -833,9 +1629,12 @@ Journal::append_insert(Db *db, LocalTxn *txn,
   state.buffer.overwrite(entry_position + sizeof(entry),
                   (uint8_t *)&insert, sizeof(PJournalEntryInsert) - 1);
 
-  if (ISSET(txn->flags, UPS_TXN_TEMPORARY))
-    flush_buffer(state, state.current_fd,
-                    ISSET(state.env->flags(), UPS_ENABLE_FSYNC));
+  if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
+    flush_buffer(state, state.current_fd, lsn);
+    state.count_commits++;
+    if (ISSET(state.env->flags(), UPS_ENABLE_FSYNC))
+      sync(lsn, false);
+  }
 }
 
 void
@@ -850,17 +1649,34 @@ Journal::append_erase(Db *db, LocalTxn *txn, ups_key_t *key,
   const void *payload_data = key->data;
   uint32_t payload_size = key->size;
 
+  int idx;
+  if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
+    entry.txn_id = 0;
+    idx = switch_files_maybe(state, sizeof(PJournalEntry)
+                    + sizeof(PJournalEntryErase) + key->size);
+    pin_segment(state, txn, idx);
+    state.num_transactions++;
+  }
+  else {
+    entry.txn_id = txn->id;
+    idx = switch_files_for_txn(state, txn, sizeof(PJournalEntry)
+                    + sizeof(PJournalEntryErase) + key->size);
+  }
+
   // try to compress the payload; if the compressed result is smaller than
-  // the original (uncompressed) payload then use it
+  // the original (uncompressed) payload then use it. The dictionary (if
+  // any) is appended before the entry
   if (state.compressor.get()) {
-    state.count_bytes_before_compression += payload_size;
-    uint32_t len = state.compressor->compress((uint8_t *)key->data, key->size);
-    if (len < key->size) {
+    bool use_dictionary = prepare_dictionary(state);
+    if (use_dictionary)
+      entry.flags |= PJournalEntry::kFlagDictionary;
+    uint32_t len = compress_payload(state, key->data, key->size,
+                    use_dictionary);
+    if (len > 0) {
       payload_data = state.compressor->arena.data();
       payload_size = len;
       erase.compressed_key_size = len;
     }
-    state.count_bytes_after_compression += payload_size;
   }
 
   entry.lsn = lsn;
@@ -871,25 +1687,17 @@ Journal::append_erase(Db *db, LocalTxn *txn, ups_key_t *key,
   erase.erase_flags = flags;
   erase.duplicate = duplicate_index;
 
-  int idx;
-  if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
-    entry.txn_id = 0;
-    idx = switch_files_maybe(state);
-    state.num_transactions++;
-  }
-  else {
-    entry.txn_id = txn->id;
-    idx = txn->log_descriptor;
-  }
-
   // append the entry to the logfile
   append_entry(state, idx, (uint8_t *)&entry, sizeof(entry),
                 (uint8_t *)&erase, sizeof(PJournalEntryErase) - 1,
                 (uint8_t *)payload_data, payload_size);
 
-  if (ISSET(txn->flags, UPS_TXN_TEMPORARY))
-    flush_buffer(state, state.current_fd,
-                    ISSET(state.env->flags(), UPS_ENABLE_FSYNC));
+  if (ISSET(txn->flags, UPS_TXN_TEMPORARY)) {
+    flush_buffer(state, state.current_fd, lsn);
+    state.count_commits++;
+    if (ISSET(state.env->flags(), UPS_ENABLE_FSYNC))
+      sync(lsn, false);
+  }
 }
 
 int
@@ -908,11 +1716,22 @@ Journal::append_changeset(std::vector<Page *> &pages,
   entry.dbname = 0;
   entry.txn_id = 0;
   entry.type = Journal::kEntryTypeChangeset;
+  entry.flags = PJournalEntry::kFlagPageDeltas;
   // followup_size is incomplete - the actual page sizes are added later
   entry.followup_size = sizeof(PJournalEntryChangeset);
   changeset.num_pages = pages.size();
   changeset.last_blob_page = last_blob_page;
 
+  size_t page_size = state.env->config.page_size_bytes;
+
+  // preallocated segments are switched if the changeset does not fit;
+  // it does not belong to a Txn, therefore the segment is not pinned
+  if (state.segment_size > 0)
+    switch_files_maybe(state, sizeof(entry) + sizeof(changeset)
+                + pages.size() * (sizeof(PJournalEntryPageDelta) + page_size));
+  else
+    checkpoint_maybe(state);
+
   // we need the current position in the file buffer. if compression is enabled
   // then we do not know the actual followup-size of this entry. it will be
   // patched in later.
@@ -922,7 +1741,6 @@ Journal::append_changeset(std::vector<Page *> &pages,
   append_entry(state, state.current_fd, (uint8_t *)&entry, sizeof(entry),
                 (uint8_t *)&changeset, sizeof(PJournalEntryChangeset));
 
-  size_t page_size = state.env->config.page_size_bytes;
   for (std::vector<Page *>::iterator it = pages.begin();
                   it != pages.end();
                   ++it) {
@@ -937,30 +1755,123 @@ Journal::append_changeset(std::vector<Page *> &pages,
   UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
 
   // and flush the file
-  flush_buffer(state, state.current_fd,
-                  ISSET(state.env->flags(), UPS_ENABLE_FSYNC));
+  flush_buffer(state, state.current_fd, lsn);
+  if (ISSET(state.env->flags(), UPS_ENABLE_FSYNC))
+    sync(lsn, false);
 
   UPS_INDUCE_ERROR(ErrorInducer::kChangesetFlush);
 
   return state.current_fd;
 }
 
+uint64_t
+Journal::unsynced_lsn()
+{
+  if (NOTSET(state.env->flags(), UPS_ENABLE_FSYNC))
+    return 0;
+
+  ScopedLock lock(state.sync_mutex);
+  return state.written_lsn > state.durable_lsn ? state.written_lsn : 0;
+}
+
+void
+Journal::sync(uint64_t lsn, bool wait_for_group)
+{
+  ScopedLock lock(state.sync_mutex);
+  if (state.durable_lsn >= lsn)
+    return;
+
+  // join the group of the next fsync; this also wakes up a thread which
+  // is waiting for more committers
+  state.pending_commits++;
+  state.sync_cond.notify_all();
+
+  while (state.durable_lsn < lsn) {
+    // another thread is running the fsync; wait till it's finished, then
+    // check if it included our data
+    if (state.sync_in_progress) {
+      state.sync_cond.wait(lock);
+      continue;
+    }
+
+    state.sync_in_progress = true;
+
+    // give other committers a chance to join this group
+    if (wait_for_group && state.group_commit_delay > 0) {
+      boost::system_time deadline = boost::get_system_time()
+              + boost::posix_time::microseconds(state.group_commit_delay);
+      while ((state.group_commit_size == 0
+                || state.pending_commits < state.group_commit_size)
+              && state.sync_cond.timed_wait(lock, deadline))
+        ;
+    }
+
+    uint64_t target = state.written_lsn;
+    std::vector<uint32_t> unsynced;
+    for (uint32_t i = 0; i < state.segments.size(); i++) {
+      if (state.segments[i].unsynced) {
+        unsynced.push_back(i);
+        state.segments[i].unsynced = false;
+      }
+    }
+    state.pending_commits = 0;
+
+    // run the fsync without blocking the other committers
+    lock.unlock();
+    int fsyncs = 0;
+    try {
+      for (size_t i = 0; i < unsynced.size(); i++) {
+        state.segments[unsynced[i]].file.flush();
+        fsyncs++;
+      }
+    }
+    catch (Exception &) {
+      lock.lock();
+      for (size_t i = 0; i < unsynced.size(); i++)
+        state.segments[unsynced[i]].unsynced = true;
+      state.sync_in_progress = false;
+      state.sync_cond.notify_all();
+      throw;
+    }
+    lock.lock();
+
+    state.count_fsyncs += fsyncs;
+    if (target > state.durable_lsn)
+      state.durable_lsn = target;
+    state.sync_in_progress = false;
+    state.sync_cond.notify_all();
+  }
+}
+
 void
 Journal::close(bool noclear)
 {
+  // wait till a running fsync is finished
+  {
+    ScopedLock lock(state.sync_mutex);
+    wait_for_sync(state, lock);
+  }
+
   // the noclear flag is set during testing, for checking whether the files
   // contain the correct data. Flush the buffers, otherwise the tests will
   // fail because data is missing
-  if (unlikely(noclear))
-    flush_buffer(state, 0);
+  if (unlikely(noclear) && state.segments.size() > 0)
+    flush_buffer(state, state.current_fd);
 
   if (likely(!noclear))
     clear();
 
-  for (int i = 0; i < 2; i++)
-    state.files[i].close();
-
   state.buffer.clear();
+  clear_page_images(state);
+  state.checkpoint.reset();
+
+  // the remaining data was flushed to the database file; release all
+  // committers which are still waiting
+  ScopedLock lock(state.sync_mutex);
+  wait_for_sync(state, lock);
+  state.segments.clear();
+  state.durable_lsn = state.written_lsn;
+  state.sync_cond.notify_all();
 }
 
 void
@@ -986,18 +1897,48 @@ Journal::recover(LocalTxnManager *txn_manager)
   clear();
 }
 
+void
+Journal::release_segment(int log_descriptor)
+{
+  if (log_descriptor < 0 || log_descriptor >= (int)state.segments.size())
+    return;
+
+  assert(state.segments[log_descriptor].open_txns > 0);
+  state.segments[log_descriptor].open_txns--;
+}
+
 void
 Journal::clear()
 {
-  for (int i = 0; i < 2; i++)
+  for (uint32_t i = 0; i < state.segments.size(); i++)
     clear_file(state, i);
+  clear_page_images(state);
+
+  // a running checkpoint is no longer required; all segments are empty
+  state.checkpoint.reset();
+  state.checkpoint_sequence = 0;
+  state.bytes_since_checkpoint = 0;
+  state.dictionary_stored = false;
+
+  // the current segment remains in use
+  if (state.segments.size() > 0) {
+    state.segments[state.current_fd].sequence = ++state.sequence;
+    remove_unused_segments(state);
+  }
+}
+
+uint64_t
+Journal::checkpoint_lsn_lag()
+{
+  uint64_t lsn = state.env->lsn_manager.current;
+  return lsn > state.checkpoint_lsn ? lsn - state.checkpoint_lsn : 0;
 }
 
 void
 Journal::test_flush_buffers()
 {
-  flush_buffer(state, 0);
-  flush_buffer(state, 1);
+  if (state.segments.size() > 0)
+    flush_buffer(state, state.current_fd);
 }
 
 void
@@ -27,16 +27,35 @@
  * "Undo" information is not required because aborted Txns are never
  * written to disk. The journal only can "redo" operations.
  *
- * The journal is organized in two files. If one of the files grows too large
- * then all new Txns are stored in the other file
- * ("Log file switching"). When all Txns from file #0 are committed,
- * and file #1 exceeds a limit, then the files are switched back again.
+ * The journal is organized in several files ("segments", two by default;
+ * see UPS_PARAM_JOURNAL_SEGMENTS). If the current segment grows too large
+ * then all new Txns are stored in the next segment ("Log file switching").
+ * A segment is only reused when all Txns which were logged to it are
+ * flushed to the database file, and a checkpoint (see below) was completed
+ * after the segment was written. If no segment can be reused then an
+ * additional segment is created; it is deleted again once it is no
+ * longer in use.
+ *
+ * By default the segments grow, and are switched after a number of Txns
+ * (UPS_PARAM_JOURNAL_SWITCH_THRESHOLD). If UPS_PARAM_JOURNAL_SEGMENT_SIZE
+ * is set then the segments are preallocated, and the journal switches to
+ * the next segment when the current one is full. Reused segments are
+ * overwritten from the beginning; each write is followed by an empty
+ * entry (lsn is 0) which marks the end of the valid data. Therefore
+ * writing to the journal neither extends the files nor changes their
+ * size.
  *
  * For writing, files are buffered. The buffers are flushed when they
  * exceed a certain threshold, when a Txn is committed or a Changeset
  * was written. In case of a commit or a changeset there will also be an
  * fsync, if UPS_ENABLE_FSYNC is enabled.
  *
+ * The fsync of a commit is performed after the Environment lock was
+ * released ("group commit"). All committers that arrive while an fsync
+ * is running are made durable by the next fsync. The first of them can
+ * wait a little while (UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY) till more
+ * committers joined its group (UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE).
+ *
  * The physical information is a collection of pages which are modified in
  * one or more database operations (i.e. ups_db_erase). This collection is
  * called a "changeset" and implemented in changeset.h/.cc. As soon as the
@@ -45,6 +64,34 @@
  * Otherwise the whole changeset is appended to the journal, and afterwards
  * the database file is modified.
  *
+ * The modified pages of a changeset are written to the database file by
+ * the worker thread of the PageManager. Checkpoints tell which changesets
+ * are no longer required: the journal appends a "begin" record, and sends
+ * a message to the worker thread. The worker processes its messages in
+ * order; when the message arrives, the pages of all changesets which were
+ * logged before the "begin" record were written. The journal then appends
+ * an "end" record. A checkpoint is started whenever the journal switches
+ * to another segment, and after UPS_PARAM_JOURNAL_CHECKPOINT_SIZE bytes
+ * were written. Checkpoints run in the background ("fuzzy checkpoints");
+ * the journal only waits for the worker thread if it has to reuse a
+ * segment before its checkpoint was completed.
+ *
+ * The first time a page is logged to a journal file, the full page is
+ * stored. Afterwards only the modified byte ranges are stored, compared to
+ * the previously logged image of the page ("page delta"), unless the delta
+ * is larger than half of the page. The journal keeps a limited number of
+ * page images in memory for this; pages without image are logged in full.
+ * Since the images are discarded whenever the file is switched or cleared,
+ * each delta can be applied to the image which was restored from the same
+ * file during recovery.
+ *
+ * Keys and records can be compressed (UPS_PARAM_JOURNAL_COMPRESSION).
+ * Small records barely compress on their own; therefore the journal can
+ * collect the first keys and records in a dictionary
+ * (UPS_PARAM_JOURNAL_DICTIONARY_SIZE), and compress all further keys and
+ * records with this dictionary. The dictionary is stored in each segment
+ * before the first entry which uses it.
+ *
  * For recovery to work, each page stores the lsn of its last modification.
  *
  * When recovering, the Journal first extracts the newest/latest entry.
@@ -54,6 +101,19 @@
  * idempotent; if the database file was successfully modified then the
  * changes are re-applied; this is not a problem.)
  *
+ * Only the changesets after the "begin" record of the newest completed
+ * checkpoint are recovered; the older ones were already written to the
+ * database file.
+ *
+ * The pages of the changesets are independent of each other. Recovery
+ * first collects the entries of each page (the newest full image and the
+ * following deltas), then restores the pages with several threads
+ * (UPS_PARAM_RECOVERY_THREADS). Each thread restores a range of pages and
+ * writes each page only once; the entries of a page are applied in the
+ * order of their lsn. The logical entries are re-applied afterwards with
+ * a single thread, because they are replayed through the Transaction
+ * manager, which is shared by all databases.
+ *
  * Afterwards, upscaledb uses the lsn's to figure out whether an update
  * was already applied or not. If the journal's last entry is a changeset then
  * this changeset's lsn marks the beginning of the sequence. Otherwise the lsn
@@ -128,7 +188,18 @@ struct Journal
     kEntryTypeErase      = 5,
 
     // marks a whole changeset operation (writes modified pages)
-    kEntryTypeChangeset  = 6
+    kEntryTypeChangeset  = 6,
+
+    // marks the start of a checkpoint
+    kEntryTypeCheckpointBegin = 7,
+
+    // marks the end of a checkpoint; all changesets before the
+    // preceding kEntryTypeCheckpointBegin are written to the database
+    kEntryTypeCheckpointEnd = 8,
+
+    // stores the dictionary for the compressed keys and records of the
+    // following entries in this segment
+    kEntryTypeDictionary = 9
   };
 
   //
@@ -136,14 +207,15 @@ struct Journal
   //
   struct Iterator {
     Iterator()
-      : fdidx(0), fdstart(0), offset(0) {
+      : fdidx(0), offset(0) {
     }
 
-    // selects the file descriptor [0..1]
-    int fdidx;
+    // the segments which are not empty, from the oldest to the newest;
+    // filled when the first entry is read
+    std::vector<uint32_t> segments;
 
-    // which file descriptor did we start with? [0..1]
-    int fdstart;
+    // the current segment; an index in |segments|
+    size_t fdidx;
 
     // the offset in the file of the NEXT entry
     uint64_t offset;
@@ -160,12 +232,8 @@ struct Journal
 
   // Returns true if the journal is empty
   bool is_empty() const {
-    if (!state.files[0].is_open() && !state.files[1].is_open())
-      return true;
-
-    for (int i = 0; i < 2; i++) {
-      uint64_t size = state.files[i].file_size();
-      if (size > 0)
+    for (size_t i = 0; i < state.segments.size(); i++) {
+      if (state.segments[i].position > 0)
         return false;
     }
 
@@ -195,6 +263,22 @@ struct Journal
   int append_changeset(std::vector<Page *> &pages, uint64_t last_blob_page,
                   uint64_t lsn);
 
+  // Called when a committed Txn was flushed to the database file, and its
+  // changes were logged in a changeset. Releases one of the segments which
+  // the Txn was logged to (|LocalTxn::log_descriptors|); the segment can be
+  // reused as soon as all of its Txns were released.
+  void release_segment(int log_descriptor);
+
+  // Returns the lsn of the newest entry which was written, but is not
+  // yet durable. Returns 0 if all entries are durable, or if fsync is
+  // disabled.
+  uint64_t unsynced_lsn();
+
+  // Waits till all entries up to |lsn| are durable. Concurrent callers
+  // share the same fsync. If |wait_for_group| is true then the fsync is
+  // delayed till more callers joined (see group_commit_delay).
+  void sync(uint64_t lsn, bool wait_for_group);
+
   // Empties the journal, removes all entries
   void clear();
 
@@ -212,8 +296,21 @@ struct Journal
             = state.count_bytes_before_compression;
     metrics->journal_bytes_after_compression
             = state.count_bytes_after_compression;
+    metrics->journal_page_images = state.count_page_images;
+    metrics->journal_page_deltas = state.count_page_deltas;
+    metrics->journal_checkpoints = state.count_checkpoints;
+    metrics->journal_checkpoint_lsn = state.checkpoint_lsn;
+    metrics->journal_checkpoint_lsn_lag = checkpoint_lsn_lag();
+
+    ScopedLock lock(state.sync_mutex);
+    metrics->journal_commits = state.count_commits;
+    metrics->journal_fsyncs = state.count_fsyncs;
   }
 
+  // Returns the number of lsns which were assigned since the newest
+  // completed checkpoint started
+  uint64_t checkpoint_lsn_lag();
+
   // Flushes all buffers to disk. Used for testing.
   void test_flush_buffers();
 
@@ -49,9 +49,19 @@ UPS_PACK_0 struct UPS_PACK_1 PJournalEntry {
   // Constructor - sets all fields to 0
   PJournalEntry()
     : lsn(0), followup_size(0), txn_id(0), type(0),
-        dbname(0), _reserved(0) {
+        dbname(0), flags(0) {
   }
 
+  enum {
+    // the pages of a changeset are stored with a PJournalEntryPageDelta
+    // header, and can be stored as deltas
+    kFlagPageDeltas = 1,
+
+    // the compressed key and record were compressed with the dictionary
+    // of the segment (see Journal::kEntryTypeDictionary)
+    kFlagDictionary = 2
+  };
+
   // the lsn of this entry
   uint64_t lsn;
 
@@ -67,8 +77,8 @@ UPS_PACK_0 struct UPS_PACK_1 PJournalEntry {
   // the name of the database which is modified by this entry
   uint16_t dbname;
 
-  // a reserved value - reqd for padding
-  uint16_t _reserved;
+  // flags; older journals store 0 (this was a padding field)
+  uint16_t flags;
 } UPS_PACK_2;
 
 #include "1base/packstop.h"
@@ -201,6 +211,49 @@ UPS_PACK_0 struct UPS_PACK_1 PJournalEntryPageHeader {
 
 #include "1base/packstop.h"
 
+
+#include "1base/packstart.h"
+
+//
+// a Journal entry for a single page of a changeset with the flag
+// kFlagPageDeltas. The page is either stored in full, or as a sequence
+// of modified byte ranges (PJournalPageRange) which are applied to
+// the previous image of this page in the same journal file
+//
+UPS_PACK_0 struct UPS_PACK_1 PJournalEntryPageDelta {
+  // Constructor - sets all fields to 0
+  PJournalEntryPageDelta(uint64_t _address = 0)
+    : address(_address), compressed_size(0), delta_size(0) {
+  }
+
+  // the page address
+  uint64_t address;
+
+  // the compressed size, if compression is enabled
+  uint32_t compressed_size;
+
+  // the size of the delta, or 0 if the full page is stored
+  uint32_t delta_size;
+} UPS_PACK_2;
+
+#include "1base/packstop.h"
+
+
+#include "1base/packstart.h"
+
+//
+// a modified byte range of a page delta; followed by |size| bytes
+//
+UPS_PACK_0 struct UPS_PACK_1 PJournalPageRange {
+  // the offset of the range in the page
+  uint32_t offset;
+
+  // the size of the range
+  uint32_t size;
+} UPS_PACK_2;
+
+#include "1base/packstop.h"
+
 } // namespace upscaledb
 
 #endif /* UPS_JOURNAL_ENTRIES_H */
@@ -22,11 +22,18 @@
 #include "0root/root.h"
 
 #include <vector>
+#include <list>
+#include <map>
 #include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
 
 #include "ups/types.h" // for metrics
 
 #include "1base/dynamic_array.h"
+#include "1base/mutex.h"
+#include "1base/signal.h"
 #include "1base/scoped_ptr.h"
 #include "1os/file.h"
 #include "2page/page_collection.h"
@@ -49,20 +56,97 @@ struct JournalState {
   // References the Environment this journal file is for
   LocalEnv *env;
 
-  // The index of the file descriptor we are currently writing to (0 or 1)
+  // A journal file ("segment")
+  struct Segment {
+    Segment()
+      : position(0), sequence(0), open_txns(0), unsynced(false) {
+    }
+
+    // The file handle
+    File file;
+
+    // The offset of the next write; the data before this offset is valid
+    uint64_t position;
+
+    // Tells the order of the segments; assigned whenever the journal
+    // starts writing to this segment. 0 if the segment was never used
+    uint64_t sequence;
+
+    // The number of Txns which were logged to this segment, but are not
+    // yet flushed to the database file. The segment must not be reused
+    // before all of them are flushed
+    uint32_t open_txns;
+
+    // True if the segment was written since its last fsync; protected
+    // by |sync_mutex|
+    bool unsynced;
+  };
+
+  // The index of the segment we are currently writing to
   uint32_t current_fd;
 
-  // The two file descriptors
-  File files[2];
+  // The segments; the journal starts with |num_segments| segments and
+  // creates additional ones if all of them are in use
+  std::vector<Segment> segments;
+
+  // The configured number of segments
+  uint32_t num_segments;
+
+  // The size of the preallocated segments; 0 if segments are not
+  // preallocated and grow instead
+  uint64_t segment_size;
+
+  // The sequence number of the current segment
+  uint64_t sequence;
 
   // Buffer for writing data to the files
   ByteArray buffer;
 
+  // A checkpoint. The worker thread signals |completed| as soon as the
+  // pages of all changesets which were logged before the checkpoint
+  // started are written to the database file
+  struct Checkpoint {
+    Checkpoint()
+      : lsn(0), sequence(0) {
+    }
+
+    // The lsn of the "begin" record
+    uint64_t lsn;
+
+    // The sequence number of the segment with the "begin" record
+    uint64_t sequence;
+
+    // Notified by the worker thread
+    Signal completed;
+  };
+
+  // The running checkpoint; null if there is none. Shared with the
+  // worker thread, which might still hold a reference when the journal
+  // is closed
+  boost::shared_ptr<Checkpoint> checkpoint;
+
+  // Start a checkpoint after this many bytes were flushed; 0 if
+  // checkpoints are only started when switching the segment
+  uint64_t checkpoint_size;
+
+  // The bytes which were flushed since the last checkpoint started
+  uint64_t bytes_since_checkpoint;
+
+  // The segment sequence of the newest completed checkpoint; older
+  // segments can be reused
+  uint64_t checkpoint_sequence;
+
+  // The lsn of the newest completed checkpoint (for ups_env_get_metrics)
+  uint64_t checkpoint_lsn;
+
+  // Counting the completed checkpoints (for ups_env_get_metrics)
+  uint64_t count_checkpoints;
+
   // Counts all transactions in the current file
   uint32_t num_transactions;
 
   // When having more than these Txns in one file, we
-  // swap the files
+  // swap the files (only if the segments are not preallocated)
   uint32_t threshold;
 
   // Set to false to disable logging; used during recovery
@@ -77,12 +161,82 @@ struct JournalState {
   // Counting the bytes after compression (for ups_env_get_metrics)
   uint64_t count_bytes_after_compression;
 
+  // Counting the committed Txns (for ups_env_get_metrics)
+  uint64_t count_commits;
+
+  // Counting the fsyncs (for ups_env_get_metrics)
+  uint64_t count_fsyncs;
+
+  // Counting the changeset pages which were logged in full
+  // (for ups_env_get_metrics)
+  uint64_t count_page_images;
+
+  // Counting the changeset pages which were logged as deltas
+  // (for ups_env_get_metrics)
+  uint64_t count_page_deltas;
+
+  // Protects the group commit state below; the fsync itself runs without
+  // holding the Environment lock
+  Mutex sync_mutex;
+
+  // Signals the end of an fsync, or the arrival of a new committer
+  Condition sync_cond;
+
+  // The lsn of the newest entry which was written to the files
+  uint64_t written_lsn;
+
+  // The lsn of the newest entry which is durable
+  uint64_t durable_lsn;
+
+  // True while a thread is running an fsync
+  bool sync_in_progress;
+
+  // The number of committers waiting for the next fsync
+  uint32_t pending_commits;
+
+  // Max. time (in microseconds) to wait for more committers before
+  // starting an fsync
+  uint32_t group_commit_delay;
+
+  // Start the fsync as soon as this many committers are waiting
+  uint32_t group_commit_size;
+
   // A map of all opened databases
   typedef std::map<uint16_t, Db *> DatabaseMap;
   DatabaseMap database_map;
 
+  // The most recently logged image of a page; page deltas are calculated
+  // against this image
+  struct PageImage {
+    std::vector<uint8_t> data;
+    std::list<uint64_t>::iterator lru;
+  };
+
+  // The images of all pages which were logged to the current file (up to
+  // a limit). A page without image is logged in full, therefore each file
+  // starts with full images
+  typedef std::map<uint64_t, PageImage> PageImageMap;
+  PageImageMap page_images;
+
+  // The addresses of |page_images|; the most recently logged page is
+  // at the front
+  std::list<uint64_t> page_images_lru;
+
+  // Buffer for calculating page deltas
+  ByteArray delta;
+
   // The compressor; can be null
   ScopedPtr<Compressor> compressor;
+
+  // The dictionary for compressing keys and records; the first keys and
+  // records are collected till it reaches |dictionary_size| bytes
+  ByteArray dictionary;
+
+  // The size of the dictionary; 0 if no dictionary is used
+  uint32_t dictionary_size;
+
+  // True if the dictionary was stored in the current segment
+  bool dictionary_stored;
 };
 
 } // namespace upscaledb
@@ -21,11 +21,10 @@
 #include "0root/root.h"
 
 #include <string.h>
+#include <algorithm>
 
-#include "3rdparty/murmurhash3/MurmurHash3.h"
 // Always verify that a file of level N does not include headers > N!
 #include "1base/signal.h"
-#include "1base/dynamic_array.h"
 #include "2page/page.h"
 #include "2device/device.h"
 #include "3page_manager/page_manager.h"
@@ -69,9 +68,71 @@ struct AsyncFlushMessage
   std::vector<uint64_t> page_ids;
 };
 
+// The max. number of adjacent pages which are written with a single call
+enum { kMaxCoalescedPages = 32 };
+
+// Writes a run of locked pages with adjacent addresses, then unlocks them.
+// Runs with more than one page are submitted as a batch (if the device
+// supports it) or written with a single pwritev().
+static void
+flush_page_run(Device *device, std::vector<Page *> *run,
+                CountingSignal *signal)
+{
+  try {
+    if (run->size() == 1) {
+      run->front()->flush();
+    }
+    else if (device->write_pages(*run)) {
+      // nop
+    }
+    else if (device->supports_batched_writes()) {
+      // the batch was rejected; its pages are not necessarily adjacent
+      for (std::vector<Page *>::iterator it = run->begin();
+                      it != run->end(); it++)
+        (*it)->flush();
+    }
+    else {
+      Page::flush_run(run->data(), run->size());
+    }
+  }
+  catch (Exception &) {
+    // ignore the pages, they remain dirty
+  }
+
+  for (std::vector<Page *>::iterator it = run->begin();
+                  it != run->end(); it++)
+    (*it)->mutex().unlock();
+
+  if (signal) {
+    delete run;
+    signal->notify();
+  }
+}
+
+// Flushes the pages of an AsyncFlushMessage. The pages are locked in
+// ascending order; dirty pages with adjacent addresses are grouped into
+// runs. If the WorkerPool has more than one thread then the runs are
+// written in parallel, otherwise they are written by this thread.
+// If the device supports batched writes then all pages are submitted
+// at once.
 static void
 async_flush_pages(AsyncFlushMessage *message)
 {
+  WorkerPool *worker = message->page_manager->state->worker.get();
+  Device *device = message->device;
+  size_t page_size = device->page_size();
+  bool parallel = worker->workers.size() > 1;
+  CountingSignal signal;
+
+  // encrypted pages are encrypted one by one and cannot be coalesced
+  size_t max_run = kMaxCoalescedPages;
+  if (device->config.is_encryption_enabled)
+    max_run = 1;
+  bool batched = device->supports_batched_writes();
+
+  std::sort(message->page_ids.begin(), message->page_ids.end());
+
+  std::vector<Page *> run;
   for (std::vector<uint64_t>::iterator it = message->page_ids.begin();
                   it != message->page_ids.end();
                   it++) {
@@ -81,17 +142,37 @@ async_flush_pages(AsyncFlushMessage *message)
       continue;
     assert(page->mutex().try_lock() == false);
 
-    // flush page if it's dirty
-    if (page->is_dirty()) {
-      try {
-        page->flush();
-      }
-      catch (Exception &) {
-        // ignore page, fall through
+    // skip page if it's not dirty
+    if (!page->is_dirty()) {
+      page->mutex().unlock();
+      continue;
+    }
+
+    // write the current run if this page does not extend it
+    if (!batched && !run.empty()
+          && (run.size() == max_run
+            || page->persisted_data.size != page_size
+            || run.back()->persisted_data.size != page_size
+            || page->address() != run.back()->address() + page_size)) {
+      if (parallel) {
+        signal.add();
+        worker->post(boost::bind(&flush_page_run, device,
+                                new std::vector<Page *>(run), &signal));
       }
+      else
+        flush_page_run(device, &run, 0);
+      run.clear();
     }
-    page->mutex().unlock();
+
+    run.push_back(page);
   }
+
+  if (!run.empty())
+    flush_page_run(device, &run, 0);
+
+  // wait till the other threads are finished
+  signal.wait();
+
   if (message->in_progress)
     message->in_progress = false;
   if (message->signal)
@@ -101,10 +182,7 @@ async_flush_pages(AsyncFlushMessage *message)
 static inline void
 verify_crc32(Page *page)
 {
-  uint32_t crc32;
-  MurmurHash3_x86_32(page->payload(),
-                  page->persisted_data.size - (sizeof(PPageHeader) - 1),
-                  (uint32_t)page->address(), &crc32);
+  uint32_t crc32 = page->calculate_crc32();
   if (crc32 != page->crc32()) {
     ups_trace(("crc32 mismatch in page %lu: 0x%lx != 0x%lx",
                     page->address(), crc32, page->crc32()));
@@ -112,11 +190,45 @@ verify_crc32(Page *page)
   }
 }
 
+// Verifies the checksum of a page which was fetched from the device or from
+// the compressed cache. With UPS_ENABLE_LAZY_CRC32, a memory mapped page is
+// only verified when it is loaded the first time, and decompressed pages
+// are not verified at all: they were verified when they were loaded, or
+// were written by this process.
+static inline void
+verify_fetched_page(PageManagerState *state, Page *page, bool from_device)
+{
+  if (NOTSET(state->config.flags, UPS_ENABLE_LAZY_CRC32)) {
+    verify_crc32(page);
+    return;
+  }
+
+  if (!from_device)
+    return;
+
+  // the page was read with pread(); verify it
+  if (page->is_allocated()) {
+    verify_crc32(page);
+    return;
+  }
+
+  size_t page_id = page->address() / state->config.page_size_bytes;
+  if (page_id < state->crc32_verified.size()
+        && state->crc32_verified[page_id])
+    return;
+
+  verify_crc32(page);
+
+  if (page_id >= state->crc32_verified.size())
+    state->crc32_verified.resize(page_id + 1);
+  state->crc32_verified[page_id] = true;
+}
+
 static inline Page *
 add_to_changeset(Changeset *changeset, Page *page)
 {
   changeset->put(page);
-  assert(page->mutex().try_lock() == false);
+  assert(changeset->is_read_only() || page->mutex().try_lock() == false);
   return page;
 }
 
@@ -225,6 +337,45 @@ maybe_store_state(PageManagerState *state, Context *context, bool force)
   }
 }
 
+// Reads a page from the compressed cache, or from disk if it is not
+// stored there. Returns true if the page was read from disk.
+static inline bool
+fetch_page(PageManagerState *state, Page *page, uint64_t address)
+{
+  if (state->cache.compressed.is_enabled()
+        && state->cache.compressed.fetch(address, page)) {
+    page->set_address(address);
+    return false;
+  }
+
+  page->fetch(address);
+  return true;
+}
+
+// Stores a page which was fetched from the device or from the compressed
+// cache, and adds it to the Changeset
+static inline Page *
+store_fetched_page(PageManagerState *state, Context *context, Page *page,
+                uint32_t flags)
+{
+  assert(page->data());
+
+  /* store the page in the list */
+  page->set_without_header(ISSET(flags, PageManager::kNoHeader));
+  state->cache.put(page);
+  if (Cache::is_internal_node(page))
+    state->cache.state.cache_misses_internal++;
+
+  /* write state to disk (if necessary) */
+  if (NOTSET(flags, PageManager::kDisableStoreState)
+          && NOTSET(flags, PageManager::kReadOnly)
+          && !context->changeset.is_read_only())
+    maybe_store_state(state, context, false);
+
+  state->page_count_fetched++;
+  return add_to_changeset(&context->changeset, page);
+}
+
 static inline Page *
 fetch_unlocked(PageManagerState *state, Context *context, uint64_t address,
                 uint32_t flags)
@@ -250,31 +401,110 @@ fetch_unlocked(PageManagerState *state, Context *context, uint64_t address,
 
   page = new Page(state->device, context->db);
   try {
-    page->fetch(address);
+    bool from_device = fetch_page(state, page, address);
+
+    /* only verify crc if the page has a header */
+    if (NOTSET(flags, PageManager::kNoHeader)
+            && ISSET(state->config.flags, UPS_ENABLE_CRC32))
+      verify_fetched_page(state, page, from_device);
   }
   catch (Exception &ex) {
     delete page;
     throw ex;
   }
 
-  assert(page->data());
+  return store_fetched_page(state, context, page, flags);
+}
 
-  /* store the page in the list */
-  state->cache.put(page);
+// Returns true if the page at |address| is neither cached nor mapped, and
+// has to be read with pread(). PageManager::fetch() then releases the lock
+// while the page is read.
+static inline bool
+is_read_from_device(PageManagerState *state, uint64_t address, uint32_t flags)
+{
+  return address != 0
+          && !(state->state_page && address == state->state_page->address())
+          && NOTSET(flags, PageManager::kOnlyFromCache)
+          && NOTSET(state->config.flags, UPS_IN_MEMORY)
+          && !state->cache.peek(address)
+          && !state->cache.compressed.pages.count(address)
+          && !state->device->is_mapped(address,
+                                  state->config.page_size_bytes);
+}
 
-  /* write state to disk (if necessary) */
-  if (NOTSET(flags, PageManager::kDisableStoreState)
-          && NOTSET(flags, PageManager::kReadOnly))
-    maybe_store_state(state, context, false);
+// Returns true if |page| is a btree leaf
+static inline bool
+is_leaf_page(Page *page)
+{
+  return (page->type() == Page::kTypeBindex
+                  || page->type() == Page::kTypeBroot)
+          && PBtreeNode::from_page(page)->is_leaf();
+}
 
-  /* only verify crc if the page has a header */
-  page->set_without_header(ISSET(flags, PageManager::kNoHeader));
-  if (!page->is_without_header()
-          && ISSET(state->config.flags, UPS_ENABLE_CRC32))
-    verify_crc32(page);
+// Reads up to |count| leaf pages into the cache, starting at |address| and
+// following the right siblings. Pages which are already cached are skipped.
+// Runs in the background; the pages are not locked, and the cache discards
+// a page if a page with the same address was stored or removed while it
+// was read.
+static void
+async_read_ahead(PageManager *page_manager, LocalDb *db, uint64_t address,
+                uint32_t count)
+{
+  PageManagerState *state = page_manager->state.get();
+  Device *device = state->device;
+  uint32_t page_size = state->config.page_size_bytes;
 
-  state->page_count_fetched++;
-  return add_to_changeset(&context->changeset, page);
+  for (uint32_t i = 0; i < count && address != 0; i++) {
+    {
+      ScopedSpinlock lock(state->mutex);
+      Page *page = state->cache.peek(address);
+      if (page) {
+        address = is_leaf_page(page)
+                    ? PBtreeNode::from_page(page)->right_sibling()
+                    : 0;
+        continue;
+      }
+
+      if (device->is_mapped(address, page_size)
+            || address + page_size > device->file_size()
+            || !state->cache.begin_read_ahead(address))
+        break;
+    }
+
+    Page *page = new Page(device, db);
+    uint64_t next = 0;
+    try {
+      page->fetch(address);
+      if (!is_leaf_page(page)) {
+        delete page;
+        page = 0;
+      }
+      else {
+        if (ISSET(state->config.flags, UPS_ENABLE_CRC32))
+          verify_crc32(page);
+        next = PBtreeNode::from_page(page)->right_sibling();
+      }
+    }
+    catch (Exception &) {
+      delete page;
+      page = 0;
+    }
+
+    ScopedSpinlock lock(state->mutex);
+    // the file was truncated in the meantime?
+    if (page && address + page_size > device->file_size()) {
+      delete page;
+      page = 0;
+    }
+    if (!state->cache.end_read_ahead(address, page)) {
+      delete page;
+      break;
+    }
+    state->page_count_read_ahead++;
+    address = next;
+  }
+
+  state->read_ahead_signal.notify();
 }
 
 static inline Page *
@@ -300,7 +530,7 @@ alloc_unlocked(PageManagerState *state, Context *context, uint32_t page_type,
         goto done;
       /* otherwise fetch the page from disk */
       page = new Page(state->device, context->db);
-      page->fetch(address);
+      fetch_page(state, page, address);
       goto done;
     }
   }
@@ -372,8 +602,9 @@ PageManagerState::PageManagerState(LocalEnv *_env)
     cache(_env->config), freelist(config), needs_flush(false),
     state_page(0), last_blob_page(0), last_blob_page_id(0),
     page_count_fetched(0), page_count_index(0), page_count_blob(0),
-    page_count_page_manager(0), cache_hits(0), cache_misses(0), message(0),
-    worker(new WorkerPool(1))
+    page_count_page_manager(0), cache_hits(0), cache_misses(0),
+    page_count_read_ahead(0), message(0),
+    worker(new WorkerPool(std::max(config.flush_threads, 1u)))
 {
 }
 
@@ -387,6 +618,100 @@ PageManagerState::~PageManagerState()
   last_blob_page = 0;
 }
 
+// Returns the number of bytes in the cache
+static inline uint64_t
+cached_bytes(PageManagerState *state)
+{
+  ScopedSpinlock lock(state->mutex);
+  return state->cache.current_elements() * state->config.page_size_bytes;
+}
+
+// Stores compressed copies of clean pages which were purged from the
+// cache, then deletes the pages. The pages are compressed without holding
+// the lock; a copy is discarded if a page with the same address was stored
+// or removed in the meantime.
+static void
+compress_purged_pages(PageManagerState *state, std::vector<Page *> &purged)
+{
+  std::vector<CompressedPage *> compressed(purged.size());
+  for (size_t i = 0; i < purged.size(); i++) {
+    try {
+      compressed[i] = state->cache.compressed.compress(purged[i]->address(),
+                          (uint8_t *)purged[i]->data());
+    }
+    catch (Exception &) {
+      // ignored; the page will be read from disk
+      compressed[i] = 0;
+    }
+  }
+
+  {
+    ScopedSpinlock lock(state->mutex);
+    for (size_t i = 0; i < purged.size(); i++) {
+      if (state->cache.end_read(purged[i]->address()) && compressed[i])
+        state->cache.compressed.put(compressed[i]);
+      else
+        delete compressed[i];
+    }
+  }
+
+  for (size_t i = 0; i < purged.size(); i++)
+    delete purged[i];
+}
+
+// Connects a PageManager to the SharedCache. Other Environments shrink the
+// cache only if they can lock the Environment, because the pages must not
+// be purged while they are used.
+struct PageManagerCacheMember : public SharedCacheMember
+{
+  PageManagerCacheMember(PageManager *page_manager_)
+    : SharedCacheMember(page_manager_->state->config.shared_cache_weight),
+      page_manager(page_manager_) {
+    SharedCache::instance()->join(this,
+                page_manager->state->config.shared_cache_size_bytes);
+  }
+
+  ~PageManagerCacheMember() {
+    SharedCache::instance()->leave(this);
+  }
+
+  virtual bool try_shrink(uint64_t capacity_bytes) {
+    PageManagerState *state = page_manager->state.get();
+    if (!state->env->mutex.try_lock())
+      return false;
+    try {
+      page_manager->shrink_cache(capacity_bytes);
+    }
+    catch (Exception &) {
+      // ignored; the pages stay in the cache
+    }
+    SharedCache::instance()->account(this, cached_bytes(state));
+    state->env->mutex.unlock();
+    return true;
+  }
+
+  PageManager *page_manager;
+};
+
+PageManager::PageManager(LocalEnv *env)
+  : state(new PageManagerState(env))
+{
+  join_shared_cache();
+}
+
+PageManager::~PageManager()
+{
+  state->shared_cache_member.reset(0);
+}
+
+void
+PageManager::join_shared_cache()
+{
+  if (state->config.shared_cache_size_bytes > 0
+        && NOTSET(state->config.flags, UPS_IN_MEMORY))
+    state->shared_cache_member.reset(new PageManagerCacheMember(this));
+}
+
 void
 PageManager::initialize(uint64_t pageid)
 {
@@ -430,8 +755,79 @@ PageManager::initialize(uint64_t pageid)
 Page *
 PageManager::fetch(Context *context, uint64_t address, uint32_t flags)
 {
+  {
+    ScopedSpinlock lock(state->mutex);
+    if (!is_read_from_device(state.get(), address, flags))
+      return fetch_unlocked(state.get(), context, address, flags);
+    state->cache.begin_read(address);
+  }
+
+  // The page is read without holding the lock, otherwise concurrent
+  // readers with a cold cache would wait for each other's I/O. Pages read
+  // with pread() are always verified, also with UPS_ENABLE_LAZY_CRC32.
+  Page *page = new Page(state->device, context->db);
+  try {
+    page->fetch(address);
+    if (NOTSET(flags, PageManager::kNoHeader)
+            && ISSET(state->config.flags, UPS_ENABLE_CRC32))
+      verify_crc32(page);
+  }
+  catch (Exception &ex) {
+    delete page;
+    ScopedSpinlock lock(state->mutex);
+    state->cache.end_read(address);
+    throw ex;
+  }
+
+  ScopedSpinlock lock(state->mutex);
+  // Another thread stored or removed this page in the meantime, and the
+  // copy might be stale; use (or read) the current version instead
+  if (!state->cache.end_read(address)) {
+    delete page;
+    return fetch_unlocked(state.get(), context, address, flags);
+  }
+  return store_fetched_page(state.get(), context, page, flags);
+}
+
+void
+PageManager::read_ahead(ReadAhead &tracker, uint64_t from, Page *page)
+{
+  uint32_t page_size = state->config.page_size_bytes;
+
+  // read ahead at most a quarter of the cache
+  uint64_t max_depth = std::min((uint64_t)state->config.read_ahead_pages,
+                  state->cache.capacity() / page_size / 4);
+  if (max_depth == 0 || ISSET(state->config.flags, UPS_IN_MEMORY))
+    return;
+
+  if (from == tracker.last_address) {
+    if (tracker.remaining > 0)
+      tracker.remaining--;
+  }
+  else {
+    tracker.depth = 0;
+    tracker.remaining = 0;
+  }
+  tracker.last_address = page->address();
+
+  // don't bother if enough pages were already requested
+  if (tracker.remaining > tracker.depth / 2)
+    return;
+
+  uint64_t right = PBtreeNode::from_page(page)->right_sibling();
+  if (right == 0 || state->device->is_mapped(right, page_size))
+    return;
+
+  tracker.depth = (uint32_t)std::min(max_depth,
+                  tracker.depth ? tracker.depth * (uint64_t)2 : (uint64_t)2);
+  tracker.remaining = tracker.depth;
+
   ScopedSpinlock lock(state->mutex);
-  return fetch_unlocked(state.get(), context, address, flags);
+  if (!state->read_ahead_worker)
+    state->read_ahead_worker.reset(new WorkerPool(1));
+  state->read_ahead_signal.add();
+  state->read_ahead_worker->post(boost::bind(&async_read_ahead, this,
+                          page->db(), right, tracker.depth));
 }
 
 Page *
@@ -502,7 +898,17 @@ PageManager::fill_metrics(ups_env_metrics_t *metrics) const
   metrics->page_count_type_page_manager = state->page_count_page_manager;
   metrics->freelist_hits = state->freelist.freelist_hits;
   metrics->freelist_misses = state->freelist.freelist_misses;
+  metrics->page_count_read_ahead = state->page_count_read_ahead;
   state->cache.fill_metrics(metrics);
+
+  if (state->shared_cache_member) {
+    SharedCache *shared_cache = SharedCache::instance();
+    SharedCacheMember *member = state->shared_cache_member.get();
+    metrics->shared_cache_capacity = shared_cache->capacity_bytes;
+    metrics->shared_cache_used_bytes = shared_cache->used_bytes;
+    metrics->shared_cache_share = shared_cache->share_of(member);
+    metrics->shared_cache_shrinks = member->shrinks;
+  }
 }
 
 struct FlushAllPagesVisitor
@@ -552,43 +958,75 @@ PageManager::flush_all_pages()
 void
 PageManager::purge_cache(Context *context)
 {
-  ScopedSpinlock lock(state->mutex);
+  uint64_t capacity_bytes = state->cache.capacity();
 
-  // do NOT purge the cache iff
-  //   1. this is an in-memory Environment
-  //   2. there's still a "purge cache" operation pending
-  //   3. the cache is not full
-  if (ISSET(state->config.flags, UPS_IN_MEMORY)
-      || (state->message && state->message->in_progress == true)
-      || !state->cache.is_cache_full())
-    return;
+  // with a shared cache, the capacity depends on the other Environments
+  if (state->shared_cache_member) {
+    capacity_bytes = SharedCache::instance()->update(
+                    state->shared_cache_member.get(),
+                    cached_bytes(state.get()));
+  }
 
-  if (unlikely(!state->message))
-    state->message = new AsyncFlushMessage(this, state->device, 0);
+  shrink_cache(capacity_bytes);
+}
 
-  state->message->page_ids.clear();
-  state->garbage.clear();
+void
+PageManager::shrink_cache(uint64_t capacity_bytes)
+{
+  // clean pages which are purged while the compressed cache is enabled;
+  // they are compressed after the lock was released
+  std::vector<Page *> purged;
 
-  state->cache.purge_candidates(state->message->page_ids, state->garbage,
-          state->last_blob_page);
+  {
+    ScopedSpinlock lock(state->mutex);
 
-  // don't bother if there are only few pages
-  if (state->message->page_ids.size() > 10) {
-    state->message->in_progress = true;
-    run_async(boost::bind(&async_flush_pages, state->message));
-  }
+    // do NOT purge the cache iff
+    //   1. this is an in-memory Environment
+    //   2. there's still a "purge cache" operation pending
+    //   3. the cache is not full
+    if (ISSET(state->config.flags, UPS_IN_MEMORY)
+        || (state->message && state->message->in_progress == true)
+        || !state->cache.is_cache_full(capacity_bytes))
+      return;
 
-  for (std::vector<Page *>::iterator it = state->garbage.begin();
-                  it != state->garbage.end();
-                  it++) {
-    Page *page = *it;
-    if (likely(page->mutex().try_lock())) {
-      assert(page->cursor_list.is_empty());
-      state->cache.del(page);
-      page->mutex().unlock();
-      delete page;
+    if (unlikely(!state->message))
+      state->message = new AsyncFlushMessage(this, state->device, 0);
+
+    state->message->page_ids.clear();
+    state->garbage.clear();
+
+    state->cache.purge_candidates(state->message->page_ids, state->garbage,
+            state->last_blob_page, capacity_bytes);
+
+    // don't bother if there are only few pages
+    if (state->message->page_ids.size() > 10) {
+      state->message->in_progress = true;
+      run_async(boost::bind(&async_flush_pages, state->message));
+    }
+
+    for (std::vector<Page *>::iterator it = state->garbage.begin();
+                    it != state->garbage.end();
+                    it++) {
+      Page *page = *it;
+      if (likely(page->mutex().try_lock())) {
+        assert(page->cursor_list.is_empty());
+        state->cache.del(page);
+        page->mutex().unlock();
+        // keep a compressed copy; mapped pages are not stored because they
+        // are not read from disk
+        if (state->cache.compressed.is_enabled()
+              && page->is_allocated() && !page->is_dirty()) {
+          state->cache.begin_compress(page->address());
+          purged.push_back(page);
+        }
+        else
+          delete page;
+      }
     }
   }
+
+  if (!purged.empty())
+    compress_purged_pages(state.get(), purged);
 }
 
 void
@@ -657,6 +1095,9 @@ PageManager::close_database(Context *context, LocalDb *db)
 
   CloseDatabaseVisitor visitor(db, message);
 
+  // wait till the pages of this database were read ahead
+  state->read_ahead_signal.wait();
+
   {
     ScopedSpinlock lock(state->mutex);
 
@@ -731,6 +1172,13 @@ PageManager::close(Context *context)
 {
   // no need to lock the mutex; this method is called during shutdown
 
+  // other Environments must no longer shrink the cache
+  state->shared_cache_member.reset(0);
+
+  // wait till the pending pages were read ahead
+  state->read_ahead_signal.wait();
+  state->read_ahead_worker.reset(0);
+
   // cut off unused space at the end of the file; this space is managed
   // by the device
   state->device->reclaim_space();
@@ -770,6 +1218,7 @@ PageManager::reset(Context *context)
 {
   close(context);
   state.reset(new PageManagerState(state->env));
+  join_shared_cache();
 }
 
 Page *
@@ -836,6 +1285,7 @@ PageManager::try_lock_purge_candidate(uint64_t address)
   // directly into the page's data, and these pointers will be invalidated
   // as soon as the page is purged.
   //
+  ScopedSpinlock cursor_lock(page->cursor_list_mutex);
   if (!page->cursor_list.is_empty()) {
     page->mutex().unlock();
     return 0;
@@ -38,6 +38,7 @@
 // Always verify that a file of level N does not include headers > N!
 #include "1base/scoped_ptr.h"
 #include "3page_manager/page_manager_state.h"
+#include "3page_manager/read_ahead.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -71,10 +72,15 @@ struct PageManager
     kNoHeader = 4
   };
 
-  // Constructor
-  PageManager(LocalEnv *env)
-    : state(new PageManagerState(env)) {
-  }
+  // Constructor; joins the SharedCache if UPS_PARAM_SHARED_CACHE_SIZE
+  // is set
+  PageManager(LocalEnv *env);
+
+  // Destructor; leaves the SharedCache
+  ~PageManager();
+
+  // Joins the SharedCache if it is enabled in the configuration
+  void join_shared_cache();
 
   // Loads the state from a blob
   void initialize(uint64_t blobid);
@@ -88,6 +94,11 @@ struct PageManager
   // The page is locked and stored in |context->changeset|.
   Page *fetch(Context *context, uint64_t address, uint32_t flags = 0);
 
+  // Called whenever a cursor or a scan moves from the leaf at |from| to its
+  // right sibling |page|. As long as the leafs are visited sequentially,
+  // the following leafs are read into the cache in the background.
+  void read_ahead(ReadAhead &tracker, uint64_t from, Page *page);
+
   // Allocates a new page. |page_type| is one of Page::kType* in page.h.
   // |flags| are either 0 or kClearWithZero
   // The page is locked and stored in |context->changeset|.
@@ -106,6 +117,9 @@ struct PageManager
   // exceeded
   void purge_cache(Context *context);
 
+  // Asks the worker thread to purge the cache down to |capacity_bytes|
+  void shrink_cache(uint64_t capacity_bytes);
+
   // Reclaim file space; truncates unused file space at the end of the file.
   void reclaim_space(Context *context);
 
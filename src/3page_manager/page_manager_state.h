@@ -33,9 +33,11 @@
 #include <boost/atomic.hpp>
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/signal.h"
 #include "1base/spinlock.h"
 #include "2config/env_config.h"
 #include "3cache/cache.h"
+#include "3cache/shared_cache.h"
 #include "3page_manager/freelist.h"
 
 #ifndef UPS_ROOT_H
@@ -117,6 +119,9 @@ struct PageManagerState {
   // tracks number of cache misses
   uint64_t cache_misses;
 
+  // tracks number of pages which were read ahead
+  uint64_t page_count_read_ahead;
+
   // For sending information to the worker thread; cached to avoid memory
   // allocations
   AsyncFlushMessage *message;
@@ -124,8 +129,21 @@ struct PageManagerState {
   // For collecting unused pages; cached to avoid memory allocations
   std::vector<Page *> garbage;
 
+  // The memory mapped pages whose checksum was already verified, indexed
+  // by page ID (only used with UPS_ENABLE_LAZY_CRC32)
+  std::vector<bool> crc32_verified;
+
   // The worker thread which flushes dirty pages
   ScopedPtr<WorkerPool> worker;
+
+  // The worker thread which reads pages ahead; started on demand
+  ScopedPtr<WorkerPool> read_ahead_worker;
+
+  // Tracks the pending read-ahead requests
+  CountingSignal read_ahead_signal;
+
+  // The membership in the SharedCache; null if the cache is not shared
+  ScopedPtr<SharedCacheMember> shared_cache_member;
 };
 
 } // namespace upscaledb
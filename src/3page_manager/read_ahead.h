@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2005-2017 Christoph Rupp (chris@crupp.de).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * See the file COPYING for License information.
+ */
+
+/*
+ * Tracks the leaf pages which are visited by a cursor or a scan. As long
+ * as the leafs are visited sequentially (from left to right), the
+ * PageManager reads the following leafs in the background, and doubles
+ * the number of pages which are read ahead. See PageManager::read_ahead().
+ *
+ * @exception_safe: nothrow
+ * @thread_safe: no
+ */
+
+#ifndef UPS_READ_AHEAD_H
+#define UPS_READ_AHEAD_H
+
+#include "0root/root.h"
+
+#include "ups/types.h"
+
+// Always verify that a file of level N does not include headers > N!
+
+#ifndef UPS_ROOT_H
+#  error "root.h was not included"
+#endif
+
+namespace upscaledb {
+
+struct ReadAhead
+{
+  ReadAhead()
+    : last_address(0), depth(0), remaining(0) {
+  }
+
+  // The address of the leaf which was visited last
+  uint64_t last_address;
+
+  // The number of pages which were read ahead in the last request
+  uint32_t depth;
+
+  // The number of pages which were read ahead, but not yet visited
+  uint32_t remaining;
+};
+
+} // namespace upscaledb
+
+#endif /* UPS_READ_AHEAD_H */
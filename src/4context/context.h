@@ -31,8 +31,9 @@ struct LocalTxn;
 struct LocalEnv;
 
 struct Context {
-  Context(LocalEnv *env, LocalTxn *txn = 0, LocalDb *db = 0)
-    : txn(txn), db(db), changeset(env) {
+  Context(LocalEnv *env, LocalTxn *txn = 0, LocalDb *db = 0,
+                  bool read_only = false)
+    : txn(txn), db(db), changeset(env, read_only) {
   }
 
   ~Context() {
@@ -42,7 +43,8 @@ struct Context {
   LocalTxn *txn;
   LocalDb *db;
 
-  // Each operation has its own changeset which stores all locked pages
+  // Each operation has its own changeset which stores all locked pages;
+  // read-only operations only pin their pages
   Changeset changeset;
 };
 
@@ -96,6 +96,9 @@ append_txn_duplicates(LocalCursor *cursor, Context *context)
     // from conflicting transactions)
     if (unlikely(optxn->is_aborted()))
       continue;
+    // skip ops which are not part of a snapshot
+    if (unlikely(op->txn->is_hidden_from(cursor->txn)))
+      continue;
 
     // a normal (overwriting) insert will overwrite ALL duplicates,
     // but an overwrite of a duplicate will only overwrite
@@ -1043,14 +1046,14 @@ LocalCursor::overwrite(ups_record_t *record, uint32_t flags)
     if (is_btree_active()) {
       btree_cursor.uncouple_from_page(&context);
       st = ldb(this)->insert(this, txn, btree_cursor.uncoupled_key(),
-                      record, flags | UPS_OVERWRITE);
+                      record, flags | UPS_OVERWRITE, false);
     }
     else {
       if (txn_cursor.is_nil())
         st = UPS_CURSOR_IS_NIL;
       else
         st = ldb(this)->insert(this, txn, txn_cursor.coupled_key(), record,
-                        flags | UPS_OVERWRITE);
+                        flags | UPS_OVERWRITE, false);
     }
 
     duplicate_cache_index = old_index;
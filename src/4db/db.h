@@ -26,6 +26,7 @@
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/dynamic_array.h"
+#include "1base/mutex.h"
 #include "2config/db_config.h"
 #include "4env/env.h"
 
@@ -79,6 +80,28 @@ struct Db
   // Fills in the current metrics
   virtual void fill_metrics(ups_env_metrics_t *metrics) = 0;
 
+  // Returns true if read-only operations (lookups, cursor moves, counting
+  // and UQI queries) can run concurrently while holding the shared lock
+  // of the Environment
+  virtual bool supports_concurrent_reads() const {
+    return false;
+  }
+
+  // Returns the latch which serializes operations on this Database if they
+  // can run concurrently with operations on other Databases while holding
+  // the shared lock of the Environment; returns null if all operations
+  // require the exclusive lock of the Environment
+  virtual ReadWriteUpdateMutex *latch() {
+    return 0;
+  }
+
+  // Returns true if inserts and erases without Txn can run optimistically,
+  // concurrently with each other (see BtreeUpdateAction); requires the
+  // shared lock of the Environment
+  virtual bool supports_concurrent_updates() const {
+    return false;
+  }
+
   // Returns the database parameters (ups_db_get_parameters)
   virtual ups_status_t get_parameters(ups_parameter_t *param) = 0;
 
@@ -88,13 +111,17 @@ struct Db
   // Returns the number of keys (ups_db_count)
   virtual uint64_t count(Txn *txn, bool distinct) = 0;
 
-  // Inserts a key/value pair (ups_db_insert, ups_cursor_insert)
+  // Inserts a key/value pair (ups_db_insert, ups_cursor_insert).
+  // |optimistic| is true if the caller holds the latch for concurrent
+  // updates (see ScopedDbLock::lock_for_update)
   virtual ups_status_t insert(Cursor *cursor, Txn *txn,
-                  ups_key_t *key, ups_record_t *record, uint32_t flags) = 0;
+                  ups_key_t *key, ups_record_t *record, uint32_t flags,
+                  bool optimistic) = 0;
 
-  // Erase a key/value pair (ups_db_erase, ups_cursor_erase)
+  // Erase a key/value pair (ups_db_erase, ups_cursor_erase); see insert()
+  // for |optimistic|
   virtual ups_status_t erase(Cursor *cursor, Txn *txn, ups_key_t *key,
-                  uint32_t flags) = 0;
+                  uint32_t flags, bool optimistic) = 0;
 
   // Lookup of a key/value pair (ups_db_find, ups_cursor_find)
   virtual ups_status_t find(Cursor *cursor, Txn *txn, ups_key_t *key,
@@ -123,19 +150,19 @@ struct Db
   // Removes a cursor from the linked list of cursors
   void remove_cursor(Cursor *cursor);
 
-  // Returns the memory buffer for the key data: the per-database buffer
+  // Returns the memory buffer for the key data: the per-thread buffer
   // if |txn| is null or temporary, otherwise the buffer from the |txn|
   ByteArray &key_arena(Txn *txn) {
     return (txn == 0 || ISSET(txn->flags, UPS_TXN_TEMPORARY))
-               ? _key_arena
+               ? thread_arenas().key
                : txn->key_arena;
   }
 
-  // Returns the memory buffer for the record data: the per-database buffer
+  // Returns the memory buffer for the record data: the per-thread buffer
   // if |txn| is null or temporary, otherwise the buffer from the |txn|
   ByteArray &record_arena(Txn *txn) {
     return (txn == 0 || ISSET(txn->flags, UPS_TXN_TEMPORARY))
-               ? _record_arena
+               ? thread_arenas().record
                : txn->record_arena;
   }
 
@@ -151,13 +178,132 @@ struct Db
   // the configuration settings
   DbConfig config;
 
-  // This is where key->data points to when returning a
-  // key to the user; used if Txns are disabled
-  ByteArray _key_arena;
+  // The buffers where key->data and record->data point to when returning
+  // a key or a record to the user; used if Txns are disabled. Each thread
+  // has its own buffers because readers can run concurrently
+  struct Arenas {
+    ByteArray key;
+    ByteArray record;
+  };
+
+  // Returns the buffers of the calling thread; they are allocated on
+  // first use
+  Arenas &thread_arenas() {
+    Arenas *arenas = _arenas.get();
+    if (unlikely(arenas == 0)) {
+      arenas = new Arenas;
+      _arenas.reset(arenas);
+    }
+    return *arenas;
+  }
+
+  // The per-thread buffers; the buffers of a thread are released when the
+  // thread exits
+  boost::thread_specific_ptr<Arenas> _arenas;
+};
+
+// Acquires the locks for an operation on a single Database. If the Database
+// has a latch then the Environment is locked in shared mode, and the latch
+// is locked shared (for concurrent readers), for concurrent updates or
+// exclusively. Otherwise the Environment is locked exclusively, or shared
+// for concurrent readers.
+struct ScopedDbLock {
+  enum {
+    kExclusive  = 0,
+    kShared     = 1,
+    kUpdate     = 2
+  };
+
+  ScopedDbLock()
+    : latch_(0), mode_(kExclusive) {
+  }
+
+  ScopedDbLock(Db *db, bool read_only)
+    : latch_(0), mode_(kExclusive) {
+    lock(db, read_only);
+  }
+
+  ~ScopedDbLock() {
+    unlock();
+  }
+
+  // |read_only| is true for lookups without a Txn
+  void lock(Db *db, bool read_only) {
+    bool shared = read_only && db->supports_concurrent_reads();
+    if (db->latch()) {
+      env_lock.lock(db->env->mutex, true);
+      lock_latch(db->latch(), shared ? kShared : kExclusive);
+    }
+    else
+      env_lock.lock(db->env->mutex, shared);
+  }
+
+  // Locks the Database for an insert or erase without Txn. Uncontended
+  // updates take the exclusive latch, otherwise they are optimistic and
+  // run concurrently if the Database supports this.
+  void lock_for_update(Db *db) {
+    if (!db->latch()) {
+      lock(db, false);
+      return;
+    }
+
+    env_lock.lock(db->env->mutex, true);
+    ReadWriteUpdateMutex *latch = db->latch();
+    if (!db->supports_concurrent_updates())
+      lock_latch(latch, kExclusive);
+    else if (latch->try_lock()) {
+      latch_ = latch;
+      mode_ = kExclusive;
+    }
+    else
+      lock_latch(latch, kUpdate);
+  }
+
+  // An optimistic update failed because the Btree has to be restructured;
+  // re-acquires the latch exclusively
+  void upgrade() {
+    ReadWriteUpdateMutex *latch = latch_;
+    unlock_latch();
+    lock_latch(latch, kExclusive);
+  }
+
+  // Returns true if this is the lock of an optimistic update
+  bool is_optimistic() const {
+    return latch_ != 0 && mode_ == kUpdate;
+  }
+
+  void lock_latch(ReadWriteUpdateMutex *latch, int mode) {
+    if (mode == kShared)
+      latch->lock_shared();
+    else if (mode == kUpdate)
+      latch->lock_update();
+    else
+      latch->lock();
+    latch_ = latch;
+    mode_ = mode;
+  }
+
+  void unlock_latch() {
+    if (latch_) {
+      if (mode_ == kShared)
+        latch_->unlock_shared();
+      else if (mode_ == kUpdate)
+        latch_->unlock_update();
+      else
+        latch_->unlock();
+      latch_ = 0;
+    }
+  }
+
+  // The latch is released before the Environment's lock
+  void unlock() {
+    unlock_latch();
+    env_lock.unlock();
+  }
 
-  // This is where record->data points to when returning a
-  // record to the user; used if Txns are disabled
-  ByteArray _record_arena;
+  ScopedReadWriteLock env_lock;
+  ReadWriteUpdateMutex *latch_;
+  int mode_;
 };
 
 } // namespace upscaledb
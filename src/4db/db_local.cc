@@ -18,7 +18,11 @@
 
 #include "0root/root.h"
 
+#include <algorithm>
+#include <vector>
+
 // Always verify that a file of level N does not include headers > N!
+#include "1base/signal.h"
 #include "1globals/callbacks.h"
 #include "3page_manager/page_manager.h"
 #include "3journal/journal.h"
@@ -145,7 +149,7 @@ is_key_erased(Context *context, TxnIndex *txn_index, ups_key_t *key)
                   op != 0;
                   op = op->previous_in_node) {
     Txn *optxn = op->txn;
-    if (optxn->is_aborted())
+    if (optxn->is_aborted() || op->txn->is_hidden_from(context->txn))
       continue;
     if (optxn->is_committed() || context->txn == optxn) {
       if (ISSET(op->flags, TxnOperation::kIsFlushed))
@@ -326,6 +330,7 @@ find_txn(LocalDb *db, Context *context, LocalCursor *cursor, ups_key_t *key,
   //    because we've found a conflict
   // - if a committed txn has erased the item then there's no need
   //    to continue checking older, committed txns
+  // - is this op invisible to the snapshot of a read-only txn? then skip it
   //
 retry:
   if (node)
@@ -333,7 +338,7 @@ retry:
 
   for (; op != 0; op = op->previous_in_node) {
     Txn *optxn = op->txn;
-    if (optxn->is_aborted())
+    if (optxn->is_aborted() || op->txn->is_hidden_from(context->txn))
       continue;
 
     if (optxn->is_committed() || context->txn == optxn) {
@@ -800,6 +805,26 @@ LocalDb::open(Context *context, PBtreeHeader *btree_header)
   return 0;
 }
 
+bool
+LocalDb::supports_concurrent_reads() const
+{
+  // Transactions, duplicate tables and compressed keys or records are
+  // backed by caches and buffers which are modified during lookups
+  return NOTSET(flags(), UPS_ENABLE_TRANSACTIONS | UPS_ENABLE_DUPLICATE_KEYS)
+          && config.key_compressor == 0
+          && config.record_compressor == 0;
+}
+
+bool
+LocalDb::supports_concurrent_updates() const
+{
+  // Optimistic updates only lock the leaf; therefore they must not modify
+  // other per-database state like the record number or open cursors
+  return supports_concurrent_reads()
+          && NOTSET(flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
+          && cursor_list == 0;
+}
+
 struct MetricsVisitor : public BtreeVisitor {
   MetricsVisitor(ups_env_metrics_t *metrics_)
     : metrics(metrics_) {
@@ -907,7 +932,8 @@ LocalDb::count(Txn *htxn, bool distinct)
 {
   LocalTxn *txn = dynamic_cast<LocalTxn *>(htxn);
 
-  Context context(lenv(this), txn, this);
+  Context context(lenv(this), txn, this,
+                  !txn && supports_concurrent_reads());
 
   // purge cache if necessary
   lenv(this)->page_manager->purge_cache(&context);
@@ -1088,7 +1114,7 @@ insert_impl(LocalDb *db, Context *context, LocalCursor *cursor,
 
 ups_status_t
 LocalDb::insert(Cursor *hcursor, Txn *txn, ups_key_t *key,
-                ups_record_t *record, uint32_t flags)
+                ups_record_t *record, uint32_t flags, bool optimistic)
 {
   if (config.flags & (UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)) {
     if (unlikely(key->size == 0 && key->data != 0)) {
@@ -1124,7 +1150,8 @@ LocalDb::insert(Cursor *hcursor, Txn *txn, ups_key_t *key,
 
   LocalTxn *local_txn = 0;
   LocalCursor *cursor = (LocalCursor *)hcursor;
-  Context context(lenv(this), (LocalTxn *)txn, this);
+  // optimistic updates only pin their pages, except for the leaf
+  Context context(lenv(this), (LocalTxn *)txn, this, optimistic);
 
   if (cursor && NOTSET(flags, UPS_DUPLICATE) && NOTSET(flags, UPS_OVERWRITE))
     cursor->duplicate_cache_index = 0;
@@ -1154,7 +1181,8 @@ LocalDb::insert(Cursor *hcursor, Txn *txn, ups_key_t *key,
 }
 
 ups_status_t
-LocalDb::erase(Cursor *hcursor, Txn *txn, ups_key_t *key, uint32_t flags)
+LocalDb::erase(Cursor *hcursor, Txn *txn, ups_key_t *key, uint32_t flags,
+                bool optimistic)
 {
   LocalCursor *cursor = (LocalCursor *)hcursor;
 
@@ -1171,7 +1199,7 @@ LocalDb::erase(Cursor *hcursor, Txn *txn, ups_key_t *key, uint32_t flags)
   }
 
   LocalTxn *local_txn = 0;
-  Context context(lenv(this), (LocalTxn *)txn, this);
+  Context context(lenv(this), (LocalTxn *)txn, this, optimistic);
 
   if (!txn && ISSET(this->flags(), UPS_ENABLE_TRANSACTIONS)) {
     local_txn = begin_temp_txn(lenv(this));
@@ -1210,7 +1238,8 @@ LocalDb::find(Cursor *hcursor, Txn *txn, ups_key_t *key,
     return find(c.get(), txn, key, record, flags);
   }
 
-  Context context(lenv(this), (LocalTxn *)txn, this);
+  Context context(lenv(this), (LocalTxn *)txn, this,
+                  !txn && supports_concurrent_reads());
 
   // purge cache if necessary
   lenv(this)->page_manager->purge_cache(&context);
@@ -1279,7 +1308,8 @@ LocalDb::bulk_operations(Txn *txn, ups_operation_t *ops, size_t ops_length,
   for (size_t i = 0; i < ops_length; i++, ops++) {
     switch (ops->type) {
       case UPS_OP_INSERT:
-        ops->result = insert(0, txn, &ops->key, &ops->record, ops->flags);
+        ops->result = insert(0, txn, &ops->key, &ops->record, ops->flags,
+                        false);
         // if this a record number database? then we might have to copy the key
         if (likely(ops->result == 0)
                 && ISSETANY(flags(), UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
@@ -1302,7 +1332,7 @@ LocalDb::bulk_operations(Txn *txn, ups_operation_t *ops, size_t ops_length,
         }
         break;
       case UPS_OP_ERASE:
-        ops->result = erase(0, txn, &ops->key, ops->flags);
+        ops->result = erase(0, txn, &ops->key, ops->flags, false);
         break;
       default:
         return UPS_INV_PARAMETER;
@@ -1359,7 +1389,8 @@ LocalDb::cursor_move(Cursor *hcursor, ups_key_t *key,
 {
   LocalCursor *cursor = (LocalCursor *)hcursor;
 
-  Context context(lenv(this), (LocalTxn *)cursor->txn, this);
+  Context context(lenv(this), (LocalTxn *)cursor->txn, this,
+                  !cursor->txn && supports_concurrent_reads());
 
   // purge cache if necessary
   lenv(this)->page_manager->purge_cache(&context);
@@ -1441,6 +1472,134 @@ are_cursors_identical(LocalCursor *c1, LocalCursor *c2)
   return k1 == k2;
 }
 
+// Returns true if a scan over the whole database can be split into
+// partitions which are visited in parallel. This is not possible if the
+// visitor cannot merge partial results, or if the scan has to pick up
+// transactional keys or duplicate keys.
+static bool
+is_parallel_select_possible(LocalDb *db, ScanVisitor *visitor)
+{
+  if (!visitor->supports_combine())
+    return false;
+  if (ISSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS)
+          || db->config.key_compressor != 0
+          || db->config.record_compressor != 0)
+    return false;
+  return NOTSET(db->flags(), UPS_ENABLE_TRANSACTIONS)
+          || db->txn_index->first() == 0;
+}
+
+// A partition of a parallel scan: the leafs starting at |first_page|, up to
+// (but excluding) |end_page|
+struct SelectPartition {
+  LocalDb *db;
+  SelectStatement *stmt;
+  ScanVisitor *visitor;
+  uint64_t first_page;
+  uint64_t end_page;
+  ups_status_t st;
+  CountingSignal *signal;
+};
+
+// The work item which scans a SelectPartition in a worker thread
+struct SelectPartitionTask {
+  SelectPartitionTask(SelectPartition *partition_)
+    : partition(partition_) {
+  }
+
+  void operator()() {
+    LocalDb *db = partition->db;
+
+    try {
+      Context context(lenv(db), 0, db, true);
+
+      uint64_t address = partition->first_page;
+      while (address != partition->end_page) {
+        Page *page = lenv(db)->page_manager->fetch(&context, address,
+                        PageManager::kReadOnly);
+        BtreeNodeProxy *node = db->btree_index->get_node_from_page(page);
+        if (node->length() > 0)
+          node->scan(&context, partition->visitor, partition->stmt, 0,
+                          partition->stmt->distinct);
+        address = node->right_sibling();
+      }
+    }
+    catch (Exception &ex) {
+      partition->st = ex.code;
+    }
+
+    partition->signal->notify();
+  }
+
+  SelectPartition *partition;
+};
+
+// Splits the leafs of the database into one partition per worker thread;
+// the partitions are aligned to the children of the root node. Each
+// partition is scanned with its own visitor, and the partial results are
+// merged into |visitor| in key order.
+static ups_status_t
+select_parallel(LocalDb *db, Context *context, WorkerPool *pool,
+                SelectStatement *stmt, ScanVisitor *visitor)
+{
+  PageManager *page_manager = lenv(db)->page_manager.get();
+  BtreeIndex *btree = db->btree_index.get();
+  BtreeNodeProxy *root = btree->get_node_from_page(btree->root_page(context));
+  assert(!root->is_leaf());
+
+  size_t children = root->length() + 1;
+  size_t count = std::min(children, pool->workers.size());
+
+  // each partition starts with the left-most leaf of a child of the root;
+  // the last partition ends with the right-most leaf
+  std::vector<uint64_t> leafs(count + 1, 0);
+  for (size_t i = 0; i < count; i++) {
+    size_t child = i * children / count;
+    uint64_t address = child == 0
+                          ? root->left_child()
+                          : root->record_id(context, (int)child - 1);
+    BtreeNodeProxy *node = btree->get_node_from_page(page_manager->fetch(
+                          context, address, PageManager::kReadOnly));
+    while (!node->is_leaf()) {
+      address = node->left_child();
+      node = btree->get_node_from_page(page_manager->fetch(context,
+                          address, PageManager::kReadOnly));
+    }
+    leafs[i] = address;
+  }
+
+  // the first partition uses the caller's visitor; all others are merged
+  // into it afterwards
+  std::vector<SelectPartition> partitions(count);
+  CountingSignal signal(count);
+  for (size_t i = 0; i < count; i++) {
+    SelectPartition &p = partitions[i];
+    p.db = db;
+    p.stmt = stmt;
+    p.visitor = i == 0 ? visitor : ScanVisitorFactory::from_select(stmt, db);
+    p.first_page = leafs[i];
+    p.end_page = leafs[i + 1];
+    p.st = 0;
+    p.signal = &signal;
+    assert(p.visitor != 0);
+  }
+
+  for (size_t i = 0; i < count; i++)
+    pool->post(SelectPartitionTask(&partitions[i]));
+  signal.wait();
+
+  ups_status_t st = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (st == 0)
+      st = partitions[i].st;
+    if (i > 0) {
+      visitor->combine(partitions[i].visitor);
+      delete partitions[i].visitor;
+    }
+  }
+  return st;
+}
+
 ups_status_t
 LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
                 LocalCursor *end, Result **presult)
@@ -1462,15 +1621,27 @@ LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
   if (unlikely(!visitor.get()))
     return UPS_PARSER_ERROR;
 
-  Context context(lenv(this), 0, this);
+  Context context(lenv(this), 0, this, supports_concurrent_reads());
 
   Result *result = new Result;
 
   // purge cache if necessary
   lenv(this)->page_manager->purge_cache(&context);
 
-  // create a cursor, move it to the first key
   ups_status_t st = 0;
+
+  // a scan over the whole database is split into partitions of leaf pages,
+  // which are visited in parallel
+  if (!begin && !end && is_parallel_select_possible(this, visitor.get())) {
+    WorkerPool *pool = lenv(this)->select_pool();
+    Page *root = btree_index->root_page(&context);
+    if (pool && !btree_index->get_node_from_page(root)->is_leaf()) {
+      st = select_parallel(this, &context, pool, stmt, visitor.get());
+      goto bail;
+    }
+  }
+
+  // create a cursor, move it to the first key
   if (!cursor) {
     tmpcursor.reset(new LocalCursor(this, 0));
     cursor = tmpcursor.get();
@@ -1486,7 +1657,7 @@ LocalDb::select_range(SelectStatement *stmt, LocalCursor *begin,
       goto bail;
     // now process the key
     (*visitor)(key.data, key.size, record.data, record.size);
-    st = cursor->move(&context, &key, 0, UPS_CURSOR_NEXT);
+    st = cursor->move(&context, &key, &record, UPS_CURSOR_NEXT);
     if (unlikely(st))
       goto bail;
   }
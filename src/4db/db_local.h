@@ -71,6 +71,18 @@ struct LocalDb : public Db {
   // Fills in the current metrics
   virtual void fill_metrics(ups_env_metrics_t *metrics);
 
+  // Returns true if read-only operations can run concurrently
+  virtual bool supports_concurrent_reads() const;
+
+  // Returns the latch for operations on this database; null if Transactions
+  // are enabled
+  virtual ReadWriteUpdateMutex *latch() {
+    return NOTSET(flags(), UPS_ENABLE_TRANSACTIONS) ? &_latch : 0;
+  }
+
+  // Returns true if inserts and erases can run optimistically
+  virtual bool supports_concurrent_updates() const;
+
   // Returns database parameters (ups_db_get_parameters)
   virtual ups_status_t get_parameters(ups_parameter_t *param);
 
@@ -82,11 +94,11 @@ struct LocalDb : public Db {
 
   // Inserts a key/value pair (ups_db_insert, ups_cursor_insert)
   virtual ups_status_t insert(Cursor *cursor, Txn *txn, ups_key_t *key,
-                  ups_record_t *record, uint32_t flags);
+                  ups_record_t *record, uint32_t flags, bool optimistic);
 
   // Erase a key/value pair (ups_db_erase, ups_cursor_erase)
   virtual ups_status_t erase(Cursor *cursor, Txn *txn, ups_key_t *key,
-                  uint32_t flags);
+                  uint32_t flags, bool optimistic);
 
   // Lookup of a key/value pair (ups_db_find, ups_cursor_find)
   virtual ups_status_t find(Cursor *cursor, Txn *txn, ups_key_t *key,
@@ -134,6 +146,11 @@ struct LocalDb : public Db {
 
   // Lower/upper boundaries
   Histogram histogram;
+
+  // Serializes writers of this database; without Transactions, writers of
+  // different databases only hold the shared lock of the Environment.
+  // Optimistic updates share the latch with each other
+  ReadWriteUpdateMutex _latch;
 };
 
 } // namespace upscaledb
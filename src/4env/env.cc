@@ -18,6 +18,8 @@
 
 #include "0root/root.h"
 
+#include <vector>
+
 // Always verify that a file of level N does not include headers > N!
 #include "4cursor/cursor.h"
 #include "4db/db.h"
@@ -95,12 +97,26 @@ Env::close(uint32_t flags)
 {
   ups_status_t st = 0;
 
-  ScopedLock lock(mutex);
+  ScopedWriteLock lock(mutex);
 
   /* auto-abort (or commit) all pending transactions */
   if (txn_manager.get()) {
     Txn *t;
 
+    /* first finish the read-only transactions; as long as they are active,
+     * newer committed transactions are not flushed */
+    std::vector<Txn *> snapshots;
+    for (t = txn_manager->oldest_txn(); t != 0; t = t->next())
+      if (ISSET(t->flags, UPS_TXN_READ_ONLY)
+          && !t->is_aborted() && !t->is_committed())
+        snapshots.push_back(t);
+    for (std::vector<Txn *>::iterator it = snapshots.begin();
+                    it != snapshots.end(); it++) {
+      st = txn_manager->abort(*it);
+      if (unlikely(st))
+        return st;
+    }
+
     while ((t = txn_manager->oldest_txn())) {
       if (!t->is_aborted() && !t->is_committed()) {
         if (ISSET(flags, UPS_TXN_AUTO_COMMIT))
@@ -116,6 +116,17 @@ struct Env
   // Commits a transaction (ups_txn_abort)
   virtual ups_status_t txn_abort(Txn *txn, uint32_t flags) = 0;
 
+  // Returns the lsn of committed data which is not yet durable, or 0.
+  // Called after txn_commit, while the lock is still held
+  virtual uint64_t txn_unsynced_lsn() {
+    return 0;
+  }
+
+  // Waits till the committed data up to |lsn| is durable. Called without
+  // holding the lock; concurrent committers share a single fsync
+  virtual void txn_sync(uint64_t) {
+  }
+
   // Fills in the current metrics
   virtual void fill_metrics(ups_env_metrics_t *metrics) = 0;
 
@@ -123,6 +134,13 @@ struct Env
   virtual ups_status_t select_range(const char *query, Cursor *begin,
                           const Cursor *end, Result **result) = 0;
 
+  // Returns the (already opened) Database of the UQI |query| if the query
+  // can run concurrently with other readers, i.e. with the shared lock;
+  // otherwise returns null
+  virtual Db *concurrent_select_db(const char *) {
+    return 0;
+  }
+
   // Creates a new database in the environment (ups_env_create_db)
   virtual Db *do_create_db(DbConfig &config, const ups_parameter_t *param) = 0;
 
@@ -135,8 +153,9 @@ struct Env
   // Closes the Environment (ups_env_close)
   ups_status_t close(uint32_t flags);
 
-  // A mutex to serialize access to this Environment
-  Mutex mutex;
+  // A mutex to serialize access to this Environment; read-only operations
+  // which support concurrency only acquire the shared lock
+  ReadWriteMutex mutex;
 
   // The Environment's configuration
   EnvConfig config;
@@ -61,8 +61,8 @@ typedef UPS_PACK_0 struct UPS_PACK_1
   // for storing journal compression algorithm
   uint8_t journal_compression;
 
-  // reserved
-  uint8_t _reserved2;
+  // the algorithm of the page checksums (EnvConfig::kChecksum*)
+  uint8_t page_checksum;
 
   // blob id of the PageManager's state
   uint64_t page_manager_blobid;
@@ -79,6 +79,12 @@ typedef UPS_PACK_0 struct UPS_PACK_1
 
 struct EnvHeader
 {
+  enum {
+    // The previous file version; such files have no checksum algorithm in
+    // the header and use MurmurHash3, but are otherwise compatible
+    kFileVersionMurmurHash3 = 5
+  };
+
   // Constructor
   EnvHeader(Page *page)
     : header_page(page) {
@@ -159,6 +165,16 @@ struct EnvHeader
     header()->journal_compression = algorithm << 4;
   }
 
+  // Returns the algorithm of the page checksums
+  int page_checksum() {
+    return header()->page_checksum;
+  }
+
+  // Sets the algorithm of the page checksums
+  void set_page_checksum(int algorithm) {
+    header()->page_checksum = (uint8_t)algorithm;
+  }
+
   // Returns a pointer to the header data
   PEnvironmentHeader *header() {
     return (PEnvironmentHeader *)(header_page->payload());
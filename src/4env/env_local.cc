@@ -144,6 +144,8 @@ LocalEnv::create()
           UPS_FILE_VERSION);
   header->set_page_size(config.page_size_bytes);
   header->set_max_databases(config.max_databases);
+  config.page_checksum = EnvConfig::kChecksumCrc32c;
+  header->set_page_checksum(config.page_checksum);
 
   /* load page manager after setting up the blobmanager and the device! */
   page_manager.reset(new PageManager(this));
@@ -236,13 +238,29 @@ LocalEnv::open()
     }
 
     // Check the database version; everything with a different file version
-    // is incompatible.
-    if (header->version(3) != UPS_FILE_VERSION) {
+    // is incompatible. Files of the previous version only differ in their
+    // page checksums, and are still supported.
+    if (header->version(3) != UPS_FILE_VERSION
+          && header->version(3) != EnvHeader::kFileVersionMurmurHash3) {
       ups_log(("invalid file version"));
       st = UPS_INV_FILE_VERSION;
       goto fail_with_fake_cleansing;
     }
 
+    if (header->version(3) == EnvHeader::kFileVersionMurmurHash3
+          && header->page_checksum() != EnvConfig::kChecksumMurmurHash3) {
+      ups_log(("invalid page checksum algorithm for file version %d",
+                  (int)header->version(3)));
+      st = UPS_INV_FILE_VERSION;
+      goto fail_with_fake_cleansing;
+    }
+
+    if (header->page_checksum() > EnvConfig::kChecksumCrc32c) {
+      ups_log(("unknown page checksum algorithm %d", header->page_checksum()));
+      st = UPS_INV_FILE_VERSION;
+      goto fail_with_fake_cleansing;
+    }
+
     st = 0;
 
 fail_with_fake_cleansing:
@@ -267,6 +285,7 @@ fail_with_fake_cleansing:
   /* Now that the header page was fetched we can retrieve the compression
    * information */
   config.journal_compressor = header->journal_compression();
+  config.page_checksum = header->page_checksum();
 
   /* load page manager after setting up the blobmanager and the device! */
   page_manager.reset(new PageManager(this));
@@ -341,6 +360,54 @@ LocalEnv::get_parameters(ups_parameter_t *param)
       case UPS_PARAM_JOURNAL_SWITCH_THRESHOLD:
         p->value = config.journal_switch_threshold;
         break;
+      case UPS_PARAM_JOURNAL_SEGMENTS:
+        p->value = config.journal_segments;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        p->value = config.journal_segment_size;
+        break;
+      case UPS_PARAM_JOURNAL_CHECKPOINT_SIZE:
+        p->value = config.journal_checkpoint_size;
+        break;
+      case UPS_PARAM_JOURNAL_DICTIONARY_SIZE:
+        p->value = config.journal_dictionary_size;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY:
+        p->value = config.journal_group_commit_delay;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE:
+        p->value = config.journal_group_commit_size;
+        break;
+      case UPS_PARAM_SELECT_THREADS:
+        p->value = config.select_threads;
+        break;
+      case UPS_PARAM_RECOVERY_THREADS:
+        p->value = config.recovery_threads;
+        break;
+      case UPS_PARAM_FLUSH_THREADS:
+        p->value = config.flush_threads;
+        break;
+      case UPS_PARAM_CACHE_POLICY:
+        p->value = config.cache_policy;
+        break;
+      case UPS_PARAM_READ_AHEAD_PAGES:
+        p->value = config.read_ahead_pages;
+        break;
+      case UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT:
+        p->value = config.cache_internal_nodes_percent;
+        break;
+      case UPS_PARAM_SHARED_CACHE_SIZE:
+        p->value = config.shared_cache_size_bytes;
+        break;
+      case UPS_PARAM_SHARED_CACHE_WEIGHT:
+        p->value = config.shared_cache_weight;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_SIZE:
+        p->value = config.compressed_cache_size_bytes;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR:
+        p->value = config.compressed_cache_compressor;
+        break;
       case UPS_PARAM_JOURNAL_COMPRESSION:
         p->value = config.journal_compressor;
         break;
@@ -419,6 +486,36 @@ LocalEnv::select_range(const char *query, Cursor *begin,
   return st;
 }
 
+Db *
+LocalEnv::concurrent_select_db(const char *query)
+{
+  SelectStatement stmt;
+  if (unlikely(Parser::parse_select(query, stmt)))
+    return 0;
+
+  // the database must already be open; otherwise it is opened (and
+  // closed) by select_range(), which requires the exclusive lock
+  DatabaseMap::iterator it = _database_map.find(stmt.dbid);
+  if (it == _database_map.end() || !it->second->supports_concurrent_reads())
+    return 0;
+  return it->second;
+}
+
+WorkerPool *
+LocalEnv::select_pool()
+{
+  size_t threads = config.select_threads;
+  if (threads == 0)
+    threads = boost::thread::hardware_concurrency();
+  if (threads <= 1)
+    return 0;
+
+  ScopedLock lock(select_workers_mutex);
+  if (!select_workers)
+    select_workers.reset(new WorkerPool(threads));
+  return select_workers.get();
+}
+
 Db *
 LocalEnv::do_create_db(DbConfig &dbconfig, const ups_parameter_t *param)
 {
@@ -771,6 +868,18 @@ LocalEnv::txn_commit(Txn *txn, uint32_t)
   return txn_manager->commit(txn);
 }
 
+uint64_t
+LocalEnv::txn_unsynced_lsn()
+{
+  return journal.get() ? journal->unsynced_lsn() : 0;
+}
+
+void
+LocalEnv::txn_sync(uint64_t lsn)
+{
+  journal->sync(lsn, true);
+}
+
 ups_status_t
 LocalEnv::txn_abort(Txn *txn, uint32_t)
 {
@@ -782,6 +891,9 @@ LocalEnv::do_close(uint32_t flags)
 {
   Context context(this);
 
+  /* stop the threads for parallel UQI scans */
+  select_workers.reset();
+
   /* flush all committed transactions */
   if (likely(txn_manager.get() != 0))
     txn_manager->flush_committed_txns(&context);
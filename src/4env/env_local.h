@@ -27,6 +27,7 @@
 #include "1base/scoped_ptr.h"
 #include "2lsn_manager/lsn_manager.h"
 #include "2device/device.h"
+#include "2worker/worker.h"
 #include "3journal/journal.h"
 #include "3blob_manager/blob_manager.h"
 #include "3page_manager/page_manager.h"
@@ -83,6 +84,12 @@ struct LocalEnv : public Env
   // Commits a transaction (ups_txn_abort)
   virtual ups_status_t txn_abort(Txn *txn, uint32_t flags);
 
+  // Returns the lsn of committed journal data which is not yet durable
+  virtual uint64_t txn_unsynced_lsn();
+
+  // Waits till the journal data up to |lsn| is durable (group commit)
+  virtual void txn_sync(uint64_t lsn);
+
   // Renames a database in the Environment (ups_env_rename_db)
   virtual ups_status_t rename_db(uint16_t oldname, uint16_t newname,
                   uint32_t flags);
@@ -97,6 +104,13 @@ struct LocalEnv : public Env
   virtual ups_status_t select_range(const char *query, Cursor *begin,
                           const Cursor *end, Result **result);
 
+  // Returns the Database of the UQI |query| if it can run concurrently
+  virtual Db *concurrent_select_db(const char *query);
+
+  // Returns the thread pool for parallel UQI scans, or null if scans are
+  // not split across threads; the pool is started on first use
+  WorkerPool *select_pool();
+
   // Closes the Environment (ups_env_close)
   virtual ups_status_t do_close(uint32_t flags);
 
@@ -117,6 +131,17 @@ struct LocalEnv : public Env
 
   // The lsn manager
   LsnManager lsn_manager;
+
+  // Serializes concurrent writers while they access pages which are shared
+  // by all databases (blob pages and the header page); see
+  // Changeset::lock_shared_pages()
+  Mutex shared_pages_mutex;
+
+  // The thread pool for parallel UQI scans (see select_pool())
+  ScopedPtr<WorkerPool> select_workers;
+
+  // Protects |select_workers| while it is started
+  Mutex select_workers_mutex;
 };
 
 } // namespace upscaledb
@@ -76,6 +76,10 @@ move_top_in_node(TxnCursor *cursor, TxnNode *node, bool ignore_conflicts,
                   op != 0;
                   op = op->previous_in_node) {
     Txn *optxn = op->txn;
+    // skip ops which are not part of a snapshot
+    if (op->txn->is_hidden_from(state_.parent->txn))
+      continue;
+
     // only look at ops from the current transaction and from
     // committed transactions
     if (optxn == state_.parent->txn || optxn->is_committed()) {
@@ -168,19 +172,29 @@ TxnCursor::move(uint32_t flags)
   if (ISSET(flags, UPS_CURSOR_FIRST)) {
     set_to_nil();
 
+    // skip nodes without visible ops (i.e. if all ops are hidden from
+    // a snapshot)
     node = db(state_)->txn_index->first();
-    if (unlikely(!node))
-      return UPS_KEY_NOT_FOUND;
-    return move_top_in_node(this, node, false, flags);
+    for (; node != 0; node = node->next_sibling()) {
+      st = move_top_in_node(this, node, false, flags);
+      if (st != UPS_KEY_NOT_FOUND)
+        return st;
+    }
+    return UPS_KEY_NOT_FOUND;
   }
 
   if (ISSET(flags, UPS_CURSOR_LAST)) {
     set_to_nil();
 
+    // skip nodes without visible ops (i.e. if all ops are hidden from
+    // a snapshot)
     node = db(state_)->txn_index->last();
-    if (unlikely(!node))
-      return UPS_KEY_NOT_FOUND;
-    return move_top_in_node(this, node, false, flags);
+    for (; node != 0; node = node->previous_sibling()) {
+      st = move_top_in_node(this, node, false, flags);
+      if (st != UPS_KEY_NOT_FOUND)
+        return st;
+    }
+    return UPS_KEY_NOT_FOUND;
   }
 
   if (ISSET(flags, UPS_CURSOR_NEXT)) {
@@ -18,6 +18,8 @@
 
 #include "0root/root.h"
 
+#include <limits>
+
 // Always verify that a file of level N does not include headers > N!
 #include "3btree/btree_index.h"
 #include "3journal/journal.h"
@@ -68,11 +70,15 @@ static inline int
 count_flushable_transactions(LocalTxnManager *tm)
 {
   int to_flush = 0;
+  uint64_t snapshot_lsn = tm->oldest_snapshot_lsn();
 
   LocalTxn *oldest = (LocalTxn *)tm->oldest_txn();
   for (; oldest; oldest = (LocalTxn *)oldest->next()) {
     // a transaction can be flushed if it's committed or aborted, and if there
-    // are no cursors coupled to it
+    // are no cursors coupled to it. A transaction which committed after
+    // an active snapshot was taken has to stay in the TxnIndex.
+    if (oldest->is_committed() && oldest->commit_lsn > snapshot_lsn)
+      return to_flush;
     if (oldest->is_committed() || oldest->is_aborted()) {
       for (TxnOperation *op = oldest->oldest_op;
                       op != 0; op = op->next_in_txn)
@@ -92,13 +98,17 @@ flush_committed_txns_impl(LocalTxnManager *tm, Context *context)
 {
   LocalTxn *oldest;
   uint64_t highest_lsn = 0;
+  uint64_t snapshot_lsn = tm->oldest_snapshot_lsn();
+  Journal *journal = tm->lenv()->journal.get();
+  std::vector<int> log_descriptors;
 
   assert(context->changeset.is_empty());
 
   // always get the oldest transaction; if it was committed: flush
-  // it; if it was aborted: discard it; otherwise return
+  // it; if it was aborted: discard it; otherwise return. Committed
+  // transactions which are not part of an active snapshot are not flushed.
   while ((oldest = (LocalTxn *)tm->oldest_txn())) {
-    if (oldest->is_committed()) {
+    if (oldest->is_committed() && oldest->commit_lsn <= snapshot_lsn) {
       uint64_t lsn = tm->flush_txn_to_changeset(context, (LocalTxn *)oldest);
       if (lsn > highest_lsn)
         highest_lsn = lsn;
@@ -109,6 +119,10 @@ flush_committed_txns_impl(LocalTxnManager *tm, Context *context)
     else
       break;
 
+    log_descriptors.insert(log_descriptors.end(),
+                    oldest->log_descriptors.begin(),
+                    oldest->log_descriptors.end());
+
     // now remove the txn from the linked list
     tm->remove_txn_from_head(oldest);
 
@@ -117,11 +131,18 @@ flush_committed_txns_impl(LocalTxnManager *tm, Context *context)
   }
 
   // now flush the changeset and write the modified pages to disk
-  if (highest_lsn && tm->lenv()->journal.get())
+  if (highest_lsn && journal)
     context->changeset.flush(tm->lenv()->lsn_manager.next());
   else
     context->changeset.clear();
   assert(context->changeset.is_empty());
+
+  // the changes of the flushed Txns are now logged in the changeset; their
+  // journal segments can be reused
+  if (journal) {
+    for (size_t i = 0; i < log_descriptors.size(); i++)
+      journal->release_segment(log_descriptors[i]);
+  }
 }
 
 void
@@ -313,11 +334,12 @@ flush_transaction_to_journal(LocalTxn *txn)
   }
 
   if (NOTSET(txn->flags, UPS_TXN_TEMPORARY))
-    journal->append_txn_commit(txn, lenv->lsn_manager.next());
+    journal->append_txn_commit(txn, txn->commit_lsn);
 }
 
 LocalTxn::LocalTxn(LocalEnv *env, const char *name, uint32_t flags)
-  : Txn(env, name, flags), log_descriptor(0), oldest_op(0), newest_op(0)
+  : Txn(env, name, flags), commit_lsn(0), oldest_op(0),
+    newest_op(0)
 {
   LocalTxnManager *ltm = (LocalTxnManager *)env->txn_manager.get();
   id = ltm->incremented_txn_id();
@@ -340,6 +362,7 @@ LocalTxn::commit()
 
   // this transaction is now committed!
   flags |= kStateCommitted;
+  commit_lsn = ((LocalEnv *)env)->lsn_manager.next();
 }
 
 void
@@ -494,7 +517,7 @@ struct KeyCounter : TxnIndex::Visitor {
                     op != 0;
                     op = op->previous_in_node) {
       LocalTxn *optxn = op->txn;
-      if (optxn->is_aborted())
+      if (optxn->is_aborted() || optxn->is_hidden_from(txn))
         continue;
 
       if (optxn->is_committed() || txn == optxn) {
@@ -567,6 +590,8 @@ TxnIndex::count(Context *context, LocalTxn *txn, bool distinct)
 void
 LocalTxnManager::begin(Txn *txn)
 {
+  if (ISSET(txn->flags, UPS_TXN_READ_ONLY))
+    _active_snapshots++;
   append_txn_at_tail(txn);
 }
 
@@ -578,6 +603,8 @@ LocalTxnManager::commit(Txn *htxn)
 
   try {
     txn->commit();
+    if (txn->is_snapshot())
+      _active_snapshots--;
 
     // if this transaction can NOT be flushed immediately then write its
     // operations to the journal; otherwise skip this step
@@ -608,6 +635,8 @@ LocalTxnManager::abort(Txn *htxn)
 
   try {
     txn->abort();
+    if (txn->is_snapshot())
+      _active_snapshots--;
 
     // flush committed transactions
     if (likely(NOTSET(lenv()->flags(), UPS_DONT_FLUSH_TRANSACTIONS))) {
@@ -636,6 +665,24 @@ LocalTxnManager::flush_committed_txns(Context *context /* = 0 */)
     flush_committed_txns_impl(this, context);
 }
 
+uint64_t
+LocalTxnManager::oldest_snapshot_lsn()
+{
+  if (likely(_active_snapshots == 0))
+    return std::numeric_limits<uint64_t>::max();
+
+  // the transactions are sorted by their begin lsn
+  for (LocalTxn *txn = (LocalTxn *)oldest_txn();
+                  txn != 0;
+                  txn = (LocalTxn *)txn->next()) {
+    if (txn->is_snapshot() && !txn->is_committed() && !txn->is_aborted())
+      return txn->lsn;
+  }
+
+  assert(!"shouldn't be here");
+  return std::numeric_limits<uint64_t>::max();
+}
+
 uint64_t
 LocalTxnManager::flush_txn_to_changeset(Context *context, LocalTxn *txn)
 {
@@ -21,6 +21,8 @@
 
 #include "0root/root.h"
 
+#include <vector>
+
 // Always verify that a file of level N does not include headers > N!
 #include "1rb/rb.h"
 #include "4txn/txn.h"
@@ -261,12 +263,34 @@ struct LocalTxn : Txn {
   // (before it's deleted by the Environment).
   void free_operations();
 
-  // index of the log file descriptor for this transaction [0..1]
-  int log_descriptor;
+  // Returns true if this Txn reads from a snapshot (UPS_TXN_READ_ONLY)
+  bool is_snapshot() const {
+    return ISSET(flags, UPS_TXN_READ_ONLY);
+  }
+
+  // Returns true if the operations of this Txn are invisible to |reader|.
+  // This is the case if |reader| reads from a snapshot, and this Txn did
+  // not commit before |reader| began. Such operations are skipped instead
+  // of causing a conflict.
+  bool is_hidden_from(Txn *reader) const {
+    if (likely(reader == 0 || reader == this
+              || !((LocalTxn *)reader)->is_snapshot()))
+      return false;
+    return !is_committed() || commit_lsn > ((LocalTxn *)reader)->lsn;
+  }
+
+  // indices of the journal segments which this transaction was logged to;
+  // a large transaction can span several segments. Empty if it was not
+  // yet logged
+  std::vector<int> log_descriptors;
 
-  // the lsn of the "txn begin" operation
+  // the lsn of the "txn begin" operation; also the snapshot of a read-only
+  // Txn
   uint64_t lsn;
 
+  // the lsn of the "txn commit" operation
+  uint64_t commit_lsn;
+
   // the linked list of operations - head is oldest operation
   TxnOperation *oldest_op;
 
@@ -281,7 +305,7 @@ struct LocalTxn : Txn {
 struct LocalTxnManager : TxnManager {
   // Constructor
   LocalTxnManager(Env *env)
-    : TxnManager(env), _txn_id(0) {
+    : TxnManager(env), _txn_id(0), _active_snapshots(0) {
   }
 
   // Begins a new Txn
@@ -317,8 +341,15 @@ struct LocalTxnManager : TxnManager {
     return (LocalEnv *)env;
   }
 
+  // Returns the lsn of the oldest active snapshot Txn; committed Txns
+  // with a newer commit lsn are not yet flushed to the btree
+  uint64_t oldest_snapshot_lsn();
+
   // The current transaction ID
   uint64_t _txn_id;
+
+  // The number of active snapshot Txns
+  int _active_snapshots;
 };
 
 } // namespace upscaledb
@@ -88,6 +88,17 @@ struct AverageScanVisitor : public NumericalScanVisitor
     uqi_result_add_row(result, "AVERAGE", 8, &avg, sizeof(avg));
   }
 
+  // Partial sums and counters can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the partial sum and the counter of |other|
+  virtual void combine(ScanVisitor *other) {
+    sum += ((AverageScanVisitor *)other)->sum;
+    count += ((AverageScanVisitor *)other)->count;
+  }
+
   // The aggregated sum
   double sum;
 
@@ -164,6 +175,17 @@ struct AverageIfScanVisitor : public NumericalScanVisitor
     uqi_result_add_row(result, "AVERAGE", 8, &avg, sizeof(avg));
   }
 
+  // Partial sums and counters can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the partial sum and the counter of |other|
+  virtual void combine(ScanVisitor *other) {
+    sum += ((AverageIfScanVisitor *)other)->sum;
+    count += ((AverageIfScanVisitor *)other)->count;
+  }
+
   // The aggreated sum
   double sum;
 
@@ -101,6 +101,31 @@ struct BottomScanVisitorBase : public NumericalScanVisitor {
     }
   }
 
+  // Partial bottom lists can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Merges the values of |other| into this visitor's values
+  virtual void combine(ScanVisitor *other) {
+    BottomScanVisitorBase *visitor = (BottomScanVisitorBase *)other;
+
+    if (ISSET(statement->function.flags, UQI_STREAM_KEY)) {
+      for (typename KeyMap::iterator it = visitor->stored_keys.begin();
+                      it != visitor->stored_keys.end(); it++)
+        max_key = store_max_value(it->first, max_key,
+                        it->second.data(), it->second.size(),
+                        stored_keys, statement->limit);
+    }
+    else {
+      for (typename RecordMap::iterator it = visitor->stored_records.begin();
+                      it != visitor->stored_records.end(); it++)
+        max_record = store_max_value(it->first, max_record,
+                        it->second.data(), it->second.size(),
+                        stored_records, statement->limit);
+    }
+  }
+
   // The maximum value currently stored in |keys|
   Key max_key;
 
@@ -60,6 +60,16 @@ struct CountScanVisitor : public ScanVisitor
     uqi_result_add_row(result, "COUNT", 6, &count, sizeof(count));
   }
 
+  // Partial counters can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the counter of |other|
+  virtual void combine(ScanVisitor *other) {
+    count += ((CountScanVisitor *)other)->count;
+  }
+
   // The counter
   uint64_t count;
 };
@@ -84,7 +94,7 @@ struct CountIfScanVisitor : public ScanVisitor
   };
 
   CountIfScanVisitor(const DbConfig *dbconf, SelectStatement *stmt)
-    : count(0), plugin(dbconf, stmt) {
+    : ScanVisitor(stmt), count(0), plugin(dbconf, stmt) {
     key_size = dbconf->key_size;
     record_size = dbconf->record_size;
   }
@@ -120,6 +130,16 @@ struct CountIfScanVisitor : public ScanVisitor
     uqi_result_add_row(result, "COUNT", 6, &count, sizeof(count));
   }
 
+  // Partial counters can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the counter of |other|
+  virtual void combine(ScanVisitor *other) {
+    count += ((CountIfScanVisitor *)other)->count;
+  }
+
   // The counter
   uint64_t count;
 
@@ -60,6 +60,26 @@ struct MinMaxScanVisitorBase : public NumericalScanVisitor
     other.copy((const uint8_t *)data, size);
   }
 
+  // Merges the minimum/maximum of |visitor|; |Compare| is the same
+  // comparator which is used for the scan
+  template<template<typename T> class Compare>
+  void combine_with(MinMaxScanVisitorBase *visitor) {
+    if (ISSET(statement->function.flags, UQI_STREAM_KEY)) {
+      Compare<typename Key::type> cmp;
+      if (cmp(visitor->key.value, key.value)) {
+        key = visitor->key;
+        copy_value(visitor->other.data(), visitor->other.size());
+      }
+    }
+    else {
+      Compare<typename Record::type> cmp;
+      if (cmp(visitor->record.value, record.value)) {
+        record = visitor->record;
+        copy_value(visitor->other.data(), visitor->other.size());
+      }
+    }
+  }
+
   // The current minimum/maximum key
   Key key;
 
@@ -133,6 +153,16 @@ struct MinMaxScanVisitor : public MinMaxScanVisitorBase<Key, Record> {
       }
     }
   }
+
+  // Partial minimums/maximums can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Merges the minimum/maximum of |other|
+  virtual void combine(ScanVisitor *other) {
+    P::template combine_with<Compare>((P *)other);
+  }
 };
 
 template<typename Key, typename Record>
@@ -233,6 +263,16 @@ struct MinMaxIfScanVisitor : public MinMaxScanVisitorBase<Key, Record> {
     }
   }
 
+  // Partial minimums/maximums can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Merges the minimum/maximum of |other|
+  virtual void combine(ScanVisitor *other) {
+    P::template combine_with<Compare>((P *)other);
+  }
+
   PredicatePluginWrapper plugin;
 };
 
@@ -95,6 +95,16 @@ struct AggregatePluginWrapper : PluginWrapperBase
   void assign_result(uqi_result_t *result) {
     plugin->results(state, result);
   }
+
+  // Returns true if partial aggregations can be merged
+  bool supports_combine() const {
+    return plugin->combine != 0;
+  }
+
+  // Merges the partial aggregation of |other| into this state
+  void combine(AggregatePluginWrapper *other) {
+    plugin->combine(state, other->state);
+  }
 };
 
 } // namespace upscaledb
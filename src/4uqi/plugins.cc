@@ -18,6 +18,8 @@
 
 #include "0root/root.h"
 
+#include <string.h>
+#include <stddef.h>
 #include <string>
 #include <map>
 #include <vector>
@@ -128,9 +130,9 @@ PluginManager::import(const char *library, const char *plugin_name)
 ups_status_t
 PluginManager::add(uqi_plugin_t *plugin)
 {
-  if (plugin->plugin_version != 0) {
-    ups_log(("Failed to load plugin %s: invalid version (%d != %d)",
-            plugin->name, 0, plugin->plugin_version));
+  if (plugin->plugin_version > 1) {
+    ups_log(("Failed to load plugin %s: invalid version (%d > %d)",
+            plugin->name, plugin->plugin_version, 1));
     return UPS_PLUGIN_NOT_FOUND;
   }
 
@@ -160,8 +162,14 @@ PluginManager::add(uqi_plugin_t *plugin)
       return UPS_PLUGIN_NOT_FOUND;
   }
 
+  // version 0 descriptors end before the |combine| function
+  uqi_plugin_t copy = {0};
+  ::memcpy(&copy, plugin, plugin->plugin_version == 0
+                            ? offsetof(uqi_plugin_t, combine)
+                            : sizeof(uqi_plugin_t));
+
   ScopedLock lock(mutex);
-  plugins.insert(PluginMap::value_type(plugin->name, *plugin));
+  plugins.insert(PluginMap::value_type(copy.name, copy));
   return 0;
 }
 
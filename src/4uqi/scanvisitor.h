@@ -27,6 +27,7 @@
 #include "4uqi/statements.h"
 
 // Always verify that a file of level N does not include headers > N!
+#include "1base/error.h"
 
 #ifndef UPS_ROOT_H
 #  error "root.h was not included"
@@ -53,6 +54,10 @@ struct ScanVisitor
     : statement(stmt) {
   }
 
+  // Destructor
+  virtual ~ScanVisitor() {
+  }
+
   // Operates on a single key/value pair
   virtual void operator()(const void *key_data, uint16_t key_size, 
                   const void *record_data, uint32_t record_size) = 0;
@@ -64,6 +69,19 @@ struct ScanVisitor
   // Assigns the internal result to |result|
   virtual void assign_result(uqi_result_t *result) = 0;
 
+  // Returns true if the partial results of several visitors can be merged
+  // with |combine()|. Only then a scan can be split across threads.
+  virtual bool supports_combine() const {
+    return false;
+  }
+
+  // Merges the partial result of |other|, which is of the same type and
+  // visited the keys following those of this visitor. Throws
+  // UPS_NOT_IMPLEMENTED unless |supports_combine()| returns true.
+  virtual void combine(ScanVisitor *other) {
+    throw Exception(UPS_NOT_IMPLEMENTED);
+  }
+
   // The select statement
   SelectStatement *statement;
 };
@@ -73,6 +73,16 @@ struct PluginProxyScanVisitor : public ScanVisitor {
     plugin.assign_result(result);
   }
 
+  // Partial results can be merged if the plugin implements |combine|
+  virtual bool supports_combine() const {
+    return plugin.supports_combine();
+  }
+
+  // Merges the partial result of |other|
+  virtual void combine(ScanVisitor *other) {
+    plugin.combine(&((PluginProxyScanVisitor *)other)->plugin);
+  }
+
   // The aggregate plugin
   AggregatePluginWrapper plugin;
 };
@@ -130,6 +140,16 @@ struct PluginProxyIfScanVisitor : public ScanVisitor {
     agg_plugin.assign_result(result);
   }
 
+  // Partial results can be merged if the plugin implements |combine|
+  virtual bool supports_combine() const {
+    return agg_plugin.supports_combine();
+  }
+
+  // Merges the partial result of |other|
+  virtual void combine(ScanVisitor *other) {
+    agg_plugin.combine(&((PluginProxyIfScanVisitor *)other)->agg_plugin);
+  }
+
   // The aggregate plugin
   AggregatePluginWrapper agg_plugin;
 
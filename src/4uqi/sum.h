@@ -82,6 +82,16 @@ struct SumScanVisitor : public NumericalScanVisitor {
     uqi_result_add_row(result, "SUM", 4, &sum, sizeof(sum));
   }
 
+  // Partial sums can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the partial sum of |other|
+  virtual void combine(ScanVisitor *other) {
+    sum += ((SumScanVisitor *)other)->sum;
+  }
+
   // The aggregated sum
   ResultType sum;
 };
@@ -189,6 +199,16 @@ struct SumIfScanVisitor : public NumericalScanVisitor {
     uqi_result_add_row(result, "SUM", 4, &sum, sizeof(sum));
   }
 
+  // Partial sums can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Adds the partial sum of |other|
+  virtual void combine(ScanVisitor *other) {
+    sum += ((SumIfScanVisitor *)other)->sum;
+  }
+
   // The aggreated sum
   ResultType sum;
 
@@ -101,6 +101,31 @@ struct TopScanVisitorBase : public NumericalScanVisitor {
     }
   }
 
+  // Partial top lists can be merged
+  virtual bool supports_combine() const {
+    return true;
+  }
+
+  // Merges the values of |other| into this visitor's values
+  virtual void combine(ScanVisitor *other) {
+    TopScanVisitorBase *visitor = (TopScanVisitorBase *)other;
+
+    if (ISSET(statement->function.flags, UQI_STREAM_KEY)) {
+      for (typename KeyMap::iterator it = visitor->stored_keys.begin();
+                      it != visitor->stored_keys.end(); it++)
+        min_key = store_min_value(it->first, min_key,
+                        it->second.data(), it->second.size(),
+                        stored_keys, statement->limit);
+    }
+    else {
+      for (typename RecordMap::iterator it = visitor->stored_records.begin();
+                      it != visitor->stored_records.end(); it++)
+        min_record = store_min_value(it->first, min_record,
+                        it->second.data(), it->second.size(),
+                        stored_records, statement->limit);
+    }
+  }
+
   // The minimum value currently stored in |keys|
   Key min_key;
 
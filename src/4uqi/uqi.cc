@@ -22,6 +22,7 @@
 
 // Always verify that a file of level N does not include headers > N!
 #include "1base/error.h"
+#include "4db/db.h"
 #include "4env/env.h"
 #include "4uqi/plugins.h"
 #include "4uqi/result.h"
@@ -138,7 +139,18 @@ uqi_select_range(ups_env_t *henv, const char *query, ups_cursor_t *begin,
   }
 
   Env *env = (Env *)henv;
-  ScopedLock lock(env->mutex);
+
+  // queries on an open database which supports concurrent reads only
+  // require the shared locks; otherwise retry with the exclusive lock
+  ScopedReadWriteLock lock(env->mutex, true);
+  ScopedDbLock db_lock;
+  Db *db = env->concurrent_select_db(query);
+  if (!db) {
+    lock.unlock();
+    lock.lock(env->mutex, false);
+  }
+  else if (db->latch())
+    db_lock.lock_latch(db->latch(), ScopedDbLock::kShared);
 
   try {
     return env->select_range(query,
@@ -134,9 +134,9 @@ ups_txn_begin(ups_txn_t **htxn, ups_env_t *henv, const char *name,
   Env *env = (Env *)henv;
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (NOTSET(flags, UPS_DONT_LOCK))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     if (unlikely(NOTSET(env->config.flags, UPS_ENABLE_TRANSACTIONS))) {
       ups_trace(("transactions are disabled (see UPS_ENABLE_TRANSACTIONS)"));
@@ -176,8 +176,18 @@ ups_txn_commit(ups_txn_t *htxn, uint32_t flags)
   Env *env = txn->env;
 
   try {
-    ScopedLock lock(env->mutex);
-    return env->txn_commit(txn, flags);
+    ScopedWriteLock lock(env->mutex);
+    ups_status_t st = env->txn_commit(txn, flags);
+    if (unlikely(st))
+      return st;
+
+    // make the commit durable; concurrent committers share the fsync
+    uint64_t lsn = env->txn_unsynced_lsn();
+    if (lsn) {
+      lock.unlock();
+      env->txn_sync(lsn);
+    }
+    return 0;
   }
   catch (Exception &ex) {
     return ex.code;
@@ -195,7 +205,7 @@ ups_txn_abort(ups_txn_t *htxn, uint32_t flags)
   Txn *txn = (Txn *)htxn;
   Env *env = txn->env;
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->txn_abort(txn, flags);
   }
   catch (Exception &ex) {
@@ -323,6 +333,10 @@ ups_env_create(ups_env_t **henv, const char *filename,
   if (ISSET(flags, UPS_AUTO_RECOVERY))
     flags |= UPS_ENABLE_TRANSACTIONS;
 
+  /* direct I/O bypasses the page cache, which is also used by mmap */
+  if (ISSET(flags, UPS_ENABLE_DIRECT_IO))
+    flags |= UPS_DISABLE_MMAP;
+
   if (param) {
     for (; param->name; param++) {
       switch (param->name) {
@@ -363,6 +377,79 @@ ups_env_create(ups_env_t **henv, const char *filename,
       case UPS_PARAM_JOURNAL_SWITCH_THRESHOLD:
         config.journal_switch_threshold = (uint32_t)param->value;
         break;
+      case UPS_PARAM_JOURNAL_SEGMENTS:
+        config.journal_segments = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        config.journal_segment_size = param->value;
+        break;
+      case UPS_PARAM_JOURNAL_CHECKPOINT_SIZE:
+        config.journal_checkpoint_size = param->value;
+        break;
+      case UPS_PARAM_JOURNAL_DICTIONARY_SIZE:
+        if (param->value > 32 * 1024) {
+          ups_trace(("journal dictionary size must not exceed 32 kb"));
+          return UPS_INV_PARAMETER;
+        }
+        config.journal_dictionary_size = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY:
+        config.journal_group_commit_delay = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE:
+        config.journal_group_commit_size = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_SELECT_THREADS:
+        config.select_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_RECOVERY_THREADS:
+        config.recovery_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_FLUSH_THREADS:
+        if (param->value > 0)
+          config.flush_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CACHE_POLICY:
+        if (param->value != UPS_CACHE_POLICY_LRU
+              && param->value != UPS_CACHE_POLICY_2Q) {
+          ups_trace(("invalid cache policy %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_policy = (int)param->value;
+        break;
+      case UPS_PARAM_READ_AHEAD_PAGES:
+        config.read_ahead_pages = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT:
+        if (param->value > 100) {
+          ups_trace(("invalid percentage %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_internal_nodes_percent = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_SHARED_CACHE_SIZE:
+        config.shared_cache_size_bytes = param->value;
+        break;
+      case UPS_PARAM_SHARED_CACHE_WEIGHT:
+        if (param->value == 0 || param->value > 0xffffffffull) {
+          ups_trace(("invalid shared cache weight %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.shared_cache_weight = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_SIZE:
+        config.compressed_cache_size_bytes = param->value;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR:
+        if ((param->value != UPS_COMPRESSOR_LZF
+                && param->value != UPS_COMPRESSOR_SNAPPY
+                && param->value != UPS_COMPRESSOR_ZLIB)
+              || !CompressorFactory::is_available((int)param->value)) {
+          ups_trace(("unknown algorithm for the compressed cache"));
+          return UPS_INV_PARAMETER;
+        }
+        config.compressed_cache_compressor = (int)param->value;
+        break;
       case UPS_PARAM_LOG_DIRECTORY:
         config.log_filename = (const char *)param->value;
         break;
@@ -486,6 +573,10 @@ ups_env_open(ups_env_t **henv, const char *filename, uint32_t flags,
   if (ISSET(flags, UPS_AUTO_RECOVERY))
     flags |= UPS_ENABLE_TRANSACTIONS;
 
+  /* direct I/O bypasses the page cache, which is also used by mmap */
+  if (ISSET(flags, UPS_ENABLE_DIRECT_IO))
+    flags |= UPS_DISABLE_MMAP;
+
   if (unlikely(config.filename.empty() && NOTSET(flags, UPS_IN_MEMORY))) {
     ups_trace(("filename is missing"));
     return UPS_INV_PARAMETER;
@@ -515,6 +606,79 @@ ups_env_open(ups_env_t **henv, const char *filename, uint32_t flags,
       case UPS_PARAM_JOURNAL_SWITCH_THRESHOLD:
         config.journal_switch_threshold = (uint32_t)param->value;
         break;
+      case UPS_PARAM_JOURNAL_SEGMENTS:
+        config.journal_segments = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_SEGMENT_SIZE:
+        config.journal_segment_size = param->value;
+        break;
+      case UPS_PARAM_JOURNAL_CHECKPOINT_SIZE:
+        config.journal_checkpoint_size = param->value;
+        break;
+      case UPS_PARAM_JOURNAL_DICTIONARY_SIZE:
+        if (param->value > 32 * 1024) {
+          ups_trace(("journal dictionary size must not exceed 32 kb"));
+          return UPS_INV_PARAMETER;
+        }
+        config.journal_dictionary_size = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY:
+        config.journal_group_commit_delay = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE:
+        config.journal_group_commit_size = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_SELECT_THREADS:
+        config.select_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_RECOVERY_THREADS:
+        config.recovery_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_FLUSH_THREADS:
+        if (param->value > 0)
+          config.flush_threads = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CACHE_POLICY:
+        if (param->value != UPS_CACHE_POLICY_LRU
+              && param->value != UPS_CACHE_POLICY_2Q) {
+          ups_trace(("invalid cache policy %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_policy = (int)param->value;
+        break;
+      case UPS_PARAM_READ_AHEAD_PAGES:
+        config.read_ahead_pages = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT:
+        if (param->value > 100) {
+          ups_trace(("invalid percentage %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.cache_internal_nodes_percent = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_SHARED_CACHE_SIZE:
+        config.shared_cache_size_bytes = param->value;
+        break;
+      case UPS_PARAM_SHARED_CACHE_WEIGHT:
+        if (param->value == 0 || param->value > 0xffffffffull) {
+          ups_trace(("invalid shared cache weight %d", (int)param->value));
+          return UPS_INV_PARAMETER;
+        }
+        config.shared_cache_weight = (uint32_t)param->value;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_SIZE:
+        config.compressed_cache_size_bytes = param->value;
+        break;
+      case UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR:
+        if ((param->value != UPS_COMPRESSOR_LZF
+                && param->value != UPS_COMPRESSOR_SNAPPY
+                && param->value != UPS_COMPRESSOR_ZLIB)
+              || !CompressorFactory::is_available((int)param->value)) {
+          ups_trace(("unknown algorithm for the compressed cache"));
+          return UPS_INV_PARAMETER;
+        }
+        config.compressed_cache_compressor = (int)param->value;
+        break;
       case UPS_PARAM_LOG_DIRECTORY:
         config.log_filename = (const char *)param->value;
         break;
@@ -608,7 +772,7 @@ ups_env_create_db(ups_env_t *henv, ups_db_t **hdb, uint16_t db_name,
   config.flags = flags;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
 
     if (unlikely(ISSET(env->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot create database in a read-only environment"));
@@ -650,7 +814,7 @@ ups_env_open_db(ups_env_t *henv, ups_db_t **hdb, uint16_t db_name,
   config.db_name = db_name;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
 
     if (unlikely(ISSET(env->flags(), UPS_IN_MEMORY))) {
       ups_trace(("cannot open a Database in an In-Memory Environment"));
@@ -694,7 +858,7 @@ ups_env_rename_db(ups_env_t *henv, uint16_t oldname, uint16_t newname,
 
   /* rename the database */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->rename_db(oldname, newname, flags);
   }
   catch (Exception &ex) {
@@ -717,7 +881,7 @@ ups_env_erase_db(ups_env_t *henv, uint16_t name, uint32_t flags)
 
   /* erase the database */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->erase_db(name, flags);
   }
   catch (Exception &ex) {
@@ -744,7 +908,7 @@ ups_env_get_database_names(ups_env_t *henv, uint16_t *names, uint32_t *length)
 
   /* get all database names */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
 
     std::vector<uint16_t> vec = env->get_database_names();
     if (unlikely(vec.size() > *length)) {
@@ -779,7 +943,7 @@ ups_env_get_parameters(ups_env_t *henv, ups_parameter_t *param)
 
   /* get the parameters */
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->get_parameters(param);
   }
   catch (Exception &ex) {
@@ -801,7 +965,7 @@ ups_env_flush(ups_env_t *henv, uint32_t flags)
   }
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedWriteLock lock(env->mutex);
     return env->flush(flags);
   }
   catch (Exception &ex) {
@@ -849,7 +1013,7 @@ ups_db_get_parameters(ups_db_t *hdb, ups_parameter_t *param)
 
   /* get the parameters */
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
     return db->get_parameters(param);
   }
   catch (Exception &ex) {
@@ -884,7 +1048,7 @@ ups_db_set_compare_func(ups_db_t *hdb, ups_compare_func_t foo)
     return UPS_INV_PARAMETER; 
   }
 
-  ScopedLock lock(ldb->env->mutex);
+  ScopedWriteLock lock(ldb->env->mutex);
 
   if (unlikely(db->config.key_type != UPS_TYPE_CUSTOM)) {
     ups_trace(("ups_set_compare_func only allowed for UPS_TYPE_CUSTOM "
@@ -919,11 +1083,9 @@ ups_db_find(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
   if (unlikely(!prepare_key(key) || !prepare_record(record)))
     return UPS_INV_PARAMETER;
 
-  Env *env = db->env;
-
   try {
-    ScopedLock lock(env->mutex);
-  
+    ScopedDbLock lock(db, !txn);
+
     if (unlikely(ISSETANY(db->flags(),
                             UPS_RECORD_NUMBER32 | UPS_RECORD_NUMBER64)
           && !key->data)) {
@@ -980,17 +1142,19 @@ ups_db_insert(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
   if (unlikely(!prepare_key(key) || !prepare_record(record)))
     return UPS_INV_PARAMETER;
 
-  Env *env = db->env;
-
   try {
-    ScopedLock lock;
+    ScopedDbLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock_for_update(db);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot insert in a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(txn && ISSET(txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot insert in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
     if (unlikely(ISSET(flags, UPS_DUPLICATE)
         && NOTSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS))) {
       ups_trace(("database does not support duplicate keys "
@@ -1005,7 +1169,16 @@ ups_db_insert(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key,
 
     flags &= ~UPS_DONT_LOCK;
 
-    return db->insert(0, txn, key, record, flags);
+    ups_status_t st = db->insert(0, txn, key, record, flags,
+                    lock.is_optimistic());
+
+    // an optimistic insert has to split a page; repeat it with the
+    // exclusive latch
+    if (unlikely(st == UPS_WOULD_BLOCK && lock.is_optimistic())) {
+      lock.upgrade();
+      st = db->insert(0, txn, key, record, flags, false);
+    }
+    return st;
   }
   catch (Exception &ex) {
     return ex.code;
@@ -1029,21 +1202,31 @@ ups_db_erase(ups_db_t *hdb, ups_txn_t *htxn, ups_key_t *key, uint32_t flags)
   if (unlikely(!prepare_key(key)))
     return UPS_INV_PARAMETER;
 
-  Env *env = db->env;
-
   try {
-    ScopedLock lock;
+    ScopedDbLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock_for_update(db);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot erase from a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(txn && ISSET(txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot erase in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
     flags &= ~UPS_DONT_LOCK;
 
-    return db->erase(0, txn, key, flags);
+    ups_status_t st = db->erase(0, txn, key, flags, lock.is_optimistic());
+
+    // an optimistic erase has to merge a page; repeat it with the
+    // exclusive latch
+    if (unlikely(st == UPS_WOULD_BLOCK && lock.is_optimistic())) {
+      lock.upgrade();
+      st = db->erase(0, txn, key, flags, false);
+    }
+    return st;
   }
   catch (Exception &ex) {
     return ex.code;
@@ -1065,7 +1248,7 @@ ups_db_check_integrity(ups_db_t *hdb, uint32_t flags)
   }
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
     return db->check_integrity(flags);
   }
   catch (Exception &ex) {
@@ -1098,9 +1281,9 @@ ups_db_close(ups_db_t *hdb, uint32_t flags)
   }
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     // auto-cleanup cursors?
     if (ISSET(flags, UPS_AUTO_CLEANUP)) {
@@ -1145,9 +1328,9 @@ ups_cursor_create(ups_cursor_t **hcursor, ups_db_t *hdb, ups_txn_t *htxn,
   Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedWriteLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock = ScopedWriteLock(env->mutex);
 
     *cursor = db->cursor_create(txn, flags);
     db->add_cursor(*cursor);
@@ -1178,7 +1361,7 @@ ups_cursor_clone(ups_cursor_t *hsrc, ups_cursor_t **hdest)
   Db *db = src->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
 
     *dest = db->cursor_clone(src);
     (*dest)->previous = 0;
@@ -1217,12 +1400,17 @@ ups_cursor_overwrite(ups_cursor_t *hcursor, ups_record_t *record,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot overwrite in a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(cursor->txn
+            && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot overwrite in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
     return cursor->overwrite(record, flags);
   }
@@ -1253,10 +1441,9 @@ ups_cursor_move(ups_cursor_t *hcursor, ups_key_t *key,
     return UPS_INV_PARAMETER;
 
   Db *db = cursor->db;
-  Env *env = db->env;
 
   try {
-    ScopedLock lock(env->mutex);
+    ScopedDbLock lock(db, !cursor->txn);
     return db->cursor_move(cursor, key, record, flags);
   }
   catch (Exception &ex) {
@@ -1284,12 +1471,11 @@ ups_cursor_find(ups_cursor_t *hcursor, ups_key_t *key, ups_record_t *record,
     return UPS_INV_PARAMETER;
 
   Db *db = cursor->db;
-  Env *env = db->env;
 
   try {
-    ScopedLock lock;
+    ScopedDbLock lock;
     if (likely(NOTSET(flags, UPS_DONT_LOCK)))
-      lock = ScopedLock(env->mutex);
+      lock.lock(db, !cursor->txn);
 
     flags &= ~UPS_DONT_LOCK;
 
@@ -1328,12 +1514,17 @@ ups_cursor_insert(ups_cursor_t *hcursor, ups_key_t *key, ups_record_t *record,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
 
     if (unlikely(ISSET(db->flags(), UPS_READ_ONLY))) {
       ups_trace(("cannot insert to a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (unlikely(cursor->txn
+            && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY))) {
+      ups_trace(("cannot insert in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
     if (unlikely(ISSET(flags, UPS_DUPLICATE)
         && NOTSET(db->flags(), UPS_ENABLE_DUPLICATE_KEYS))) {
       ups_trace(("database does not support duplicate keys "
@@ -1356,7 +1547,7 @@ ups_cursor_insert(ups_cursor_t *hcursor, ups_key_t *key, ups_record_t *record,
 
     flags &= ~UPS_DONT_LOCK;
 
-    return db->insert(cursor, cursor->txn, key, record, flags);
+    return db->insert(cursor, cursor->txn, key, record, flags, false);
   }
   catch (Exception &ex) {
     return ex.code;
@@ -1376,14 +1567,18 @@ ups_cursor_erase(ups_cursor_t *hcursor, uint32_t flags)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
 
     if (ISSET(db->flags(), UPS_READ_ONLY)) {
       ups_trace(("cannot erase from a read-only database"));
       return UPS_WRITE_PROTECTED;
     }
+    if (cursor->txn && ISSET(cursor->txn->flags, UPS_TXN_READ_ONLY)) {
+      ups_trace(("cannot erase in a read-only transaction"));
+      return UPS_WRITE_PROTECTED;
+    }
 
-    return db->erase(cursor, cursor->txn, 0, flags);
+    return db->erase(cursor, cursor->txn, 0, flags, false);
   }
   catch (Exception &ex) {
     return ex.code;
@@ -1408,7 +1603,7 @@ ups_cursor_get_duplicate_count(ups_cursor_t *hcursor, uint32_t *count,
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
     *count = cursor->get_duplicate_count(flags);
     return 0;
   }
@@ -1435,7 +1630,7 @@ ups_cursor_get_duplicate_position(ups_cursor_t *hcursor, uint32_t *position)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
     *position = cursor->get_duplicate_position();
     return 0;
   }
@@ -1462,7 +1657,7 @@ ups_cursor_get_record_size(ups_cursor_t *hcursor, uint32_t *size)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, false);
     *size = cursor->get_record_size();
     return 0;
   }
@@ -1485,7 +1680,7 @@ ups_cursor_close(ups_cursor_t *hcursor)
   Db *db = cursor->db;
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedWriteLock lock(db->env->mutex);
     cursor->close();
     if (cursor->txn)
       cursor->txn->release();
@@ -1505,7 +1700,7 @@ ups_set_context_data(ups_db_t *hdb, void *data)
   if (unlikely(!db))
     return;
 
-  ScopedLock lock(db->env->mutex);
+  ScopedWriteLock lock(db->env->mutex);
   db->context = data;
 }
 
@@ -1519,7 +1714,7 @@ ups_get_context_data(ups_db_t *hdb, ups_bool_t dont_lock)
   if (dont_lock)
     return db->context;
 
-  ScopedLock lock(db->env->mutex);
+  ScopedWriteLock lock(db->env->mutex);
   return db->context;
 }
 
@@ -1580,7 +1775,7 @@ ups_db_count(ups_db_t *hdb, ups_txn_t *htxn, uint32_t flags,
   }
 
   try {
-    ScopedLock lock(db->env->mutex);
+    ScopedDbLock lock(db, !txn);
 
     *count = db->count(txn, ISSET(flags, UPS_SKIP_DUPLICATES));
     return 0;
@@ -1701,7 +1896,7 @@ ups_db_bulk_operations(ups_db_t *hdb, ups_txn_t *txn,
 
   Db *db = (Db *)hdb;
   try {
-    ScopedLock lock = ScopedLock(db->env->mutex);
+    ScopedDbLock lock(db, false);
     return db->bulk_operations((Txn *)txn, operations,
                     operations_length, flags);
   }
@@ -93,7 +93,8 @@ struct Configuration
       journal_compression(0), record_compression(0), key_compression(0),
       read_only(false), enable_crc32(false), record_number32(false),
       record_number64(false), posix_fadvice(UPS_POSIX_FADVICE_NORMAL),
-      simulate_crashes(false), flush_txn_immediately(false) {
+      simulate_crashes(false), flush_txn_immediately(false),
+      read_scaling(false), cache_policy(UPS_CACHE_POLICY_LRU) {
   }
 
   const char *
@@ -203,6 +204,12 @@ struct Configuration
       std::cout << "--record-number32 ";
     if (record_number64)
       std::cout << "--record-number64 ";
+    if (cache_policy)
+      std::cout << "--cache-policy="
+                << (cache_policy == UPS_CACHE_POLICY_2Q
+                               ? "2q"
+                               : "??unknown??")
+                << " ";
     if (posix_fadvice)
       std::cout << "--posix-fadvice="
                 << (posix_fadvice == UPS_POSIX_FADVICE_RANDOM
@@ -212,7 +219,9 @@ struct Configuration
     if (simulate_crashes)
       std::cout << "--simulate-crashes ";
     if (flush_txn_immediately)
-      std::cout << "--flush-txn-immediately";
+      std::cout << "--flush-txn-immediately ";
+    if (read_scaling)
+      std::cout << "--read-scaling ";
     if (!filename.empty())
       std::cout << filename;
     else {
@@ -312,6 +321,8 @@ struct Configuration
   int posix_fadvice;
   bool simulate_crashes;
   bool flush_txn_immediately;
+  bool read_scaling;
+  int cache_policy;
 };
 
 #endif /* UPS_BENCH_CONFIGURATION_H */
@@ -19,6 +19,8 @@
 #include <iostream>
 #include <cstdio>
 #include <ctime>
+#include <vector>
+#include <algorithm>
 
 #include <ups/upscaledb_int.h>
 
@@ -91,6 +93,8 @@
 #define ARG_POSIX_FADVICE                       71
 #define ARG_SIMULATE_CRASHES                    72
 #define ARG_FLUSH_TXN_IMMEDIATELY               73
+#define ARG_READ_SCALING                        74
+#define ARG_CACHE_POLICY                        75
 
 /*
  * command line parameters
@@ -262,6 +266,12 @@ static option_t opts[] = {
     "cache",
     "Sets the cachesize (use 0 for default) or 'unlimited'",
     GETOPTS_NEED_ARGUMENT },
+  {
+    ARG_CACHE_POLICY,
+    0,
+    "cache-policy",
+    "Sets the cache replacement policy: 'lru' (default), '2q'",
+    GETOPTS_NEED_ARGUMENT },
   {
     ARG_USE_TRANSACTIONS,
     0,
@@ -427,6 +437,13 @@ static option_t opts[] = {
     "flush-txn-immediately",
     "Immediately flushes transactions after they are committed",
     0 },
+  {
+    ARG_READ_SCALING,
+    0,
+    "read-scaling",
+    "Runs concurrent lookups on a shared database with 1..num-threads "
+        "threads and reports the throughput",
+    0 },
   {0, 0}
 };
 
@@ -620,6 +637,16 @@ parse_config(int argc, char **argv, Configuration *c)
       else
         c->cachesize = strtoul(param, 0, 0);
     }
+    else if (opt == ARG_CACHE_POLICY) {
+      if (!strcmp(param, "lru"))
+        c->cache_policy = UPS_CACHE_POLICY_LRU;
+      else if (!strcmp(param, "2q"))
+        c->cache_policy = UPS_CACHE_POLICY_2Q;
+      else {
+        printf("[FAIL] invalid parameter for 'cache-policy'\n");
+        exit(-1);
+      }
+    }
     else if (opt == ARG_USE_FSYNC) {
       c->use_fsync = true;
     }
@@ -821,6 +848,9 @@ parse_config(int argc, char **argv, Configuration *c)
     else if (opt == ARG_FLUSH_TXN_IMMEDIATELY) {
       c->flush_txn_immediately = true;
     }
+    else if (opt == ARG_READ_SCALING) {
+      c->read_scaling = true;
+    }
     else if (opt == ARG_READ_ONLY) {
       c->read_only = true;
     }
@@ -948,6 +978,16 @@ print_metrics(Metrics *metrics, Configuration *conf)
           (long unsigned int)metrics->upscaledb_metrics.mem_current_usage);
   printf("\tupscaledb mem_peak_usage              %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.mem_peak_usage);
+  printf("\tupscaledb mem_page_pool_slabs         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.mem_page_pool_slabs);
+  printf("\tupscaledb mem_page_pool_bytes         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.mem_page_pool_bytes);
+  printf("\tupscaledb mem_page_pool_current       %lu\n",
+          (long unsigned int)
+              metrics->upscaledb_metrics.mem_page_pool_current_allocations);
+  printf("\tupscaledb mem_page_pool_total         %lu\n",
+          (long unsigned int)
+              metrics->upscaledb_metrics.mem_page_pool_total_allocations);
   printf("\tupscaledb page_count_fetched          %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.page_count_fetched);
   printf("\tupscaledb page_count_flushed          %lu\n",
@@ -980,6 +1020,71 @@ print_metrics(Metrics *metrics, Configuration *conf)
           (long unsigned int)metrics->upscaledb_metrics.extended_duptables);
   printf("\tupscaledb journal_bytes_flushed       %lu\n",
           (long unsigned int)metrics->upscaledb_metrics.journal_bytes_flushed);
+  printf("\tupscaledb journal_commits             %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_commits);
+  printf("\tupscaledb journal_fsyncs              %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_fsyncs);
+  printf("\tupscaledb journal_page_images         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_page_images);
+  printf("\tupscaledb journal_page_deltas         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_page_deltas);
+  printf("\tupscaledb journal_checkpoints         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_checkpoints);
+  printf("\tupscaledb journal_checkpoint_lsn_lag  %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.journal_checkpoint_lsn_lag);
+  printf("\tupscaledb cache_policy                %s\n",
+          metrics->upscaledb_metrics.cache_policy == UPS_CACHE_POLICY_2Q
+              ? "2q"
+              : "lru");
+  printf("\tupscaledb cache_hits_protected        %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_hits_protected);
+  printf("\tupscaledb cache_promotions            %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_promotions);
+  printf("\tupscaledb cache_demotions             %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_demotions);
+  printf("\tupscaledb cache_buckets               %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_buckets);
+  printf("\tupscaledb cache_buckets_used          %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_buckets_used);
+  printf("\tupscaledb cache_max_chain_length      %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_max_chain_length);
+  printf("\tupscaledb cache_resizes               %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_resizes);
+  printf("\tupscaledb page_count_read_ahead       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.page_count_read_ahead);
+  printf("\tupscaledb cache_hits_read_ahead       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_hits_read_ahead);
+  printf("\tupscaledb cache_hits_internal         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_hits_internal);
+  printf("\tupscaledb cache_misses_internal       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_misses_internal);
+  printf("\tupscaledb cache_internal_nodes        %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.cache_internal_nodes);
+  printf("\tupscaledb shared_cache_capacity      %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.shared_cache_capacity);
+  printf("\tupscaledb shared_cache_used_bytes    %lu\n",
+          (long unsigned int)
+              metrics->upscaledb_metrics.shared_cache_used_bytes);
+  printf("\tupscaledb shared_cache_share         %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.shared_cache_share);
+  printf("\tupscaledb shared_cache_shrinks       %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.shared_cache_shrinks);
+  printf("\tupscaledb compressed_cache_hits      %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.compressed_cache_hits);
+  printf("\tupscaledb compressed_cache_misses    %lu\n",
+          (long unsigned int)
+              metrics->upscaledb_metrics.compressed_cache_misses);
+  printf("\tupscaledb compressed_cache_rejected  %lu\n",
+          (long unsigned int)
+              metrics->upscaledb_metrics.compressed_cache_rejected);
+  printf("\tupscaledb compressed_cache_pages     %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.compressed_cache_pages);
+  printf("\tupscaledb compressed_cache_bytes     %lu\n",
+          (long unsigned int)metrics->upscaledb_metrics.compressed_cache_bytes);
+  if (metrics->upscaledb_metrics.compressed_cache_bytes > 0)
+    printf("\tupscaledb compressed_cache_ratio     %.2f\n",
+          (double)metrics->upscaledb_metrics.compressed_cache_uncompressed_bytes
+              / metrics->upscaledb_metrics.compressed_cache_bytes);
 }
 
 struct Callable {
@@ -1109,6 +1214,115 @@ run_single_test(Configuration *conf)
   return (ok);
 }
 
+struct ReadScalingCallable {
+  ReadScalingCallable(ups_db_t *db_, uint64_t num_keys_, uint64_t ops_,
+                  unsigned seed_)
+    : db(db_), num_keys(num_keys_), ops(ops_), seed(seed_), failed(0) {
+  }
+
+  void operator()() {
+    for (uint64_t i = 0; i < ops; i++) {
+      // a simple LCG is good enough to spread the lookups
+      seed = seed * 1103515245 + 12345;
+      uint64_t k = seed % num_keys;
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      if (ups_db_find(db, 0, &key, &record, 0) != 0)
+        failed++;
+    }
+  }
+
+  ups_db_t *db;
+  uint64_t num_keys;
+  uint64_t ops;
+  unsigned seed;
+  uint64_t failed;
+};
+
+// Fills a single database, then looks up random keys with 1, 2, 4 ...
+// |num_threads| threads. All threads share the same database; the lookups
+// only require a shared lock and should therefore scale with the number
+// of cores.
+static bool
+run_read_scaling_test(Configuration *conf)
+{
+  ups_env_t *env;
+  ups_db_t *db;
+  ups_parameter_t env_params[] = {
+    {UPS_PARAM_CACHE_SIZE, (uint64_t)conf->cachesize},
+    {UPS_PARAM_PAGE_SIZE, (uint64_t)conf->pagesize},
+    {0, 0}
+  };
+  ups_parameter_t db_params[] = {
+    {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT64},
+    {UPS_PARAM_RECORD_SIZE, (uint64_t)conf->rec_size},
+    {0, 0}
+  };
+  uint32_t flags = 0;
+  flags |= conf->inmemory ? UPS_IN_MEMORY : 0;
+  flags |= conf->no_mmap ? UPS_DISABLE_MMAP : 0;
+  flags |= conf->cacheunlimited ? UPS_CACHE_UNLIMITED : 0;
+
+  boost::filesystem::remove("test-ham.db");
+  ups_status_t st = ups_env_create(&env, "test-ham.db", flags, 0664,
+                  &env_params[0]);
+  if (st == 0)
+    st = ups_env_create_db(env, &db, 1, 0, &db_params[0]);
+  if (st) {
+    LOG_ERROR(("failed to create the database: %d (%s)\n",
+                            st, ups_strerror(st)));
+    return (false);
+  }
+
+  uint64_t num_keys = conf->limit_ops;
+  std::vector<uint8_t> buffer(conf->rec_size);
+  for (uint64_t k = 0; k < num_keys; k++) {
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = ups_make_record(buffer.data(),
+                    (uint32_t)conf->rec_size);
+    st = ups_db_insert(db, 0, &key, &record, 0);
+    if (st) {
+      LOG_ERROR(("ups_db_insert failed: %d (%s)\n", st, ups_strerror(st)));
+      return (false);
+    }
+  }
+
+  bool ok = true;
+  printf("\n[OK] read scaling, %lu keys\n", (unsigned long)num_keys);
+  for (int n = 1; ; n = std::min(n * 2, conf->num_threads)) {
+    std::vector<boost::thread *> threads;
+    std::vector<ReadScalingCallable *> callables;
+
+    Timer<boost::chrono::high_resolution_clock> t;
+    for (int i = 0; i < n; i++) {
+      callables.push_back(new ReadScalingCallable(db, num_keys, num_keys,
+                              conf->seed + i));
+      threads.push_back(new boost::thread(boost::ref(*callables.back())));
+    }
+
+    uint64_t failed = 0;
+    for (int i = 0; i < n; i++) {
+      threads[i]->join();
+      failed += callables[i]->failed;
+      delete threads[i];
+      delete callables[i];
+    }
+    double seconds = t.seconds();
+    printf("\tthreads %3d: elapsed time (sec) %f, lookups/sec %f\n", n,
+                seconds, (double)(n * num_keys) / seconds);
+    if (failed) {
+      LOG_ERROR(("%lu lookups failed\n", (unsigned long)failed));
+      ok = false;
+    }
+
+    if (n >= conf->num_threads)
+      break;
+  }
+
+  ups_env_close(env, UPS_AUTO_CLEANUP);
+  return (ok);
+}
+
 #ifdef UPS_WITH_BERKELEYDB
 static bool
 are_keys_equal(ups_key_t *key1, ups_key_t *key2)
@@ -1443,7 +1657,14 @@ main(int argc, char **argv)
 
   // if berkeleydb is disabled, and upscaledb runs in only one thread:
   // just execute the test single-threaded
-  if (c.use_upscaledb && !c.use_berkeleydb) {
+  if (c.read_scaling) {
+    if (!c.limit_ops) {
+      printf("[FAIL] '--read-scaling' only supported with --stop-ops\n");
+      return (1);
+    }
+    ok = run_read_scaling_test(&c);
+  }
+  else if (c.use_upscaledb && !c.use_berkeleydb) {
     if (c.filename.empty())
       ok = run_single_test<UpscaleDatabase, RuntimeGenerator>(&c);
     else
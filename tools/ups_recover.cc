@@ -20,12 +20,15 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <chrono>
+
 #include <ups/upscaledb.h>
 
 #include "getopts.h"
 #include "common.h"
 
 #define ARG_HELP      1
+#define ARG_THREADS   2
 
 /*
  * command line parameters
@@ -37,6 +40,12 @@ static option_t opts[] = {
     "help",         // long option
     "this help screen",   // help string
     0 },          // no flags
+  {
+    ARG_THREADS,
+    "t",
+    "threads",
+    "number of recovery threads (default: one per core)",
+    GETOPTS_NEED_ARGUMENT },
   { 0, 0, 0, 0, 0 } /* terminating element */
 };
 
@@ -50,6 +59,11 @@ int
 main(int argc, char **argv) {
   unsigned opt;
   const char *param, *filename = 0;
+  char *endptr = 0;
+  ups_parameter_t params[] = {
+    { UPS_PARAM_RECOVERY_THREADS, 0 },
+    { 0, 0 }
+  };
 
   ups_status_t st;
   ups_env_t *env;
@@ -66,12 +80,20 @@ main(int argc, char **argv) {
         }
         filename = param;
         break;
+      case ARG_THREADS:
+        params[0].value = strtoul(param, &endptr, 0);
+        if (endptr && *endptr) {
+          printf("Invalid parameter `threads'; numerical value expected.\n");
+          return (-1);
+        }
+        break;
       case ARG_HELP:
         print_banner("ups_recover");
 
-        printf("usage: ups_recover file\n");
+        printf("usage: ups_recover [-t threads] file\n");
         printf("usage: ups_recover -h\n");
         printf("     -h:     this help screen (alias: --help)\n");
+        printf("     -t num: number of recovery threads (alias: --threads)\n");
         return (0);
       default:
         printf("Invalid or unknown parameter `%s'. "
@@ -99,11 +121,17 @@ main(int argc, char **argv) {
     error("ups_env_open", st);
 
   /* now start the recovery */
+  std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
   st = ups_env_open(&env, filename,
-        UPS_AUTO_RECOVERY | UPS_ENABLE_TRANSACTIONS, 0);
+        UPS_AUTO_RECOVERY | UPS_ENABLE_TRANSACTIONS, &params[0]);
   if (st)
     error("ups_env_open", st);
 
+  double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  printf("File `%s' was recovered in %.3f seconds\n", filename, seconds);
+
   /* we're already done */
   st = ups_env_close(env, 0);
   if (st != UPS_SUCCESS)
@@ -25,8 +25,8 @@
 namespace upscaledb {
 
 struct ChangesetProxy {
-  ChangesetProxy(LocalEnv *env)
-    : changeset(env) {
+  ChangesetProxy(LocalEnv *env, bool read_only = false)
+    : changeset(env, read_only) {
   }
 
   ~ChangesetProxy() {
@@ -116,6 +116,34 @@ struct ChangesetFixture : BaseFixture {
       .require_get(pages[1].page->address(), nullptr)
       .require_get(pages[2].page->address(), nullptr);
   }
+
+  void pinPages() {
+    PageProxy pages[2]; // allocate this first, otherwise ~ChangesetProxy fails
+    ChangesetProxy ch(lenv(), true);
+
+    for (int i = 0; i < 2; i++) {
+      pages[i].allocate(lenv())
+              .set_address(1024 * (i + 1));
+      ch.put(pages[i]);
+    }
+    // pages can be pinned more than once
+    ch.put(pages[0]);
+
+    for (int i = 0; i < 2; i++) {
+      REQUIRE(pages[i].page->is_pinned() == true);
+      // the pages are not locked
+      REQUIRE(pages[i].page->mutex().try_lock() == true);
+      pages[i].page->mutex().unlock();
+    }
+
+    ch.require_empty(false)
+      .require_get(pages[0].page->address(), nullptr)
+      .clear()
+      .require_empty(true);
+
+    for (int i = 0; i < 2; i++)
+      REQUIRE(pages[i].page->is_pinned() == false);
+  }
 };
 
 TEST_CASE("Changeset/addPages")
@@ -136,5 +164,11 @@ TEST_CASE("Changeset/clear")
   f.clear();
 }
 
+TEST_CASE("Changeset/pinPages")
+{
+  ChangesetFixture f;
+  f.pinPages();
+}
+
 } // namespace upscaledb
 
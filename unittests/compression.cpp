@@ -134,6 +134,116 @@ TEST_CASE("Compression/LzfJournal", "")
   complex_journal_test(UPS_COMPRESSOR_LZF);
 }
 
+TEST_CASE("Compression/zlibDictionary", "")
+{
+  ScopedPtr<Compressor> c;
+
+#ifdef HAVE_ZLIB_H
+  c.reset(CompressorFactory::create(UPS_COMPRESSOR_ZLIB));
+  REQUIRE(c->supports_dictionary() == true);
+
+  const char *dict = "{\"name\": \"customer 1\", \"city\": \"Berlin\", "
+                     "\"active\": true}";
+  const char *data = "{\"name\": \"customer 2\", \"city\": \"Berlin\", "
+                     "\"active\": false}";
+  uint32_t size = (uint32_t)::strlen(data) + 1;
+  uint32_t dict_size = (uint32_t)::strlen(dict);
+
+  // the dictionary contains most of the data
+  uint32_t plain = c->compress((uint8_t *)data, size);
+  uint32_t len = c->compress_with_dictionary((uint8_t *)data, size,
+                  (uint8_t *)dict, dict_size);
+  REQUIRE(len < plain / 2);
+
+  ByteArray tmp; // create a copy of the compressed data
+  tmp.append(c->arena.data(), len);
+  ByteArray out;
+  c->decompress_with_dictionary(tmp.data(), len, size, (uint8_t *)dict,
+                  dict_size, &out);
+  REQUIRE(0 == ::strcmp(data, (const char *)out.data()));
+#endif
+
+  c.reset(CompressorFactory::create(UPS_COMPRESSOR_LZF));
+  REQUIRE(c->supports_dictionary() == false);
+}
+
+// Inserts and erases small records, then recovers them. Returns the
+// compressed size of the journal's keys and records
+static uint64_t
+dictionary_journal_test(uint32_t dictionary_size)
+{
+  ups_parameter_t p[] = {
+      { UPS_PARAM_JOURNAL_COMPRESSION, UPS_COMPRESSOR_ZLIB },
+      { UPS_PARAM_JOURNAL_DICTIONARY_SIZE, dictionary_size },
+      { 0, 0 }
+  };
+
+  BaseFixture f;
+  f.require_create(UPS_DONT_FLUSH_TRANSACTIONS | UPS_ENABLE_TRANSACTIONS, p);
+  f.require_parameter(UPS_PARAM_JOURNAL_DICTIONARY_SIZE, dictionary_size);
+
+  const int count = 500;
+  char kbuf[32];
+  char rbuf[256];
+  for (int i = 0; i < count; i++) {
+    ::sprintf(kbuf, "customer-%05d", i);
+    ::sprintf(rbuf, "{\"id\": %d, \"name\": \"customer %d\", \"email\": "
+                    "\"customer%d@example.com\", \"city\": \"Berlin\", "
+                    "\"active\": true}", i, i, i);
+    ups_key_t key = ups_make_key(kbuf, (uint16_t)(::strlen(kbuf) + 1));
+    ups_record_t rec = ups_make_record(rbuf, (uint32_t)(::strlen(rbuf) + 1));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &rec, 0));
+  }
+  for (int i = 0; i < count; i += 10) {
+    ::sprintf(kbuf, "customer-%05d", i);
+    ups_key_t key = ups_make_key(kbuf, (uint16_t)(::strlen(kbuf) + 1));
+    REQUIRE(0 == ups_db_erase(f.db, 0, &key, 0));
+  }
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  uint64_t compressed = metrics.journal_bytes_after_compression;
+
+  // reopen, perform recovery
+  f.close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG)
+   .require_open(UPS_ENABLE_TRANSACTIONS | UPS_AUTO_RECOVERY);
+
+  for (int i = 0; i < count; i++) {
+    ::sprintf(kbuf, "customer-%05d", i);
+    ::sprintf(rbuf, "{\"id\": %d, \"name\": \"customer %d\", \"email\": "
+                    "\"customer%d@example.com\", \"city\": \"Berlin\", "
+                    "\"active\": true}", i, i, i);
+    ups_key_t key = ups_make_key(kbuf, (uint16_t)(::strlen(kbuf) + 1));
+    ups_record_t rec = {0};
+    if (i % 10 == 0) {
+      REQUIRE(UPS_KEY_NOT_FOUND == ups_db_find(f.db, 0, &key, &rec, 0));
+    }
+    else {
+      REQUIRE(0 == ups_db_find(f.db, 0, &key, &rec, 0));
+      REQUIRE(0 == ::strcmp(rbuf, (const char *)rec.data));
+    }
+  }
+  return compressed;
+}
+
+TEST_CASE("Compression/ZlibJournalDictionary", "")
+{
+#ifdef HAVE_ZLIB_H
+  uint64_t plain = dictionary_journal_test(0);
+  uint64_t dict = dictionary_journal_test(4096);
+  REQUIRE(dict < plain / 2);
+
+  // the dictionary must not exceed 32 kb
+  ups_parameter_t p[] = {
+      { UPS_PARAM_JOURNAL_COMPRESSION, UPS_COMPRESSOR_ZLIB },
+      { UPS_PARAM_JOURNAL_DICTIONARY_SIZE, 32 * 1024 + 1 },
+      { 0, 0 }
+  };
+  BaseFixture f;
+  f.require_create(UPS_ENABLE_TRANSACTIONS, p, UPS_INV_PARAMETER);
+#endif
+}
+
 static void
 simple_record_test(int library)
 {
@@ -23,7 +23,9 @@
 
 #include "fixture.hpp"
 
+#include "1base/crc32c.h"
 #include "1os/file.h"
+#include "3page_manager/page_manager_state.h"
 
 using namespace upscaledb;
 
@@ -133,3 +135,180 @@ TEST_CASE("Crc32/corruptMultipageBlobTest", "")
   db.require_find("1", v1, UPS_INTEGRITY_VIOLATED);
 }
 
+TEST_CASE("Crc32/crc32cTest", "")
+{
+  const char *s = "123456789";
+  REQUIRE(Crc32c::checksum(s, 9) == 0xe3069283u);
+  REQUIRE(Crc32c::checksum_portable(s, 9) == 0xe3069283u);
+  REQUIRE(Crc32c::checksum(s, 0) == 0u);
+
+  // test vectors from RFC 3720
+  std::vector<uint8_t> zeroes(32, 0);
+  std::vector<uint8_t> ones(32, 0xff);
+  REQUIRE(Crc32c::checksum(zeroes.data(), zeroes.size()) == 0x8a9136aau);
+  REQUIRE(Crc32c::checksum(ones.data(), ones.size()) == 0x62a8ab43u);
+
+  // the crc can be calculated incrementally
+  uint32_t crc = Crc32c::checksum(s, 4);
+  REQUIRE(Crc32c::checksum(s + 4, 5, crc) == 0xe3069283u);
+}
+
+TEST_CASE("Crc32/crc32cHardwareTest", "")
+{
+  // covers unaligned data and the interleaved blocks of the hardware
+  // implementation
+  std::vector<uint8_t> buffer(1024 * 64 + 7);
+  for (size_t i = 0; i < buffer.size(); i++)
+    buffer[i] = (uint8_t)(i * 7 + (i >> 8));
+
+  size_t sizes[] = {1, 7, 8, 100, 767, 768, 769, 1024 * 16, 1024 * 24,
+                    1024 * 24 + 13, 1024 * 64};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (size_t offset = 0; offset < 8; offset += 3) {
+      REQUIRE(Crc32c::checksum(&buffer[offset], sizes[i], 0x1234)
+                == Crc32c::checksum_portable(&buffer[offset], sizes[i],
+                        0x1234));
+    }
+  }
+}
+
+TEST_CASE("Crc32/pageChecksumTest", "")
+{
+  BaseFixture f;
+  f.require_create(UPS_ENABLE_CRC32);
+  REQUIRE(f.lenv()->config.page_checksum == EnvConfig::kChecksumCrc32c);
+  REQUIRE(f.lenv()->header->page_checksum() == EnvConfig::kChecksumCrc32c);
+
+  DbProxy db(f.db);
+  db.require_insert("1", nullptr);
+
+  f.close()
+   .require_open(UPS_ENABLE_CRC32);
+  REQUIRE(f.lenv()->config.page_checksum == EnvConfig::kChecksumCrc32c);
+  db = DbProxy(f.db);
+  db.require_find("1", nullptr);
+}
+
+TEST_CASE("Crc32/murmurHashPageChecksumTest", "")
+{
+  std::vector<uint8_t> v1(1024 * 32, 3);
+
+  // files of the previous version have no checksum algorithm in the header
+  // and use MurmurHash3
+  BaseFixture f;
+  f.require_create(UPS_ENABLE_CRC32);
+  REQUIRE(f.lenv()->header->version(3) == UPS_FILE_VERSION);
+  f.lenv()->header->set_version(UPS_VERSION_MAJ, UPS_VERSION_MIN,
+                  UPS_VERSION_REV, EnvHeader::kFileVersionMurmurHash3);
+  f.lenv()->config.page_checksum = EnvConfig::kChecksumMurmurHash3;
+  f.lenv()->header->set_page_checksum(EnvConfig::kChecksumMurmurHash3);
+  f.lenv()->header->header_page->set_dirty(true);
+
+  DbProxy db(f.db);
+  db.require_insert("1", v1);
+
+  f.close()
+   .require_open(UPS_ENABLE_CRC32);
+  REQUIRE(f.lenv()->config.page_checksum
+                  == EnvConfig::kChecksumMurmurHash3);
+  db = DbProxy(f.db);
+  db.require_find("1", v1);
+}
+
+TEST_CASE("Crc32/oldFileVersionTest", "")
+{
+  // files of the previous version must not use CRC32C
+  BaseFixture f;
+  f.require_create(UPS_ENABLE_CRC32);
+  f.lenv()->header->set_version(UPS_VERSION_MAJ, UPS_VERSION_MIN,
+                  UPS_VERSION_REV, EnvHeader::kFileVersionMurmurHash3);
+  f.lenv()->header->header_page->set_dirty(true);
+  f.close()
+   .require_open(UPS_ENABLE_CRC32, 0, UPS_INV_FILE_VERSION);
+}
+
+TEST_CASE("Crc32/lazyCorruptPageTest", "")
+{
+  BaseFixture f;
+  f.require_create(UPS_ENABLE_CRC32);
+
+  DbProxy db(f.db);
+  db.require_insert("1", nullptr);
+  f.close();
+
+  // flip a few bytes in page 16 * 1024
+  garbagify_file("test.db", 1024 * 16 + 200);
+
+  // the page is verified when it is loaded the first time
+  f.require_open(UPS_ENABLE_CRC32 | UPS_ENABLE_LAZY_CRC32);
+  db = DbProxy(f.db);
+  db.require_find("1", nullptr, UPS_INTEGRITY_VIOLATED);
+}
+
+// Loads all pages, then corrupts the checksum of a leaf in the file,
+// removes the leaf from the cache and fetches it again
+static void
+reread_corrupt_mapped_page(BaseFixture &f, uint32_t flags, bool expect_error)
+{
+  std::vector<uint8_t> record(32, 1);
+
+  f.require_create(UPS_ENABLE_CRC32);
+  DbProxy db(f.db);
+  for (uint32_t i = 0; i < 5000; i++)
+    db.require_insert(i, record);
+  f.close();
+
+  f.require_open(flags);
+  db = DbProxy(f.db);
+  for (uint32_t i = 0; i < 5000; i++)
+    db.require_find(i, record);
+
+  // pick a leaf which is not the root page (the root is cached by the
+  // btree)
+  PageManager *pm = f.lenv()->page_manager.get();
+  Page *page = 0;
+  uint64_t file_size = f.lenv()->device->file_size();
+  for (uint64_t address = 1024 * 16; address < file_size;
+                  address += 1024 * 16) {
+    Page *p = pm->state->cache.get(address);
+    if (p && p->type() == Page::kTypeBindex
+          && p != f.ldb()->btree_index->state.root_page)
+      page = p;
+  }
+  REQUIRE(page != 0);
+  uint64_t address = page->address();
+  REQUIRE(f.lenv()->device->is_mapped(address, 1024 * 16));
+  pm->state->cache.del(page);
+  delete page;
+
+  // overwrite the stored checksum; the file is locked, therefore write
+  // through the device
+  uint32_t crc32 = 0x12345678;
+  f.lenv()->device->write(address + 4, &crc32, sizeof(crc32));
+
+  Context context(f.lenv(), 0, 0);
+  ups_status_t st = 0;
+  try {
+    pm->fetch(&context, address);
+  }
+  catch (Exception &ex) {
+    st = ex.code;
+  }
+  context.changeset.clear();
+  REQUIRE(st == (expect_error ? UPS_INTEGRITY_VIOLATED : 0));
+  f.close();
+}
+
+TEST_CASE("Crc32/lazyMappedPageTest", "")
+{
+  // the mapped page is not verified again
+  BaseFixture f;
+  reread_corrupt_mapped_page(f, UPS_ENABLE_CRC32 | UPS_ENABLE_LAZY_CRC32,
+                  false);
+
+#ifdef __linux__
+  // otherwise the modification is detected (the private mapping reflects
+  // changes of the file as long as the page was not modified)
+  reread_corrupt_mapped_page(f, UPS_ENABLE_CRC32, true);
+#endif
+}
@@ -18,16 +18,50 @@
 
 #include "3rdparty/catch/catch.hpp"
 
+#include <algorithm>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "1errorinducer/errorinducer.h"
+#include "1mem/page_pool.h"
 #include "2device/device.h"
+#include "2device/device_uring.h"
 
 #include "os.hpp"
 #include "fixture.hpp"
 
 using namespace upscaledb;
 
+// Writes and reads every |num_threads|th page, starting at |thread_id|
+static void
+concurrent_io(Device *device, uint64_t base, int thread_id, int num_threads,
+                int *failures)
+{
+  uint32_t page_size = device->page_size();
+  std::vector<uint8_t> buffer(page_size);
+  std::vector<uint8_t> temp(page_size);
+
+  for (int loop = 0; loop < 20; loop++) {
+    for (int i = thread_id; i < 64; i += num_threads) {
+      uint64_t address = base + (uint64_t)i * page_size;
+      std::fill(buffer.begin(), buffer.end(), (uint8_t)(i + loop));
+      device->write(address, buffer.data(), page_size);
+      device->read(address, temp.data(), page_size);
+      if (buffer != temp)
+        (*failures)++;
+
+      Page page(device);
+      device->read_page(&page, address);
+      if (::memcmp(page.data(), buffer.data(), page_size))
+        (*failures)++;
+    }
+  }
+}
+
 struct DeviceFixture : BaseFixture {
-  DeviceFixture(bool inmemory) {
-    require_create(inmemory ? UPS_IN_MEMORY : 0);
+  DeviceFixture(bool inmemory, uint32_t flags = 0) {
+    require_create((inmemory ? UPS_IN_MEMORY : 0) | flags);
   }
 
   void createCloseTest() {
@@ -74,6 +108,65 @@ struct DeviceFixture : BaseFixture {
     dp.free_page(pp);
   }
 
+  void pagePoolTest() {
+    // use a page size which is not used by any other test
+    const size_t page_size = 12 * 1024;
+    PagePool *pool = PagePool::instance(page_size);
+    REQUIRE(pool == PagePool::instance(page_size));
+    REQUIRE(pool->slab_size <= (size_t)PagePool::kSlabSize);
+    REQUIRE(pool->slab_size + page_size > (size_t)PagePool::kSlabSize);
+    REQUIRE(pool->slab_size % page_size == 0);
+
+    // fill one slab, then allocate from a second one
+    std::vector<uint8_t *> buffers;
+    for (size_t i = 0; i <= pool->buffers_per_slab; i++) {
+      uint8_t *p = pool->allocate();
+      REQUIRE(((uintptr_t)p % 4096) == 0);
+      ::memset(p, (int)i, page_size);
+      buffers.push_back(p);
+    }
+    REQUIRE(pool->slabs.size() == 2);
+    REQUIRE(pool->current_allocations == buffers.size());
+
+    std::vector<uint8_t *> sorted(buffers);
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 1; i < sorted.size(); i++)
+      REQUIRE(sorted[i] >= sorted[i - 1] + page_size);
+
+    ups_env_metrics_t metrics = {0};
+    PagePool::get_global_metrics(&metrics);
+    REQUIRE(metrics.mem_page_pool_slabs >= 2);
+    REQUIRE(metrics.mem_page_pool_bytes >= 2 * pool->slab_size);
+    REQUIRE(metrics.mem_page_pool_current_allocations >= buffers.size());
+
+    // a released buffer is reused immediately
+    uint8_t *last = buffers.back();
+    pool->release(last);
+    REQUIRE(pool->allocate() == last);
+
+    // empty slabs are returned to the OS, but one slab is kept
+    uint64_t total = pool->total_allocations;
+    for (size_t i = 0; i < buffers.size(); i++)
+      pool->release(buffers[i]);
+    REQUIRE(pool->current_allocations == 0);
+    REQUIRE(pool->total_allocations == total);
+    REQUIRE(pool->slabs.size() == 1);
+  }
+
+  void pagePoolDeviceTest() {
+    PageProxy pp(lenv(), ldb());
+    DeviceProxy dp(lenv());
+    PagePool *pool = PagePool::instance(lenv()->config.page_size_bytes);
+    uint64_t current = pool->current_allocations;
+
+    dp.require_open()
+      .alloc_page(pp);
+    REQUIRE(pp.page->persisted_data.pool == pool);
+    REQUIRE(pool->current_allocations == current + 1);
+    pp.close();
+    REQUIRE(pool->current_allocations == current);
+  }
+
   void flushTest() {
     DeviceProxy dp(lenv());
 
@@ -178,6 +271,234 @@ struct DeviceFixture : BaseFixture {
       pp.require_payload(temp, page_size - Page::kSizeofPersistentHeader);
     }
   }
+
+  void uringTest() {
+    Device *dev = device();
+    UringDevice *udev = dynamic_cast<UringDevice *>(dev);
+    if (!IoUring::is_supported()) {
+      REQUIRE(udev == 0);
+      REQUIRE(dev->supports_batched_writes() == false);
+      return;
+    }
+    REQUIRE(udev != 0);
+    REQUIRE(udev->supports_batched_writes() == true);
+
+    // more pages than the submission queue can hold
+    const uint32_t count = IoUring::kQueueDepth * 2 + 10;
+    uint32_t page_size = UPS_DEFAULT_PAGE_SIZE;
+    uint64_t base = dev->file_size();
+
+    EnvConfig &cfg = const_cast<EnvConfig &>(lenv()->config);
+    cfg.flags |= UPS_DISABLE_MMAP;
+
+    DeviceProxy dp(lenv());
+    dp.require_truncate(base + page_size * count);
+
+    std::vector<PageProxy *> proxies;
+    std::vector<Page *> list;
+    for (uint32_t i = 0; i < count; i++) {
+      PageProxy *pp = new PageProxy(lenv());
+      dp.require_read_page(*pp, base + page_size * i);
+      ::memset(pp->page->payload(), (uint8_t)i,
+                      page_size - Page::kSizeofPersistentHeader);
+      pp->set_dirty(true);
+      proxies.push_back(pp);
+      list.push_back(pp->page);
+    }
+
+    uint64_t submissions = udev->submissions();
+    REQUIRE(udev->write_pages(list) == true);
+    REQUIRE(udev->submissions() - submissions >= 3);
+
+    std::vector<uint8_t> buffer(page_size);
+    std::vector<uint8_t> temp(page_size - Page::kSizeofPersistentHeader);
+    for (uint32_t i = 0; i < count; i++) {
+      REQUIRE(proxies[i]->page->is_dirty() == false);
+      dp.require_read(base + page_size * i, buffer.data(), page_size);
+      std::fill(temp.begin(), temp.end(), (uint8_t)i);
+      REQUIRE(0 == ::memcmp(buffer.data() + Page::kSizeofPersistentHeader,
+                              temp.data(), temp.size()));
+      delete proxies[i];
+    }
+  }
+
+  void uringErrorTest() {
+    Device *dev = device();
+    UringDevice *udev = dynamic_cast<UringDevice *>(dev);
+    if (!IoUring::is_supported())
+      return;
+
+    // more pages than the submission queue can hold
+    const uint32_t count = IoUring::kQueueDepth * 2 + 10;
+    uint32_t page_size = UPS_DEFAULT_PAGE_SIZE;
+    uint64_t base = dev->file_size();
+
+    EnvConfig &cfg = const_cast<EnvConfig &>(lenv()->config);
+    cfg.flags |= UPS_DISABLE_MMAP;
+
+    DeviceProxy dp(lenv());
+    dp.require_truncate(base + page_size * count);
+
+    std::vector<PageProxy *> proxies;
+    std::vector<Page *> list;
+    for (uint32_t i = 0; i < count; i++) {
+      PageProxy *pp = new PageProxy(lenv());
+      dp.require_read_page(*pp, base + page_size * i);
+      ::memset(pp->page->payload(), (uint8_t)i,
+                      page_size - Page::kSizeofPersistentHeader);
+      pp->set_dirty(true);
+      proxies.push_back(pp);
+      list.push_back(pp->page);
+    }
+
+    // the second submission fails while the first batch is in flight
+    ErrorInducer::activate(true);
+    ErrorInducer::add(ErrorInducer::kIoUringEnter, 2, UPS_IO_ERROR);
+    ups_status_t st = 0;
+    try {
+      udev->write_pages(list);
+    }
+    catch (Exception &ex) {
+      st = ex.code;
+    }
+    ErrorInducer::activate(false);
+    REQUIRE(st == UPS_IO_ERROR);
+    REQUIRE(proxies[0]->page->is_dirty() == true);
+
+    // the ring is still usable; no completions of the failed batch are left
+    REQUIRE(udev->write_pages(list) == true);
+
+    std::vector<uint8_t> buffer(page_size);
+    std::vector<uint8_t> temp(page_size - Page::kSizeofPersistentHeader);
+    for (uint32_t i = 0; i < count; i++) {
+      REQUIRE(proxies[i]->page->is_dirty() == false);
+      dp.require_read(base + page_size * i, buffer.data(), page_size);
+      std::fill(temp.begin(), temp.end(), (uint8_t)i);
+      REQUIRE(0 == ::memcmp(buffer.data() + Page::kSizeofPersistentHeader,
+                              temp.data(), temp.size()));
+      delete proxies[i];
+    }
+  }
+
+  void directIoTest(uint32_t flags) {
+    std::vector<uint8_t> record(100);
+    DbProxy dbp(db);
+    require_flags(UPS_DISABLE_MMAP);
+    for (uint32_t i = 0; i < 2000; i++) {
+      std::fill(record.begin(), record.end(), (uint8_t)i);
+      dbp.require_insert(i, record);
+    }
+
+    close();
+    require_open(flags);
+    require_flags(UPS_DISABLE_MMAP);
+
+    dbp = DbProxy(db);
+    for (uint32_t i = 0; i < 2000; i++) {
+      std::fill(record.begin(), record.end(), (uint8_t)i);
+      dbp.require_find(i, record);
+    }
+  }
+
+  void concurrentIoTest() {
+    const int num_threads = 4;
+    Device *dev = device();
+    uint64_t base = dev->file_size();
+    DeviceProxy dp(lenv());
+    dp.require_truncate(base + 64 * UPS_DEFAULT_PAGE_SIZE);
+
+    std::vector<boost::thread *> threads;
+    int failures[num_threads] = {0};
+    for (int i = 0; i < num_threads; i++)
+      threads.push_back(new boost::thread(concurrent_io, dev, base, i,
+                              num_threads, &failures[i]));
+    for (int i = 0; i < num_threads; i++) {
+      threads[i]->join();
+      delete threads[i];
+      REQUIRE(failures[i] == 0);
+    }
+  }
+
+  void growMappingTest() {
+    DiskDevice *dev = dynamic_cast<DiskDevice *>(device());
+    REQUIRE(dev != 0);
+    uint32_t page_size = UPS_DEFAULT_PAGE_SIZE;
+    uint64_t mb = 1024 * 1024;
+
+    // small files are not mapped
+    uint64_t base = dev->file_size();
+    REQUIRE(dev->is_mapped(0, page_size) == false);
+
+    DeviceProxy dp(lenv());
+    dp.require_truncate(2 * mb);
+    REQUIRE(dev->is_mapped(0, page_size) == false);
+    REQUIRE(dev->is_mapped(base, page_size) == true);
+    REQUIRE(dev->is_mapped(2 * mb - page_size, page_size) == true);
+    REQUIRE(dev->is_mapped(2 * mb, page_size) == false);
+
+    // new pages are assigned a mapped buffer
+    PageProxy pp1(lenv());
+    dp.alloc_page(pp1);
+    REQUIRE(pp1.page->address() == 2 * mb);
+    REQUIRE(pp1.page->is_allocated() == false);
+
+    // the file outgrew the first mapping; a range must not span two
+    // mappings
+    REQUIRE(dev->is_mapped(base + 2 * mb, page_size) == true);
+    REQUIRE(dev->is_mapped(base + 2 * mb - page_size, 2 * page_size)
+                    == false);
+
+    dp.require_truncate(8 * mb);
+    REQUIRE(dev->is_mapped(8 * mb - page_size, page_size) == true);
+
+    // the pages of the new mapping are read without a copy
+    std::vector<uint8_t> data(page_size, 0x13);
+    dp.require_write(5 * mb, data.data(), page_size);
+    PageProxy pp2(lenv());
+    dp.require_read_page(pp2, 5 * mb);
+    REQUIRE(pp2.page->is_allocated() == false);
+    REQUIRE(((uint8_t *)pp2.page->data())[page_size - 1] == 0x13);
+    REQUIRE(dev->mapped_pointer(5 * mb) == (uint8_t *)pp2.page->data());
+
+    // after shrinking, the file is no longer mapped beyond its end
+    dp.require_truncate(1 * mb);
+    REQUIRE(dev->is_mapped(base, page_size) == true);
+    REQUIRE(dev->is_mapped(1 * mb, page_size) == false);
+    dp.require_truncate(8 * mb);
+    REQUIRE(dev->is_mapped(1 * mb, page_size) == false);
+
+    // the mapping is restored when the file is opened again
+    dev->close();
+    dev->open();
+    REQUIRE(dev->is_mapped(1 * mb, page_size) == true);
+  }
+
+  void growMappingDisabledTest() {
+    Device *dev = device();
+    DeviceProxy dp(lenv());
+    dp.require_truncate(8 * 1024 * 1024);
+    REQUIRE(dev->is_mapped(0, UPS_DEFAULT_PAGE_SIZE) == false);
+  }
+
+  void uringEnvironmentTest() {
+    std::vector<uint8_t> record(100);
+    DbProxy dbp(db);
+    for (uint32_t i = 0; i < 2000; i++) {
+      std::fill(record.begin(), record.end(), (uint8_t)i);
+      dbp.require_insert(i, record);
+    }
+
+    close();
+    require_open(UPS_ENABLE_IO_URING | UPS_ENABLE_TRANSACTIONS);
+    if (IoUring::is_supported())
+      REQUIRE(device()->supports_batched_writes() == true);
+
+    dbp = DbProxy(db);
+    for (uint32_t i = 0; i < 2000; i++) {
+      std::fill(record.begin(), record.end(), (uint8_t)i);
+      dbp.require_find(i, record);
+    }
+  }
 };
 
 TEST_CASE("Device/newDelete", "")
@@ -210,6 +531,18 @@ TEST_CASE("Device/allocFree", "")
   f.allocFreeTest();
 }
 
+TEST_CASE("Device/pagePool", "")
+{
+  DeviceFixture f(false);
+  f.pagePoolTest();
+}
+
+TEST_CASE("Device/pagePoolDevice", "")
+{
+  DeviceFixture f(false);
+  f.pagePoolDeviceTest();
+}
+
 TEST_CASE("Device/flush", "")
 {
   DeviceFixture f(false);
@@ -235,6 +568,57 @@ TEST_CASE("Device/readWritePage", "")
 }
 
 
+TEST_CASE("Device/uring", "")
+{
+  DeviceFixture f(false, UPS_ENABLE_IO_URING);
+  f.uringTest();
+}
+
+TEST_CASE("Device/uringError", "")
+{
+  DeviceFixture f(false, UPS_ENABLE_IO_URING);
+  f.uringErrorTest();
+}
+
+TEST_CASE("Device/uringEnvironment", "")
+{
+  DeviceFixture f(false, UPS_ENABLE_IO_URING | UPS_ENABLE_TRANSACTIONS);
+  f.uringEnvironmentTest();
+}
+
+TEST_CASE("Device/concurrentIo", "")
+{
+  DeviceFixture f(false, UPS_DISABLE_MMAP);
+  f.concurrentIoTest();
+}
+
+TEST_CASE("Device/growMapping", "")
+{
+  DeviceFixture f(false);
+  f.growMappingTest();
+}
+
+TEST_CASE("Device/growMappingDisabled", "")
+{
+  DeviceFixture f(false, UPS_DISABLE_MMAP);
+  f.growMappingDisabledTest();
+}
+
+TEST_CASE("Device/directIo", "")
+{
+  uint32_t flags = UPS_ENABLE_DIRECT_IO | UPS_ENABLE_TRANSACTIONS;
+  DeviceFixture f(false, flags);
+  f.directIoTest(flags);
+}
+
+TEST_CASE("Device/directIoUring", "")
+{
+  uint32_t flags = UPS_ENABLE_DIRECT_IO | UPS_ENABLE_IO_URING
+          | UPS_ENABLE_TRANSACTIONS;
+  DeviceFixture f(false, flags);
+  f.directIoTest(flags);
+}
+
 TEST_CASE("Device/inmem/newDelete", "")
 {
   DeviceFixture f(true);
@@ -127,9 +127,14 @@ struct JournalProxy {
       if (e.lsn == 0)
         continue;
 
-      // skip Changesets
-      while (entry.type == Journal::kEntryTypeChangeset && entry.lsn > 0) {
-        if (!starting)
+      // skip Changesets, checkpoints and dictionaries; checkpoints and
+      // dictionaries do not consume an lsn
+      while (entry.lsn > 0
+              && (entry.type == Journal::kEntryTypeChangeset
+                || entry.type == Journal::kEntryTypeCheckpointBegin
+                || entry.type == Journal::kEntryTypeCheckpointEnd
+                || entry.type == Journal::kEntryTypeDictionary)) {
+        if (!starting && entry.type == Journal::kEntryTypeChangeset)
           adjust++;
         journal->test_read_entry(&iter, &entry, &auxbuffer);
       }
@@ -243,6 +248,21 @@ struct JournalProxy {
   Journal *journal;
 };
 
+static void
+group_committer(ups_env_t *env, ups_db_t *db, uint32_t first,
+                uint32_t count, int *failures)
+{
+  for (uint32_t i = first; i < first + count; i++) {
+    ups_txn_t *txn;
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t rec = ups_make_record(&i, sizeof(i));
+    if (ups_txn_begin(&txn, env, 0, 0, 0) != 0
+        || ups_db_insert(db, txn, &key, &rec, 0) != 0
+        || ups_txn_commit(txn, 0) != 0)
+      (*failures)++;
+  }
+}
+
 struct JournalFixture : BaseFixture {
   JournalFixture(uint32_t flags = 0) {
     require_create(flags | UPS_ENABLE_TRANSACTIONS, 0,
@@ -476,9 +496,9 @@ struct JournalFixture : BaseFixture {
     uint64_t size;
     Journal *j = lenv()->journal.get();
     REQUIRE(j != 0);
-    size = j->state.files[0].file_size();
+    size = j->state.segments[0].file.file_size();
     REQUIRE(0 == size);
-    size = j->state.files[1].file_size();
+    size = j->state.segments[1].file.file_size();
     REQUIRE(0 == size);
   }
 
@@ -1062,9 +1082,56 @@ struct JournalFixture : BaseFixture {
     // close the environment
     close(UPS_AUTO_CLEANUP | UPS_DONT_CLEAR_LOG);
 
-    // verify the journal file sizes
-    require_file_size("test.db.jrn0", 33664);
-    require_file_size("test.db.jrn1", 51168);
+    // verify the journal file sizes; each segment also stores the
+    // records of a checkpoint
+    require_file_size("test.db.jrn0", 17630);
+    require_file_size("test.db.jrn1", 19032);
+  }
+
+  void groupCommitTest() {
+    const int num_threads = 4;
+    const uint32_t num_txns = 50;
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_GROUP_COMMIT_DELAY, 2000 },
+        { UPS_PARAM_JOURNAL_GROUP_COMMIT_SIZE, num_threads },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS | UPS_ENABLE_FSYNC, params,
+                    0, db_params);
+    require_parameter(params[0].name, params[0].value);
+    require_parameter(params[1].name, params[1].value);
+
+    std::vector<boost::thread *> threads;
+    int failures[num_threads] = {0};
+    for (int i = 0; i < num_threads; i++)
+      threads.push_back(new boost::thread(group_committer, env, db,
+                              i * num_txns, num_txns, &failures[i]));
+    for (int i = 0; i < num_threads; i++) {
+      threads[i]->join();
+      delete threads[i];
+      REQUIRE(failures[i] == 0);
+    }
+
+    // every commit was made durable, and the fsyncs were shared
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_commits == num_threads * num_txns);
+    REQUIRE(metrics.journal_fsyncs > 0);
+    REQUIRE(metrics.journal_fsyncs <= metrics.journal_commits);
+    REQUIRE(lenv()->journal->unsynced_lsn() == 0);
+
+    for (uint32_t i = 0; i < num_threads * num_txns; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &rec, 0));
+      REQUIRE(*(uint32_t *)rec.data == i);
+    }
   }
 
   void recoverWithCrc32Test() {
@@ -1107,6 +1174,456 @@ struct JournalFixture : BaseFixture {
     require_flags(UPS_ENABLE_CRC32, true);
     require_flags(UPS_ENABLE_FSYNC, true);
   }
+
+  void insert_page_delta_keys(uint32_t count) {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 1000 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    // every commit flushes a changeset
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    REQUIRE(0 == ups_env_flush(env, 0));
+
+    // a copy of the database file before the inserts
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+
+    for (uint32_t i = 0; i < count; i++) {
+      TxnProxy tp(env, nullptr, true);
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, tp.txn, &key, &rec, 0));
+    }
+  }
+
+  void pageDeltaTest() {
+    const uint32_t count = 200;
+    insert_page_delta_keys(count);
+
+    // the first changeset entry of a page stores the full page, the
+    // following entries only store the modified bytes
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_page_images > 0);
+    REQUIRE(metrics.journal_page_deltas > metrics.journal_page_images);
+    REQUIRE(metrics.journal_bytes_flushed
+                < (metrics.journal_page_images + metrics.journal_page_deltas)
+                    * lenv()->config.page_size_bytes);
+
+    // after a switch of the journal files, pages are again stored in full
+    uint64_t images = metrics.journal_page_images;
+    lenv()->journal->clear();
+    {
+      uint32_t i = count;
+      TxnProxy tp(env, nullptr, true);
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(&i, sizeof(i));
+      REQUIRE(0 == ups_db_insert(db, tp.txn, &key, &rec, 0));
+    }
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_page_images > images);
+  }
+
+  void recoverPageDeltasTest() {
+#ifndef WIN32
+    const uint32_t count = 200;
+    insert_page_delta_keys(count);
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_page_deltas > 0);
+
+    // combine the old database file with the new journal; the changesets
+    // (full pages followed by deltas) restore the inserted keys
+    REQUIRE(true == os::copy("test.db.jrn0", "test.db.bak0"));
+    REQUIRE(true == os::copy("test.db.jrn1", "test.db.bak1"));
+    close(UPS_AUTO_CLEANUP);
+    restore();
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY);
+    for (uint32_t i = 0; i < count; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &rec, 0));
+      REQUIRE(*(uint32_t *)rec.data == i);
+    }
+#endif
+  }
+
+  void recoverParallelTest(int compressor) {
+#ifndef WIN32
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 1000 },
+        { UPS_PARAM_JOURNAL_COMPRESSION, (uint64_t)compressor },
+        { 0, 0 }
+    };
+    if (compressor == 0)
+      params[1].name = 0;
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+    const uint32_t count = 5000;
+    std::vector<uint8_t> record(256);
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    REQUIRE(0 == ups_env_flush(env, 0));
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+
+    // a large changeset with many pages, followed by small changesets
+    // which modify some of these pages again
+    {
+      TxnProxy tp(env, nullptr, true);
+      for (uint32_t i = 0; i < count; i++) {
+        *(uint32_t *)record.data() = i;
+        ups_key_t key = ups_make_key(&i, sizeof(i));
+        ups_record_t rec = ups_make_record(record.data(),
+                                (uint32_t)record.size());
+        REQUIRE(0 == ups_db_insert(db, tp.txn, &key, &rec, 0));
+      }
+    }
+    for (uint32_t i = 0; i < count; i += 100) {
+      TxnProxy tp(env, nullptr, true);
+      *(uint32_t *)record.data() = i + count;
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(record.data(),
+                              (uint32_t)record.size());
+      REQUIRE(0 == ups_db_insert(db, tp.txn, &key, &rec, UPS_OVERWRITE));
+    }
+
+    REQUIRE(true == os::copy("test.db.jrn0", "test.db.bak0"));
+    REQUIRE(true == os::copy("test.db.jrn1", "test.db.bak1"));
+    close(UPS_AUTO_CLEANUP);
+    restore();
+
+    ups_parameter_t open_params[] = {
+        { UPS_PARAM_RECOVERY_THREADS, 4 },
+        { 0, 0 }
+    };
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, open_params);
+    require_parameter(UPS_PARAM_RECOVERY_THREADS, 4);
+
+    for (uint32_t i = 0; i < count; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = {0};
+      REQUIRE(0 == ups_db_find(db, 0, &key, &rec, 0));
+      REQUIRE(rec.size == record.size());
+      REQUIRE(*(uint32_t *)rec.data == (i % 100 == 0 ? i + count : i));
+    }
+#endif
+  }
+
+  // copies all journal segments of test.db to test.db.bak<n>, or back
+  void copy_segments(bool restore) {
+    for (int i = 0; ; i++) {
+      char jrn[64], bak[64];
+      ::snprintf(jrn, sizeof(jrn), "test.db.jrn%d", i);
+      ::snprintf(bak, sizeof(bak), "test.db.bak%d", i);
+      if (!os::file_exists(restore ? bak : jrn)) {
+        // backups of a previous test must not be restored
+        while (!restore && os::unlink(bak))
+          ::snprintf(bak, sizeof(bak), "test.db.bak%d", ++i);
+        break;
+      }
+      REQUIRE(true == (restore ? os::copy(bak, jrn) : os::copy(jrn, bak)));
+    }
+  }
+
+  void insert_segment_keys(ups_txn_t *txn, uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> record(1024);
+    for (uint32_t i = begin; i < end; i++) {
+      *(uint32_t *)record.data() = i;
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = ups_make_record(record.data(),
+                              (uint32_t)record.size());
+      if (txn) {
+        REQUIRE(0 == ups_db_insert(db, txn, &key, &rec, 0));
+      }
+      else {
+        TxnProxy tp(env, nullptr, true);
+        REQUIRE(0 == ups_db_insert(db, tp.txn, &key, &rec, 0));
+      }
+    }
+  }
+
+  void require_segment_keys(uint32_t begin, uint32_t end,
+                  ups_status_t status = 0) {
+    for (uint32_t i = begin; i < end; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t rec = {0};
+      REQUIRE(status == ups_db_find(db, 0, &key, &rec, 0));
+      if (status == 0)
+        REQUIRE(*(uint32_t *)rec.data == i);
+    }
+  }
+
+  void segmentRecycleTest() {
+    const uint64_t segment_size = 256 * 1024;
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SEGMENTS, 3 },
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, segment_size },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    require_parameter(UPS_PARAM_JOURNAL_SEGMENTS, 3);
+    require_parameter(UPS_PARAM_JOURNAL_SEGMENT_SIZE, segment_size);
+
+    // the segments are preallocated
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.segments.size() == 3);
+    for (int i = 0; i < 3; i++)
+      REQUIRE(j->state.segments[i].file.file_size() == segment_size);
+    REQUIRE(false == os::file_exists("test.db.jrn3"));
+
+    // the journal wraps around several times; the segments are reused
+    // and keep their size
+    insert_segment_keys(0, 0, 2000);
+    REQUIRE(j->state.segments.size() == 3);
+    REQUIRE(j->state.sequence > 6);
+    for (int i = 0; i < 3; i++) {
+      REQUIRE(j->state.segments[i].file.file_size() == segment_size);
+      REQUIRE(j->state.segments[i].open_txns == 0);
+    }
+
+    // simulate a crash, then recover from the reused segments
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+    copy_segments(false);
+    close(UPS_AUTO_CLEANUP);
+    REQUIRE(true == os::copy("test.db.bak", "test.db"));
+    copy_segments(true);
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, params);
+    require_segment_keys(0, 2000);
+
+    // the journal is empty after recovery, but still preallocated
+    j = lenv()->journal.get();
+    REQUIRE(j->is_empty());
+    close(UPS_AUTO_CLEANUP);
+    require_file_size("test.db.jrn0", segment_size);
+    require_file_size("test.db.jrn1", segment_size);
+    require_file_size("test.db.jrn2", segment_size);
+  }
+
+  void segmentPinnedTest(uint64_t segment_size) {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, segment_size },
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 10 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    Journal *j = lenv()->journal.get();
+
+    // a long-running Txn blocks the flush of all Txns which commit later;
+    // their segments must not be reused, and additional segments are
+    // created
+    ups_txn_t *txn;
+    REQUIRE(0 == ups_txn_begin(&txn, env, 0, 0, 0));
+    insert_segment_keys(txn, 0, 1);
+    insert_segment_keys(0, 1, 300);
+    REQUIRE(j->state.segments.size() > 2);
+    REQUIRE(true == os::file_exists("test.db.jrn2"));
+
+    // simulate a crash; all committed Txns are recovered
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+    copy_segments(false);
+
+    // flushing the Txns releases the segments; the additional segments
+    // are deleted as soon as the journal moves on
+    REQUIRE(0 == ups_txn_commit(txn, 0));
+    for (uint32_t i = 0; i < j->state.segments.size(); i++)
+      REQUIRE(j->state.segments[i].open_txns == 0);
+    insert_segment_keys(0, 300, 600);
+    REQUIRE(j->state.segments.size() == 2);
+    REQUIRE(false == os::file_exists("test.db.jrn2"));
+    require_segment_keys(0, 600);
+
+    close(UPS_AUTO_CLEANUP);
+    REQUIRE(true == os::copy("test.db.bak", "test.db"));
+    copy_segments(true);
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, params);
+    require_segment_keys(0, 1, UPS_KEY_NOT_FOUND);
+    require_segment_keys(1, 300);
+    require_segment_keys(300, 600, UPS_KEY_NOT_FOUND);
+  }
+
+  void segmentSpanningTxnTest() {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, 64 * 1024 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    Journal *j = lenv()->journal.get();
+
+    // an older Txn blocks the flush of the large Txn
+    ups_txn_t *blocker;
+    REQUIRE(0 == ups_txn_begin(&blocker, env, 0, 0, 0));
+    insert_segment_keys(blocker, 0, 1);
+
+    // the large Txn does not fit into a single segment; it spans several
+    // segments, and all of them are pinned
+    uint64_t sequence = j->state.sequence;
+    ups_txn_t *txn;
+    REQUIRE(0 == ups_txn_begin(&txn, env, 0, 0, 0));
+    insert_segment_keys(txn, 1, 250);
+    REQUIRE(0 == ups_txn_commit(txn, 0));
+    REQUIRE(j->state.sequence >= sequence + 4);
+    std::vector<int> pinned = ((LocalTxn *)txn)->log_descriptors;
+    REQUIRE(pinned.size() >= 4);
+    for (size_t i = 0; i < pinned.size(); i++)
+      REQUIRE(j->state.segments[pinned[i]].open_txns > 0);
+
+    // the following Txns must not reuse any of those segments
+    insert_segment_keys(0, 250, 400);
+    for (size_t i = 0; i < pinned.size(); i++)
+      REQUIRE(j->state.segments[pinned[i]].open_txns > 0);
+
+    // simulate a crash
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+    copy_segments(false);
+
+    // flushing the Txns releases all segments
+    REQUIRE(0 == ups_txn_commit(blocker, 0));
+    for (uint32_t i = 0; i < j->state.segments.size(); i++)
+      REQUIRE(j->state.segments[i].open_txns == 0);
+
+    close(UPS_AUTO_CLEANUP);
+    REQUIRE(true == os::copy("test.db.bak", "test.db"));
+    copy_segments(true);
+
+    // the large Txn is recovered from all of its segments
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, params);
+    require_segment_keys(0, 1, UPS_KEY_NOT_FOUND);
+    require_segment_keys(1, 400);
+  }
+
+  void checkpointTest() {
+    const uint64_t checkpoint_size = 64 * 1024;
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_CHECKPOINT_SIZE, checkpoint_size },
+        { UPS_PARAM_JOURNAL_SWITCH_THRESHOLD, 1000 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+    require_parameter(UPS_PARAM_JOURNAL_CHECKPOINT_SIZE, checkpoint_size);
+
+    // the journal is not switched, but checkpoints are started
+    // after every |checkpoint_size| bytes
+    insert_segment_keys(0, 0, 500);
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.sequence == 1);
+
+    ups_env_metrics_t metrics;
+    REQUIRE(0 == ups_env_get_metrics(env, &metrics));
+    REQUIRE(metrics.journal_checkpoints > 0);
+    REQUIRE(metrics.journal_checkpoint_lsn > 0);
+    REQUIRE(metrics.journal_checkpoint_lsn_lag > 0);
+    REQUIRE(metrics.journal_checkpoint_lsn_lag < current_lsn());
+
+    // each completed checkpoint has a "begin" and an "end" record
+    Journal::Iterator iter;
+    PJournalEntry entry;
+    ByteArray auxbuffer;
+    uint64_t begin = 0, end = 0;
+    do {
+      j->test_read_entry(&iter, &entry, &auxbuffer);
+      if (entry.type == Journal::kEntryTypeCheckpointBegin)
+        begin++;
+      if (entry.type == Journal::kEntryTypeCheckpointEnd) {
+        REQUIRE(end < begin);
+        end++;
+      }
+    } while (entry.lsn != 0);
+    REQUIRE(end == metrics.journal_checkpoints);
+    REQUIRE(begin >= end);
+
+    // simulate a crash; recovery starts at the newest checkpoint
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+    copy_segments(false);
+    close(UPS_AUTO_CLEANUP);
+    REQUIRE(true == os::copy("test.db.bak", "test.db"));
+    copy_segments(true);
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, params);
+    require_segment_keys(0, 500);
+  }
+
+  void checkpointRecycleTest() {
+    ups_parameter_t params[] = {
+        { UPS_PARAM_JOURNAL_SEGMENT_SIZE, 64 * 1024 },
+        { 0, 0 }
+    };
+    ups_parameter_t db_params[] = {
+        { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+        { 0, 0 }
+    };
+
+    close();
+    require_create(UPS_ENABLE_TRANSACTIONS
+                    | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY, params, 0, db_params);
+
+    // a checkpoint is started at every switch; a segment is only reused
+    // after its checkpoint was completed
+    insert_segment_keys(0, 0, 1000);
+    Journal *j = lenv()->journal.get();
+    REQUIRE(j->state.segments.size() == 2);
+    REQUIRE(j->state.sequence > 4);
+    REQUIRE(j->state.count_checkpoints >= j->state.sequence - 2);
+    REQUIRE(j->state.checkpoint_sequence + 1 >= j->state.sequence);
+
+    // simulate a crash, then recover
+    REQUIRE(true == os::copy("test.db", "test.db.bak"));
+    copy_segments(false);
+    close(UPS_AUTO_CLEANUP);
+    REQUIRE(true == os::copy("test.db.bak", "test.db"));
+    copy_segments(true);
+
+    require_open(UPS_ENABLE_TRANSACTIONS | UPS_FLUSH_TRANSACTIONS_IMMEDIATELY
+                    | UPS_AUTO_RECOVERY, params);
+    require_segment_keys(0, 1000);
+  }
 };
 
 TEST_CASE("Journal/createClose", "")
@@ -1277,5 +1794,70 @@ TEST_CASE("Journal/recoverWithCrc32Test", "")
   f.recoverWithCrc32Test();
 }
 
-} // namespace upscaledb
+TEST_CASE("Journal/groupCommitTest", "")
+{
+  JournalFixture f;
+  f.groupCommitTest();
+}
+
+TEST_CASE("Journal/pageDeltaTest", "")
+{
+  JournalFixture f;
+  f.pageDeltaTest();
+}
+
+TEST_CASE("Journal/recoverPageDeltasTest", "")
+{
+  JournalFixture f;
+  f.recoverPageDeltasTest();
+}
+
+TEST_CASE("Journal/recoverParallelTest", "")
+{
+  JournalFixture f;
+  f.recoverParallelTest(0);
+}
 
+TEST_CASE("Journal/recoverParallelCompressedTest", "")
+{
+  JournalFixture f;
+  f.recoverParallelTest(UPS_COMPRESSOR_LZF);
+}
+
+TEST_CASE("Journal/segmentRecycleTest", "")
+{
+  JournalFixture f;
+  f.segmentRecycleTest();
+}
+
+TEST_CASE("Journal/segmentPinnedTest", "")
+{
+  JournalFixture f;
+  f.segmentPinnedTest(0);
+}
+
+TEST_CASE("Journal/segmentPinnedPreallocatedTest", "")
+{
+  JournalFixture f;
+  f.segmentPinnedTest(64 * 1024);
+}
+
+TEST_CASE("Journal/segmentSpanningTxnTest", "")
+{
+  JournalFixture f;
+  f.segmentSpanningTxnTest();
+}
+
+TEST_CASE("Journal/checkpointTest", "")
+{
+  JournalFixture f;
+  f.checkpointTest();
+}
+
+TEST_CASE("Journal/checkpointRecycleTest", "")
+{
+  JournalFixture f;
+  f.checkpointRecycleTest();
+}
+
+} // namespace upscaledb
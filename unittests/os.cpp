@@ -207,6 +207,68 @@ TEST_CASE("Os/readWrite")
   }
 }
 
+TEST_CASE("Os/pwritev")
+{
+  FileProxy fp;
+  char buffers[10][128], orig[128];
+  IoBuffer iov[10];
+
+  fp.require_create("test.db", 0664);
+  for (uint32_t i = 0; i < 10; i++) {
+    ::memset(buffers[i], i, sizeof(buffers[i]));
+    iov[i] = IoBuffer(buffers[i], sizeof(buffers[i]));
+  }
+  fp.f.pwritev(128, iov, 10);
+  fp.require_size(11 * 128);
+
+  for (uint32_t i = 0; i < 10; i++) {
+    char buffer[128];
+    ::memset(orig, i, sizeof(orig));
+    fp.require_pread((i + 1) * 128, buffer, sizeof(buffer));
+    REQUIRE(0 == ::memcmp(buffer, orig, sizeof(orig)));
+  }
+}
+
+TEST_CASE("Os/directIo")
+{
+  FileProxy fp;
+  char buffer[128], orig[128];
+
+  fp.f.create("test.db", 0664, true);
+#ifdef __linux__
+  REQUIRE(fp.f.direct_io_alignment() >= 512);
+#endif
+
+  // unaligned requests are redirected through an aligned buffer; the
+  // file must not grow beyond the last byte which was written
+  for (uint32_t i = 0; i < 10; i++) {
+    ::memset(buffer, i, sizeof(buffer));
+    fp.require_pwrite(i * sizeof(buffer), buffer, sizeof(buffer));
+  }
+  fp.require_size(10 * sizeof(buffer));
+
+  // aligned requests are passed through
+  uint32_t page_size = File::kMaxDirectIoAlignment;
+  uint8_t *page = (uint8_t *)os_alloc_pages(page_size, false);
+  ::memset(page, 0x33, page_size);
+  fp.require_pwrite(page_size, page, page_size)
+    .require_size(2 * page_size);
+  fp.close();
+
+  fp.f.open("test.db", false, true);
+  for (uint32_t i = 0; i < 10; i++) {
+    ::memset(orig, i, sizeof(orig));
+    ::memset(buffer, 0, sizeof(buffer));
+    fp.require_pread(i * sizeof(buffer), buffer, sizeof(buffer));
+    REQUIRE(0 == ::memcmp(buffer, orig, sizeof(buffer)));
+  }
+  ::memset(page, 0, page_size);
+  fp.require_pread(page_size, page, page_size);
+  for (uint32_t i = 0; i < page_size; i++)
+    REQUIRE(page[i] == 0x33);
+  os_free_pages(page, page_size);
+}
+
 TEST_CASE("Os/mmap")
 {
   uint32_t page_size = File::granularity();
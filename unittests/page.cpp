@@ -66,6 +66,31 @@ struct PageFixture : public BaseFixture {
     tmp.require_fetch(page_size * 2)
        .require_data(pp.page->data(), page_size);
   }
+
+  void flushRunTest() {
+    uint32_t page_size = lenv()->config.page_size_bytes;
+    PageProxy pp[10] = {{lenv()}, {lenv()}, {lenv()}, {lenv()}, {lenv()},
+                        {lenv()}, {lenv()}, {lenv()}, {lenv()}, {lenv()}};
+    Page *pages[10];
+
+    for (uint32_t i = 0; i < 10; i++) {
+      pp[i].require_alloc(0, page_size)
+        .require_address(page_size * (i + 2));
+      ::memset(pp[i].page->payload(), i + 1,
+                    page_size - Page::kSizeofPersistentHeader);
+      pp[i].set_dirty();
+      pages[i] = pp[i].page;
+    }
+
+    Page::flush_run(pages, 10);
+
+    for (uint32_t i = 0; i < 10; i++) {
+      pp[i].require_dirty(false);
+      PageProxy tmp(lenv());
+      tmp.require_fetch(page_size * (i + 2))
+         .require_data(pp[i].page->data(), page_size);
+    }
+  }
 };
 
 TEST_CASE("Page/newDelete", "")
@@ -94,6 +119,12 @@ TEST_CASE("Page/fetchFlush", "")
   f.fetchFlushTest();
 }
 
+TEST_CASE("Page/flushRun", "")
+{
+  PageFixture f;
+  f.flushRunTest();
+}
+
 TEST_CASE("Page/nommap/newDelete", "")
 {
   PageFixture f(UPS_DISABLE_MMAP);
@@ -120,6 +151,12 @@ TEST_CASE("Page/nommap/fetchFlush", "")
   f.fetchFlushTest();
 }
 
+TEST_CASE("Page/nommap/flushRun", "")
+{
+  PageFixture f(UPS_DISABLE_MMAP);
+  f.flushRunTest();
+}
+
 
 TEST_CASE("Page/inmem/newDelete", "")
 {
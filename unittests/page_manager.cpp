@@ -508,6 +508,569 @@ TEST_CASE("PageManager/allocMultiBlobs", "")
   f.allocMultiBlobs();
 }
 
+TEST_CASE("PageManager/parallelFlushTest", "")
+{
+  ups_parameter_t params[] = {
+      {UPS_PARAM_PAGE_SIZE, 1024},
+      {UPS_PARAM_CACHE_SIZE, 32 * 1024},
+      {UPS_PARAM_FLUSH_THREADS, 4},
+      {0, 0}
+  };
+  BaseFixture f;
+  f.require_create(0, params)
+   .require_parameter(UPS_PARAM_FLUSH_THREADS, 4);
+
+  // the cache is tiny: dirty pages are permanently purged
+  const uint32_t count = 20000;
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t r = i * 7;
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&r, sizeof(r));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  REQUIRE(metrics.page_count_flushed > 0);
+
+  f.close();
+  f.require_open(0, &params[1]);
+
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = {0};
+    REQUIRE(0 == ups_db_find(f.db, 0, &key, &record, 0));
+    REQUIRE(record.size == sizeof(uint64_t));
+    REQUIRE(*(uint64_t *)record.data == i * 7ull);
+  }
+}
+
+// Fills a cache with 4 frequently used pages, followed by a scan over 20
+// pages which are accessed only once. Returns the number of frequently
+// used pages which are selected for purging.
+static int
+purgeHotPagesAfterScan(Device *device, int policy, ups_env_metrics_t *metrics)
+{
+  EnvConfig config;
+  config.page_size_bytes = 1024;
+  config.cache_size_bytes = 8 * 1024;
+  config.cache_policy = policy;
+  Cache cache(config);
+
+  PPageData pers[24];
+  Page *pages[24];
+  for (int i = 0; i < 24; i++) {
+    ::memset(&pers[i], 0, sizeof(pers[i]));
+    pages[i] = new Page(device);
+    pages[i]->set_without_header(true);
+    pages[i]->set_address((i + 1) * 1024ull);
+    pages[i]->set_data(&pers[i]);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    cache.put(pages[i]);
+    REQUIRE(pages[i] == cache.get(pages[i]->address()));
+  }
+  for (int i = 4; i < 24; i++)
+    cache.put(pages[i]);
+  REQUIRE(cache.current_elements() == 24);
+  REQUIRE(cache.is_cache_full());
+
+  std::vector<uint64_t> candidates;
+  std::vector<Page *> garbage;
+  cache.purge_candidates(candidates, garbage, 0);
+  REQUIRE(candidates.empty());
+  REQUIRE(garbage.size() == 16);
+
+  int hot = 0;
+  for (size_t i = 0; i < garbage.size(); i++)
+    if (garbage[i]->address() <= 4 * 1024ull)
+      hot++;
+
+  REQUIRE(pages[0] == cache.get(pages[0]->address()));
+  cache.fill_metrics(metrics);
+
+  for (int i = 0; i < 24; i++) {
+    cache.del(pages[i]);
+    pages[i]->set_data(0);
+    delete pages[i];
+  }
+  REQUIRE(cache.current_elements() == 0);
+  return hot;
+}
+
+TEST_CASE("PageManager/cache2QScanTest", "")
+{
+  BaseFixture f;
+  f.require_create(0);
+
+  ups_env_metrics_t metrics = {0};
+  REQUIRE(4 == purgeHotPagesAfterScan(f.lenv()->device.get(),
+                          UPS_CACHE_POLICY_LRU, &metrics));
+  REQUIRE(metrics.cache_policy == UPS_CACHE_POLICY_LRU);
+  REQUIRE(metrics.cache_promotions == 0);
+
+  REQUIRE(0 == purgeHotPagesAfterScan(f.lenv()->device.get(),
+                          UPS_CACHE_POLICY_2Q, &metrics));
+  REQUIRE(metrics.cache_policy == UPS_CACHE_POLICY_2Q);
+  REQUIRE(metrics.cache_promotions == 4);
+  REQUIRE(metrics.cache_hits_protected == 1);
+  REQUIRE(metrics.cache_demotions == 0);
+  REQUIRE(metrics.cache_hits == 5);
+}
+
+TEST_CASE("PageManager/cacheResizeTest", "")
+{
+  BaseFixture f;
+  f.require_create(0);
+
+  EnvConfig config;
+  config.page_size_bytes = 1024;
+  config.flags = UPS_CACHE_UNLIMITED;
+  Cache cache(config);
+
+  ups_env_metrics_t metrics = {0};
+  cache.fill_metrics(&metrics);
+  REQUIRE(metrics.cache_buckets == CacheState::kMinBuckets);
+  REQUIRE(metrics.cache_buckets_used == 0);
+
+  const int count = 20000;
+  std::vector<PPageData> pers(count);
+  std::vector<Page *> pages(count);
+  for (int i = 0; i < count; i++) {
+    pages[i] = new Page(f.lenv()->device.get());
+    pages[i]->set_without_header(true);
+    pages[i]->set_address((i + 1) * 1024ull);
+    pages[i]->set_data(&pers[i]);
+    cache.put(pages[i]);
+  }
+
+  // the buckets grew with the number of pages; the chains are short
+  cache.fill_metrics(&metrics);
+  REQUIRE(metrics.cache_resizes > 0);
+  REQUIRE(metrics.cache_buckets >= (uint64_t)count / 2);
+  REQUIRE(metrics.cache_buckets_used > 0);
+  REQUIRE(metrics.cache_max_chain_length <= 16);
+
+  for (int i = 0; i < count; i++)
+    REQUIRE(pages[i] == cache.get((i + 1) * 1024ull));
+  REQUIRE((Page *)0 == cache.get((count + 1) * 1024ull));
+
+  for (int i = 0; i < count; i++) {
+    cache.del(pages[i]);
+    REQUIRE((Page *)0 == cache.get((i + 1) * 1024ull));
+    pages[i]->set_data(0);
+    delete pages[i];
+  }
+
+  cache.fill_metrics(&metrics);
+  REQUIRE(metrics.cache_buckets_used == 0);
+  REQUIRE(cache.current_elements() == 0);
+}
+
+TEST_CASE("PageManager/cachePolicyParameterTest", "")
+{
+  ups_parameter_t bad[] = {
+      {UPS_PARAM_CACHE_POLICY, 7},
+      {0, 0}
+  };
+  BaseFixture f;
+  f.require_create(0, bad, UPS_INV_PARAMETER);
+
+  ups_parameter_t params[] = {
+      {UPS_PARAM_PAGE_SIZE, 1024},
+      {UPS_PARAM_CACHE_SIZE, 32 * 1024},
+      {UPS_PARAM_CACHE_POLICY, UPS_CACHE_POLICY_2Q},
+      {0, 0}
+  };
+  f.require_create(0, params)
+   .require_parameter(UPS_PARAM_CACHE_POLICY, UPS_CACHE_POLICY_2Q);
+
+  const uint32_t count = 5000;
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  f.close();
+  f.require_open(0, &params[1])
+   .require_parameter(UPS_PARAM_CACHE_POLICY, UPS_CACHE_POLICY_2Q);
+
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = {0};
+    REQUIRE(0 == ups_db_find(f.db, 0, &key, &record, 0));
+    REQUIRE(*(uint32_t *)record.data == i);
+  }
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  REQUIRE(metrics.cache_policy == UPS_CACHE_POLICY_2Q);
+  REQUIRE(metrics.cache_promotions > 0);
+}
+
+TEST_CASE("PageManager/cacheInternalNodesTest", "")
+{
+  BaseFixture f;
+  f.require_create(0);
+
+  EnvConfig config;
+  config.page_size_bytes = 1024;
+  config.cache_size_bytes = 20 * 1024;
+  config.cache_internal_nodes_percent = 10;
+  Cache cache(config);
+
+  // pages 0..2 are internal nodes, all others are blob pages
+  const int count = 33;
+  std::vector<uint8_t> buffer(count * 1024);
+  std::vector<Page *> pages(count);
+  for (int i = 0; i < count; i++) {
+    pages[i] = new Page(f.lenv()->device.get());
+    pages[i]->set_address((i + 1) * 1024ull);
+    pages[i]->set_data((PPageData *)&buffer[i * 1024]);
+    pages[i]->set_type(i < 3 ? Page::kTypeBindex : Page::kTypeBlob);
+    REQUIRE(Cache::is_internal_node(pages[i]) == (i < 3));
+  }
+
+  // the first two internal nodes fit into the reserved capacity
+  for (int i = 0; i < 2; i++) {
+    cache.put(pages[i]);
+    REQUIRE(pages[i] == cache.get(pages[i]->address()));
+  }
+  for (int i = 3; i < count; i++)
+    cache.put(pages[i]);
+
+  std::vector<uint64_t> candidates;
+  std::vector<Page *> garbage;
+  cache.purge_candidates(candidates, garbage, 0);
+  REQUIRE(garbage.size() == 12);
+  for (size_t i = 0; i < garbage.size(); i++)
+    REQUIRE(!Cache::is_internal_node(garbage[i]));
+
+  // the third internal node exceeds the reserved capacity; the least
+  // recently used internal node is purged first
+  cache.put(pages[2]);
+  REQUIRE(pages[2] == cache.get(pages[2]->address()));
+  garbage.clear();
+  cache.purge_candidates(candidates, garbage, 0);
+  REQUIRE(garbage.size() == 13);
+  REQUIRE(garbage[0] == pages[0]);
+
+  ups_env_metrics_t metrics = {0};
+  cache.fill_metrics(&metrics);
+  REQUIRE(metrics.cache_hits_internal == 3);
+  REQUIRE(metrics.cache_internal_nodes == 3);
+
+  for (int i = 0; i < count; i++) {
+    cache.del(pages[i]);
+    pages[i]->set_data(0);
+    delete pages[i];
+  }
+  REQUIRE(cache.current_elements() == 0);
+}
+
+TEST_CASE("PageManager/cacheInternalNodesParameterTest", "")
+{
+  ups_parameter_t bad[] = {
+      {UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT, 101},
+      {0, 0}
+  };
+  BaseFixture f;
+  f.require_create(0, bad, UPS_INV_PARAMETER);
+
+  ups_parameter_t params[] = {
+      {UPS_PARAM_PAGE_SIZE, 1024},
+      {UPS_PARAM_CACHE_SIZE, 64 * 1024},
+      {UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT, 25},
+      {0, 0}
+  };
+  f.require_create(0, params)
+   .require_parameter(UPS_PARAM_CACHE_INTERNAL_NODES_PERCENT, 25);
+
+  const uint32_t count = 10000;
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = {0};
+    REQUIRE(0 == ups_db_find(f.db, 0, &key, &record, 0));
+    REQUIRE(*(uint32_t *)record.data == i);
+  }
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  REQUIRE(metrics.cache_hits_internal > 0);
+  REQUIRE(metrics.cache_internal_nodes > 0);
+}
+
+TEST_CASE("PageManager/compressedCacheTest", "")
+{
+  BaseFixture f;
+  f.require_create(0);
+
+  EnvConfig config;
+  config.page_size_bytes = 1024;
+  config.cache_size_bytes = 20 * 1024;
+  config.compressed_cache_size_bytes = 4 * 1024;
+  Cache cache(config);
+  CompressedCache &compressed = cache.compressed;
+  REQUIRE(compressed.is_enabled());
+
+  // store a few pages which compress well, and one which does not
+  std::vector<uint8_t> buffer(1024);
+  for (int i = 0; i < 4; i++) {
+    ::memset(&buffer[0], 'a' + i, buffer.size());
+    compressed.put((i + 1) * 1024ull, &buffer[0]);
+  }
+  REQUIRE(compressed.pages.size() == 4);
+  REQUIRE(compressed.used_bytes < 4 * 1024);
+
+  uint32_t seed = 1;
+  for (size_t i = 0; i < buffer.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    buffer[i] = (uint8_t)(seed >> 16);
+  }
+  compressed.put(5 * 1024ull, &buffer[0]);
+  REQUIRE(compressed.pages.size() == 4);
+  REQUIRE(compressed.rejected == 1);
+
+  // a hit decompresses the page and removes the compressed copy
+  Page *page = new Page(f.lenv()->device.get());
+  REQUIRE(true == compressed.fetch(2 * 1024ull, page));
+  REQUIRE(page->is_allocated());
+  for (int i = 0; i < 1024; i++)
+    REQUIRE(((uint8_t *)page->data())[i] == 'b');
+  REQUIRE(compressed.pages.size() == 3);
+  REQUIRE(false == compressed.fetch(2 * 1024ull, page));
+
+  // storing a page in the cache removes its compressed copy
+  page->set_address(3 * 1024ull);
+  cache.put(page);
+  REQUIRE(compressed.pages.size() == 2);
+  REQUIRE(compressed.pages.count(3 * 1024ull) == 0);
+  cache.del(page);
+  delete page;
+
+  ups_env_metrics_t metrics = {0};
+  cache.fill_metrics(&metrics);
+  REQUIRE(metrics.compressed_cache_hits == 1);
+  REQUIRE(metrics.compressed_cache_misses == 1);
+  REQUIRE(metrics.compressed_cache_rejected == 1);
+  REQUIRE(metrics.compressed_cache_pages == 2);
+  REQUIRE(metrics.compressed_cache_bytes == compressed.used_bytes);
+  REQUIRE(metrics.compressed_cache_uncompressed_bytes == 2 * 1024);
+
+  // the least recently stored pages are purged if the capacity is exceeded
+  compressed.capacity_bytes = compressed.used_bytes;
+  ::memset(&buffer[0], 'x', buffer.size());
+  compressed.put(6 * 1024ull, &buffer[0]);
+  REQUIRE(compressed.pages.count(1 * 1024ull) == 0);
+  REQUIRE(compressed.pages.count(6 * 1024ull) == 1);
+  REQUIRE(compressed.used_bytes <= compressed.capacity_bytes);
+}
+
+TEST_CASE("PageManager/compressedCacheParameterTest", "")
+{
+  ups_parameter_t bad[] = {
+      {UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR, UPS_COMPRESSOR_UINT32_VARBYTE},
+      {0, 0}
+  };
+  BaseFixture f;
+  f.require_create(0, bad, UPS_INV_PARAMETER);
+
+  ups_parameter_t params[] = {
+      {UPS_PARAM_PAGE_SIZE, 1024},
+      {UPS_PARAM_CACHE_SIZE, 32 * 1024},
+      {UPS_PARAM_COMPRESSED_CACHE_SIZE, 1024 * 1024},
+      {UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR, UPS_COMPRESSOR_LZF},
+      {0, 0}
+  };
+  f.require_create(UPS_DISABLE_MMAP, params)
+   .require_parameter(UPS_PARAM_COMPRESSED_CACHE_SIZE, 1024 * 1024)
+   .require_parameter(UPS_PARAM_COMPRESSED_CACHE_COMPRESSOR,
+                   UPS_COMPRESSOR_LZF);
+
+  const uint32_t count = 10000;
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  // the purged pages are fetched from the compressed cache
+  for (int loop = 0; loop < 2; loop++) {
+    for (uint32_t i = 0; i < count; i++) {
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = {0};
+      REQUIRE(0 == ups_db_find(f.db, 0, &key, &record, 0));
+      REQUIRE(*(uint32_t *)record.data == i);
+    }
+  }
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  REQUIRE(metrics.compressed_cache_hits > 0);
+  REQUIRE(metrics.compressed_cache_pages > 0);
+  REQUIRE(metrics.compressed_cache_bytes
+                  < metrics.compressed_cache_uncompressed_bytes);
+
+  // the purged pages are compressed without holding the lock; afterwards
+  // no compression is pending
+  REQUIRE(((LocalEnv *)f.env)->page_manager->state->cache.state
+                  .pending_reads.empty());
+}
+
+static uint64_t
+cachedBytes(ups_env_t *env)
+{
+  return ((LocalEnv *)env)->page_manager->state->cache.current_elements()
+            * 1024;
+}
+
+TEST_CASE("PageManager/sharedCacheTest", "")
+{
+  ups_env_t *env[2];
+  ups_db_t *db[2];
+  const char *filenames[2] = {"test.db", "test2.db"};
+
+  ups_parameter_t bad[] = {
+      {UPS_PARAM_SHARED_CACHE_WEIGHT, 0},
+      {0, 0}
+  };
+  REQUIRE(UPS_INV_PARAMETER == ups_env_create(&env[0], filenames[0], 0,
+                          0644, bad));
+
+  // the second Environment has three times the weight of the first
+  for (int e = 0; e < 2; e++) {
+    ups_parameter_t params[] = {
+        {UPS_PARAM_PAGE_SIZE, 1024},
+        {UPS_PARAM_SHARED_CACHE_SIZE, 64 * 1024},
+        {UPS_PARAM_SHARED_CACHE_WEIGHT, e == 0 ? 1u : 3u},
+        {0, 0}
+    };
+    REQUIRE(0 == ups_env_create(&env[e], filenames[e], UPS_DISABLE_MMAP,
+                            0644, params));
+    REQUIRE(0 == ups_env_create_db(env[e], &db[e], 1, 0, 0));
+  }
+
+  ups_parameter_t query[] = {
+      {UPS_PARAM_SHARED_CACHE_SIZE, 0},
+      {UPS_PARAM_SHARED_CACHE_WEIGHT, 0},
+      {0, 0}
+  };
+  REQUIRE(0 == ups_env_get_parameters(env[1], query));
+  REQUIRE(query[0].value == 64 * 1024);
+  REQUIRE(query[1].value == 3);
+
+  // fill the first Environment; it uses the whole capacity because the
+  // second one is still empty
+  const uint32_t count = 20000;
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(db[0], 0, &key, &record, 0));
+  }
+  uint64_t used_before = cachedBytes(env[0]);
+  REQUIRE(used_before > 16 * 1024);
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(env[0], &metrics));
+  REQUIRE(metrics.shared_cache_capacity == 64 * 1024);
+  REQUIRE(metrics.shared_cache_share == 16 * 1024);
+  REQUIRE(metrics.shared_cache_shrinks == 0);
+
+  // now fill the second one; the first (idle) one has to give up its pages
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(db[1], 0, &key, &record, 0));
+  }
+
+  // (check the cache before fetching the metrics; this visits the btree)
+  REQUIRE(cachedBytes(env[0]) < used_before);
+  REQUIRE(cachedBytes(env[1]) > cachedBytes(env[0]));
+  REQUIRE(0 == ups_env_get_metrics(env[0], &metrics));
+  REQUIRE(metrics.shared_cache_shrinks > 0);
+  REQUIRE(0 == ups_env_get_metrics(env[1], &metrics));
+  REQUIRE(metrics.shared_cache_share == 48 * 1024);
+
+  // the data of the shrunk Environment is still available
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = {0};
+    REQUIRE(0 == ups_db_find(db[0], 0, &key, &record, 0));
+    REQUIRE(*(uint32_t *)record.data == i);
+  }
+
+  for (int e = 0; e < 2; e++)
+    REQUIRE(0 == ups_env_close(env[e], UPS_AUTO_CLEANUP));
+
+  // both Environments left the shared cache
+  REQUIRE(SharedCache::instance()->members.empty());
+  REQUIRE(SharedCache::instance()->used_bytes == 0);
+}
+
+// Scans a database with a cursor; returns the number of pages which were
+// read ahead
+static uint64_t
+scanWithReadAhead(uint32_t read_ahead_pages)
+{
+  ups_parameter_t params[] = {
+      {UPS_PARAM_PAGE_SIZE, 1024},
+      {UPS_PARAM_CACHE_SIZE, 1024 * 1024},
+      {UPS_PARAM_READ_AHEAD_PAGES, read_ahead_pages},
+      {0, 0}
+  };
+  BaseFixture f;
+  f.require_create(UPS_DISABLE_MMAP, params)
+   .require_parameter(UPS_PARAM_READ_AHEAD_PAGES, read_ahead_pages);
+
+  const uint32_t count = 20000;
+  for (uint32_t i = 0; i < count; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  // reopen the file; the cache is empty
+  f.close();
+  f.require_open(UPS_DISABLE_MMAP, &params[1]);
+
+  ups_cursor_t *cursor;
+  REQUIRE(0 == ups_cursor_create(&cursor, f.db, 0, 0));
+  uint32_t i = 0;
+  ups_key_t key = {0};
+  ups_record_t record = {0};
+  while (0 == ups_cursor_move(cursor, &key, &record, UPS_CURSOR_NEXT)) {
+    REQUIRE(*(uint32_t *)key.data == *(uint32_t *)record.data);
+    i++;
+  }
+  REQUIRE(i == count);
+  REQUIRE(0 == ups_cursor_close(cursor));
+
+  // wait till the background reads are finished
+  f.lenv()->page_manager->state->read_ahead_signal.wait();
+
+  ups_env_metrics_t metrics;
+  REQUIRE(0 == ups_env_get_metrics(f.env, &metrics));
+  if (read_ahead_pages > 0)
+    REQUIRE(metrics.cache_hits_read_ahead > 0);
+  else
+    REQUIRE(metrics.cache_hits_read_ahead == 0);
+  return metrics.page_count_read_ahead;
+}
+
+TEST_CASE("PageManager/readAheadTest", "")
+{
+  REQUIRE(scanWithReadAhead(32) > 0);
+  REQUIRE(scanWithReadAhead(0) == 0);
+}
+
 TEST_CASE("PageManager-inmem/allocPage", "")
 {
   PageManagerFixture f(true);
@@ -864,6 +864,64 @@ struct HighLevelTxnFixture : BaseFixture {
 
     close();
   }
+
+  uint32_t count_with_cursor(ups_txn_t *txn) {
+    ups_cursor_t *cursor;
+    ups_key_t key = {0};
+    ups_record_t rec = {0};
+    uint32_t count = 0;
+
+    REQUIRE(0 == ups_cursor_create(&cursor, db, txn, 0));
+    while (0 == ups_cursor_move(cursor, &key, &rec, UPS_CURSOR_NEXT))
+      count++;
+    REQUIRE(0 == ups_cursor_close(cursor));
+    return count;
+  }
+
+  void snapshotTest() {
+    ups_txn_t *writer, *reader1, *reader2;
+    uint64_t count;
+
+    require_create(UPS_ENABLE_TRANSACTIONS);
+    REQUIRE(0 == insert(0, "key1", "rec1", 0));
+
+    REQUIRE(0 == ups_txn_begin(&writer, env, 0, 0, 0));
+    REQUIRE(0 == insert(writer, "key1", "rec2", UPS_OVERWRITE));
+    REQUIRE(0 == insert(writer, "key2", "rec2", 0));
+
+    // the snapshot ignores the active txn, and does not conflict with it
+    REQUIRE(0 == ups_txn_begin(&reader1, env, 0, 0, UPS_TXN_READ_ONLY));
+    REQUIRE(0 == find(reader1, "key1", "rec1"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader1, "key2", 0));
+    REQUIRE(UPS_WRITE_PROTECTED == insert(reader1, "key3", "rec3", 0));
+
+    // txns which commit after the snapshot was taken are invisible, even
+    // if the Environment is flushed
+    REQUIRE(0 == ups_txn_commit(writer, 0));
+    REQUIRE(0 == ups_txn_begin(&reader2, env, 0, 0, UPS_TXN_READ_ONLY));
+    REQUIRE(0 == insert(0, "key3", "rec3", 0));
+    REQUIRE(0 == ups_env_flush(env, 0));
+
+    REQUIRE(0 == find(reader1, "key1", "rec1"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader1, "key2", 0));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader1, "key3", 0));
+    REQUIRE(0 == ups_db_count(db, reader1, 0, &count));
+    REQUIRE(1ull == count);
+    REQUIRE(1u == count_with_cursor(reader1));
+
+    REQUIRE(0 == find(reader2, "key1", "rec2"));
+    REQUIRE(0 == find(reader2, "key2", "rec2"));
+    REQUIRE(UPS_KEY_NOT_FOUND == find(reader2, "key3", 0));
+    REQUIRE(0 == ups_db_count(db, reader2, 0, &count));
+    REQUIRE(2ull == count);
+    REQUIRE(2u == count_with_cursor(reader2));
+
+    REQUIRE(0 == ups_txn_commit(reader1, 0));
+    REQUIRE(0 == ups_txn_abort(reader2, 0));
+    REQUIRE(0 == find(0, "key1", "rec2"));
+    REQUIRE(0 == find(0, "key3", "rec3"));
+    REQUIRE(3u == count_with_cursor(0));
+  }
 };
 
 TEST_CASE("Txn/high/noPersistentDatabaseFlagTest", "")
@@ -957,6 +1015,12 @@ TEST_CASE("Txn/high/insertTxnsWithDelay", "")
     f.insertTxnsWithDelay(i);
 }
 
+TEST_CASE("Txn/high/snapshotTest", "")
+{
+  HighLevelTxnFixture f;
+  f.snapshotTest();
+}
+
 struct InMemoryTxnFixture : BaseFixture {
   InMemoryTxnFixture() {
     require_create(UPS_IN_MEMORY | UPS_ENABLE_TRANSACTIONS, 0,
@@ -18,6 +18,8 @@
 
 #include "3rdparty/catch/catch.hpp"
 
+#include "ups/upscaledb_uqi.h"
+
 #include "1os/file.h"
 #include "1errorinducer/errorinducer.h"
 #include "2page/page.h"
@@ -2575,4 +2577,277 @@ TEST_CASE("Upscaledb/bulkNegativeTests", "")
   f.bulkNegativeTests();
 }
 
+static void
+concurrent_reader(ups_env_t *env, ups_db_t *db, uint32_t num_keys,
+                int *failures)
+{
+  for (uint32_t i = 0; i < num_keys; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = {0};
+    if (ups_db_find(db, 0, &key, &record, 0) != 0
+          || record.size != sizeof(i)
+          || *(uint32_t *)record.data != i)
+      (*failures)++;
+  }
+
+  ups_cursor_t *cursor;
+  if (ups_cursor_create(&cursor, db, 0, 0) != 0) {
+    (*failures)++;
+    return;
+  }
+  ups_key_t key = {0};
+  uint32_t count = 0;
+  while (ups_cursor_move(cursor, &key, 0, UPS_CURSOR_NEXT) == 0) {
+    if (*(uint32_t *)key.data != count)
+      (*failures)++;
+    count++;
+  }
+  if (count != num_keys)
+    (*failures)++;
+  ups_cursor_close(cursor);
+
+  uint64_t keycount;
+  if (ups_db_count(db, 0, 0, &keycount) != 0 || keycount != num_keys)
+    (*failures)++;
+
+  uqi_result_t *result;
+  if (uqi_select(env, "COUNT($key) FROM DATABASE 1", &result) != 0) {
+    (*failures)++;
+    return;
+  }
+  uint32_t size;
+  if (*(uint64_t *)uqi_result_get_record_data(result, &size) != num_keys)
+    (*failures)++;
+  uqi_result_close(result);
+}
+
+TEST_CASE("Upscaledb/concurrentReadersTest", "")
+{
+  const uint32_t num_keys = 20000;
+  const int num_threads = 4;
+
+  // use a small cache; the readers have to purge it while the other
+  // readers are still using their pages
+  ups_parameter_t env_params[] = {
+      { UPS_PARAM_CACHE_SIZE, 1024 * 64 },
+      { 0, 0 }
+  };
+  ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+      { UPS_PARAM_RECORD_SIZE, sizeof(uint32_t) },
+      { 0, 0 }
+  };
+  BaseFixture f;
+  f.require_create(0, env_params, 0, db_params);
+  REQUIRE(f.ldb()->supports_concurrent_reads() == true);
+
+  for (uint32_t i = 0; i < num_keys; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  std::vector<boost::thread *> threads;
+  int failures[num_threads] = {0};
+  for (int i = 0; i < num_threads; i++)
+    threads.push_back(new boost::thread(concurrent_reader, f.env, f.db,
+                            num_keys, &failures[i]));
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->join();
+    delete threads[i];
+    REQUIRE(failures[i] == 0);
+  }
+}
+
+TEST_CASE("Upscaledb/concurrentColdReadersTest", "")
+{
+  const uint32_t num_keys = 20000;
+  const int num_threads = 4;
+
+  // without mmap, every cache miss reads the page with pread(); the
+  // readers start with a cold cache and read the same pages concurrently
+  ups_parameter_t env_params[] = {
+      { UPS_PARAM_CACHE_SIZE, 1024 * 64 },
+      { 0, 0 }
+  };
+  ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+      { UPS_PARAM_RECORD_SIZE, sizeof(uint32_t) },
+      { 0, 0 }
+  };
+  BaseFixture f;
+  f.require_create(UPS_DISABLE_MMAP | UPS_ENABLE_CRC32, env_params, 0,
+                  db_params);
+
+  for (uint32_t i = 0; i < num_keys; i++) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(&i, sizeof(i));
+    REQUIRE(0 == ups_db_insert(f.db, 0, &key, &record, 0));
+  }
+
+  f.close();
+  f.require_open(UPS_DISABLE_MMAP | UPS_ENABLE_CRC32, env_params);
+  REQUIRE(f.ldb()->supports_concurrent_reads() == true);
+
+  std::vector<boost::thread *> threads;
+  int failures[num_threads] = {0};
+  for (int i = 0; i < num_threads; i++)
+    threads.push_back(new boost::thread(concurrent_reader, f.env, f.db,
+                            num_keys, &failures[i]));
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->join();
+    delete threads[i];
+    REQUIRE(failures[i] == 0);
+  }
+}
+
+static void
+concurrent_writer(ups_db_t *db, uint32_t num_keys, int *failures)
+{
+  // the records are stored as blobs, and the blob pages are shared
+  // with the other databases
+  char buffer[64] = {0};
+  for (uint32_t i = 0; i < num_keys; i++) {
+    ::memcpy(buffer, &i, sizeof(i));
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(buffer, sizeof(buffer));
+    if (ups_db_insert(db, 0, &key, &record, 0) != 0)
+      (*failures)++;
+  }
+
+  for (uint32_t i = 0; i < num_keys; i += 3) {
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    if (ups_db_erase(db, 0, &key, 0) != 0)
+      (*failures)++;
+  }
+}
+
+TEST_CASE("Upscaledb/concurrentWritersTest", "")
+{
+  const uint32_t num_keys = 10000;
+  const int num_dbs = 4;
+
+  ups_parameter_t env_params[] = {
+      { UPS_PARAM_CACHE_SIZE, 1024 * 64 },
+      { 0, 0 }
+  };
+  ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+      { 0, 0 }
+  };
+  BaseFixture f;
+  f.require_create(0, env_params, 0, db_params);
+  REQUIRE(f.ldb()->latch() != 0);
+
+  ups_db_t *dbs[num_dbs] = {f.db};
+  for (int i = 1; i < num_dbs; i++)
+    REQUIRE(0 == ups_env_create_db(f.env, &dbs[i], i + 1, 0, db_params));
+
+  // each thread writes to its own database
+  std::vector<boost::thread *> threads;
+  int failures[num_dbs] = {0};
+  for (int i = 0; i < num_dbs; i++)
+    threads.push_back(new boost::thread(concurrent_writer, dbs[i],
+                            num_keys, &failures[i]));
+  for (int i = 0; i < num_dbs; i++) {
+    threads[i]->join();
+    delete threads[i];
+    REQUIRE(failures[i] == 0);
+  }
+
+  for (int i = 0; i < num_dbs; i++) {
+    REQUIRE(0 == ups_db_check_integrity(dbs[i], 0));
+    uint64_t keycount;
+    REQUIRE(0 == ups_db_count(dbs[i], 0, 0, &keycount));
+    REQUIRE(keycount == num_keys - (num_keys + 2) / 3);
+
+    for (uint32_t k = 0; k < num_keys; k++) {
+      ups_key_t key = ups_make_key(&k, sizeof(k));
+      ups_record_t record = {0};
+      ups_status_t st = ups_db_find(dbs[i], 0, &key, &record, 0);
+      if (k % 3 == 0)
+        REQUIRE(st == UPS_KEY_NOT_FOUND);
+      else {
+        REQUIRE(st == 0);
+        REQUIRE(record.size == 64);
+        REQUIRE(*(uint32_t *)record.data == k);
+      }
+    }
+  }
+
+  for (int i = 1; i < num_dbs; i++)
+    REQUIRE(0 == ups_db_close(dbs[i], 0));
+}
+
+static void
+concurrent_updater(ups_db_t *db, uint32_t num_keys, int thread_id,
+                int num_threads, int *failures)
+{
+  // the threads write interleaved keys, therefore they share the same leafs
+  char buffer[64] = {0};
+  for (uint32_t i = thread_id; i < num_keys; i += num_threads) {
+    ::memcpy(buffer, &i, sizeof(i));
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    ups_record_t record = ups_make_record(buffer, sizeof(buffer));
+    if (ups_db_insert(db, 0, &key, &record, 0) != 0)
+      (*failures)++;
+  }
+
+  for (uint32_t i = thread_id; i < num_keys; i += num_threads) {
+    if (i % 3 != 0)
+      continue;
+    ups_key_t key = ups_make_key(&i, sizeof(i));
+    if (ups_db_erase(db, 0, &key, 0) != 0)
+      (*failures)++;
+  }
+}
+
+TEST_CASE("Upscaledb/concurrentUpdatesTest", "")
+{
+  const uint32_t num_keys = 20000;
+  const int num_threads = 4;
+
+  ups_parameter_t env_params[] = {
+      { UPS_PARAM_CACHE_SIZE, 1024 * 64 },
+      { 0, 0 }
+  };
+  ups_parameter_t db_params[] = {
+      { UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32 },
+      { 0, 0 }
+  };
+  BaseFixture f;
+  f.require_create(0, env_params, 0, db_params);
+  REQUIRE(f.ldb()->supports_concurrent_updates() == true);
+
+  // all threads write to the same database
+  std::vector<boost::thread *> threads;
+  int failures[num_threads] = {0};
+  for (int i = 0; i < num_threads; i++)
+    threads.push_back(new boost::thread(concurrent_updater, f.db,
+                            num_keys, i, num_threads, &failures[i]));
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->join();
+    delete threads[i];
+    REQUIRE(failures[i] == 0);
+  }
+
+  REQUIRE(0 == ups_db_check_integrity(f.db, 0));
+  uint64_t keycount;
+  REQUIRE(0 == ups_db_count(f.db, 0, 0, &keycount));
+  REQUIRE(keycount == num_keys - (num_keys + 2) / 3);
+
+  for (uint32_t k = 0; k < num_keys; k++) {
+    ups_key_t key = ups_make_key(&k, sizeof(k));
+    ups_record_t record = {0};
+    ups_status_t st = ups_db_find(f.db, 0, &key, &record, 0);
+    if (k % 3 == 0)
+      REQUIRE(st == UPS_KEY_NOT_FOUND);
+    else {
+      REQUIRE(st == 0);
+      REQUIRE(record.size == 64);
+      REQUIRE(*(uint32_t *)record.data == k);
+    }
+  }
+}
+
 } // namespace upscaledb
@@ -183,6 +183,29 @@ agg_results(void *state, uqi_result_t *result)
   delete cooked_state;
 }
 
+static void
+sum_results(void *state, uqi_result_t *result)
+{
+  Result *r = (Result *)result;
+  r->row_count = 1;
+  r->key_type = UPS_TYPE_BINARY;
+  r->add_key("AGG");
+  r->record_type = UPS_TYPE_UINT64;
+  r->add_record(*(uint64_t *)state);
+}
+
+static void
+sum_combine(void *state, void *other_state)
+{
+  *(uint64_t *)state += *(uint64_t *)other_state;
+}
+
+static void
+sum_cleanup(void *state)
+{
+  delete (uint64_t *)state;
+}
+
 static int
 even_predicate(void *state, const void *key_data, uint32_t key_size,
                 const void *record_data, uint32_t record_size)
@@ -1832,4 +1855,136 @@ TEST_CASE("Uqi/issue102Test", "")
   f.issue102Test();
 }
 
+struct ParallelScanFixture : BaseFixture {
+  ParallelScanFixture(uint32_t env_flags) {
+    ups_parameter_t env_params[] = {
+        {UPS_PARAM_PAGE_SIZE, 1024},
+        {UPS_PARAM_SELECT_THREADS, 4},
+        {0, 0}
+    };
+    ups_parameter_t db_params[] = {
+        {UPS_PARAM_KEY_TYPE, UPS_TYPE_UINT32},
+        {UPS_PARAM_RECORD_TYPE, UPS_TYPE_UINT64},
+        {0, 0}
+    };
+    require_create(env_flags, env_params, 0, db_params);
+  }
+
+  ~ParallelScanFixture() {
+    close();
+  }
+
+  void aggregateTest(ups_txn_t *txn = 0) {
+    const uint32_t count = 20000;
+    uint64_t key_sum = 0;
+    uint64_t record_sum = 0;
+
+    // small pages: the keys are spread over several hundred leafs
+    for (uint32_t i = 0; i < count; i++) {
+      uint64_t j = i * 3;
+      ups_key_t key = ups_make_key(&i, sizeof(i));
+      ups_record_t record = ups_make_record(&j, sizeof(j));
+      REQUIRE(0 == ups_db_insert(db, txn, &key, &record, 0));
+      key_sum += i;
+      record_sum += j;
+    }
+
+    if (txn)
+      REQUIRE(0 == ups_txn_commit(txn, 0));
+
+    ResultProxy rp;
+
+    REQUIRE(0 == uqi_select(env, "SUM($key) from database 1", &rp.result));
+    rp.require("SUM", UPS_TYPE_UINT64, key_sum)
+      .close();
+
+    REQUIRE(0 == uqi_select(env, "COUNT($key) from database 1", &rp.result));
+    rp.require("COUNT", UPS_TYPE_UINT64, (uint64_t)count)
+      .close();
+
+    REQUIRE(0 == uqi_select(env, "AVERAGE($record) from database 1",
+                            &rp.result));
+    rp.require("AVERAGE", UPS_TYPE_REAL64, record_sum / (double)count)
+      .close();
+
+    uint32_t min_key = 0;
+    uint64_t max_record = (count - 1) * 3;
+    REQUIRE(0 == uqi_select(env, "MIN($key) from database 1", &rp.result));
+    rp.require_row_count(1)
+      .require_key(0, &min_key, sizeof(min_key))
+      .close();
+    REQUIRE(0 == uqi_select(env, "MAX($record) from database 1", &rp.result));
+    rp.require_row_count(1)
+      .require_record(0, &max_record, sizeof(max_record))
+      .close();
+
+    REQUIRE(0 == uqi_select(env, "TOP($key) from database 1 limit 5",
+                            &rp.result));
+    rp.require_row_count(5);
+    for (uint32_t i = 0; i < 5; i++) {
+      uint32_t k = count - 5 + i;
+      rp.require_key(i, &k, sizeof(k));
+    }
+    rp.close();
+
+    REQUIRE(0 == uqi_select(env, "BOTTOM($key) from database 1 limit 5",
+                            &rp.result));
+    rp.require_row_count(5);
+    for (uint32_t i = 0; i < 5; i++)
+      rp.require_key(i, &i, sizeof(i));
+    rp.close();
+
+    REQUIRE(0 == uqi_select(env, "COUNT($key) from database 1 "
+                            "WHERE even($key)", &rp.result));
+    rp.require("COUNT", UPS_TYPE_UINT64, (uint64_t)count / 2)
+      .close();
+
+    // a custom aggregation function which merges partial results
+    REQUIRE(0 == uqi_select(env, "psum($key) from database 1", &rp.result));
+    rp.require("AGG", UPS_TYPE_UINT64, key_sum);
+  }
+};
+
+static void
+register_parallel_plugins()
+{
+  if (!PluginManager::is_registered("even")) {
+    uqi_plugin_t even_plugin = {0};
+    even_plugin.name = "even";
+    even_plugin.type = UQI_PLUGIN_PREDICATE;
+    even_plugin.pred = even_predicate;
+    REQUIRE(0 == uqi_register_plugin(&even_plugin));
+  }
+
+  if (!PluginManager::is_registered("psum")) {
+    uqi_plugin_t plugin = {0};
+    plugin.name = "psum";
+    plugin.type = UQI_PLUGIN_AGGREGATE;
+    plugin.plugin_version = 1;
+    plugin.init = agg_init;
+    plugin.cleanup = sum_cleanup;
+    plugin.agg_single = agg_single;
+    plugin.agg_many = agg_many;
+    plugin.results = sum_results;
+    plugin.combine = sum_combine;
+    REQUIRE(0 == uqi_register_plugin(&plugin));
+  }
+}
+
+TEST_CASE("Uqi/parallelScanTest", "")
+{
+  register_parallel_plugins();
+  ParallelScanFixture f(0);
+  f.aggregateTest();
+}
+
+TEST_CASE("Uqi/parallelScanTxnTest", "")
+{
+  register_parallel_plugins();
+  ParallelScanFixture f(UPS_ENABLE_TRANSACTIONS);
+  ups_txn_t *txn;
+  REQUIRE(0 == ups_txn_begin(&txn, f.env, 0, 0, 0));
+  f.aggregateTest(txn);
+}
+
 } // namespace upscaledb